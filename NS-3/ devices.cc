@@ -8,67 +8,39 @@
 #include "ns3/propagation-loss-model.h"
 #include "ns3/propagation-delay-model.h"
 
+#include "lora-noise-fading-loss-model.h"
+#include "lora-link-budget-cache.h"
+#include "lora-uplink-tracker.h"
+#include "lora-device-counters.h"
+#include "lora-analytic-pdr.h"
+#include "lora-packet-trace.h"
+#include "lora-windowed-metrics.h"
+#include "lora-benchmark.h"
+#include "lora-sinr-reception.h"
+#include "lora-device-config.h"
+#include "lora-per-table.h"
+#include "lora-airtime.h"
+#include "lora-batched-sender.h"
+#include "lora-cell-partition.h"
+#include "lora-device-population.h"
+#include "lora-checkpoint.h"
+#include "lora-adr.h"
+#include "lora-binary-log.h"
+#include "lora-downlink-scheduler.h"
+#include "lora-reception-paths.h"
+#include "lora-reception-thresholds.h"
+#include "lora-profiler.h"
+#include "lora-coverage-map.h"
+#include "lora-candidate-channel.h"
+
+#include <chrono>
+
 using namespace ns3;
 using namespace lorawan;
 
 NS_LOG_COMPONENT_DEFINE ("LoraThreeDevicesWireless");
-
-// Модель теплового шума
-class ThermalNoiseModel
-{
-public:
-    ThermalNoiseModel() : temperatureC(25.0), bandwidth(125000.0), noiseFigure(3.0) {}
-    
-    void SetTemperatureCelsius(double temp) { temperatureC = temp; }
-    void SetBandwidth(double bw) { bandwidth = bw; }
-    void SetNoiseFigure(double nf) { noiseFigure = nf; }
-    
-    double GetThermalNoisePowerDbm() {
-        // Формула теплового шума: P = k * T * B
-        // k - постоянная Больцмана (1.38e-23), T - температура в Кельвинах, B - полоса пропускания
-        double temperatureK = temperatureC + 273.15;
-        double noisePowerW = 1.38e-23 * temperatureK * bandwidth;
-        double noisePowerDbm = 10 * log10(noisePowerW) + 30; // преобразование в dBm
-        
-        // Учет шумовой фигуры
-        return noisePowerDbm + noiseFigure;
-    }
-    
-private:
-    double temperatureC;
-    double bandwidth;
-    double noiseFigure;
-};
-
-// Модель АБГШ
-class AWGNModel
-{
-public:
-    AWGNModel() : noisePowerDbm(-110.0) {}
-    
-    void SetNoisePower(double power) { noisePowerDbm = power; }
-    void SetBandwidth(double bw) { bandwidth = bw; }
-    
-    double AddAWGN(double signalPowerDbm) {
-        // Простая модель: добавление шум к мощности сигнала
-        double signalPowerLinear = pow(10.0, signalPowerDbm / 10.0);
-        double noisePowerLinear = pow(10.0, noisePowerDbm / 10.0);
-        
-        // Имитация добавления шума (упрощенно)
-        double snrLinear = signalPowerLinear / noisePowerLinear;
-        
-        // Если SNR достаточно высокий, считаем что пакет может быть принят
-        if (snrLinear > 1.0) {
-            return signalPowerDbm; // Сигнал принят
-        } else {
-            return -1000.0; // Сигнал потерян (очень низкая мощность)
-        }
-    }
-    
-private:
-    double noisePowerDbm;
-    double bandwidth;
-};
+NS_OBJECT_ENSURE_REGISTERED (LoraBatchedSender);
+NS_OBJECT_ENSURE_REGISTERED (LoraDownlinkComponent);
 
 int main (int argc, char *argv[])
 {
@@ -78,62 +50,341 @@ int main (int argc, char *argv[])
     double appPeriod = 600;     // Период отправки данных (10 минут)
     bool enableFading = true;   // Включить замирания
     bool enableAWGN = true;     // Включить АБГШ
+    double coherenceTime = 0.0; // Интервал когерентности замираний, с (0 - независимо для каждого пакета)
+    std::string deviceConfig = ""; // DR:мощность для каждого устройства ("5:14,3:10,1:6")
+    int nGateways = 1;          // Количество шлюзов
+    double radius = 2000.0;     // Радиус области размещения, м
+    bool sinr = false;          // Прием по SINR и порогам SF вместо порога SNR
+    std::string perTableFile = ""; // Таблица PER из PerTable.cc (пусто - порог SNR)
+    bool dutyCycle = false;     // Учет duty cycle EU868 маркерными корзинами
+    bool batchedSender = false; // Одно приложение-отправитель на шлюз вместо PeriodicSender
+    double senderSlot = 1.0;    // Ширина слота календарной очереди отправителя, с
+    bool population = false;    // Устройства без узлов ns-3 (массивы состояний)
+    int cell = -1;              // Ячейка шлюза для разбиения (-1 - вся сеть)
+    std::string cellExport = ""; // Префикс трасс эфира ячеек для записи
+    std::string cellImport = ""; // Префикс трасс эфира соседних ячеек для помех
+    std::string checkpointFile = ""; // Снимок состояния сети в конце прогона
+    std::string restoreFile = "";    // Теплый старт из снимка
+    double mobileFraction = 0.0; // Доля подвижных устройств (на транспорте)
+    double mobileSpeed = 10.0;  // Скорость подвижных устройств, м/с
+    double linkUpdateDistance = 20.0; // Сдвиг, после которого пересчитываются потери, м
+    double shadowingSigma = 0.0; // СКО логнормального затенения, dB (0 - выключено)
+    double shadowingDistance = 50.0; // Расстояние декорреляции затенения, м
+    bool adr = false;           // ADR на сетевом сервере
+    uint32_t adrHistory = 20;   // Наблюдений SNR на устройство для решения ADR
+    double adrInterval = 1800;  // Период пакетного пересчета ADR, с
+    double adrMargin = 10.0;    // Запас ADR на установку, dB
+    double confirmedFraction = 0.0; // Доля устройств с подтверждаемыми пакетами
+    uint32_t maxTransmissions = 1;  // Передач подтверждаемого пакета без ACK
+    uint32_t receptionPaths = LORA_GATEWAY_RECEPTION_PATHS; // Пути демодуляции шлюза
+    std::string traceFile = ""; // Двоичная трасса пакетов (пусто - LoraPacketTracker)
+    double metricsInterval = 0; // Окно метрик, с (0 - метрики не пишутся)
+    std::string metricsFile = "metrics.csv"; // Файл метрик (.csv или .json)
+    bool metricsPerDevice = false; // Счетчики каждого устройства в каждом окне
+    std::string snrHistogram = "";  // Бины гистограммы SNR "min:ширина:число" (пусто - -30:1:60)
+    std::string rssiHistogram = ""; // Бины гистограммы RSSI (пусто - -140:2:50)
+    std::string profileFile = "profile.folded"; // Свернутые стеки профиля (сборка с -DLORA_PROFILE)
+    std::string logFile = "";   // Двоичный диагностический журнал (пусто - выключен)
+    std::string coverageMap = ""; // Карта покрытия области вместо прогона (.csv или растр)
+    uint32_t coverageSize = 512; // Клеток карты покрытия на сторону
+    uint32_t coverageThreads = 0; // Потоки карты покрытия (0 - по числу ядер)
+
+    CommandLine cmd (__FILE__);
+    cmd.AddValue ("nDevices", "Количество устройств", nDevices);
+    cmd.AddValue ("simulationTime", "Время симуляции, с", simulationTime);
+    cmd.AddValue ("appPeriod", "Период отправки данных, с", appPeriod);
+    cmd.AddValue ("enableFading", "Включить замирания", enableFading);
+    cmd.AddValue ("enableAWGN", "Включить АБГШ", enableAWGN);
+    cmd.AddValue ("coherenceTime", "Интервал когерентности замираний, с", coherenceTime);
+    cmd.AddValue ("deviceConfig", "DR:мощность для каждого устройства через запятую", deviceConfig);
+    cmd.AddValue ("nGateways", "Количество шлюзов", nGateways);
+    cmd.AddValue ("radius", "Радиус области размещения, м", radius);
+    cmd.AddValue ("sinr", "Прием по SINR с порогами SF и захватом", sinr);
+    cmd.AddValue ("perTable", "Файл таблицы PER(SNR, SF, CR, длина)", perTableFile);
+    cmd.AddValue ("dutyCycle", "Учет duty cycle EU868 (1%/0.1%) по устройствам", dutyCycle);
+    cmd.AddValue ("batchedSender", "Пакетная отправка: календарная очередь на шлюз", batchedSender);
+    cmd.AddValue ("senderSlot", "Слот календарной очереди отправителя, с", senderSlot);
+    cmd.AddValue ("population", "Облегченная популяция устройств без узлов ns-3", population);
+    cmd.AddValue ("cell", "Моделировать только устройства ячейки шлюза с этим индексом", cell);
+    cmd.AddValue ("cellExport", "Префикс файлов трассы эфира ячейки (<prefix>.<cell>.air)", cellExport);
+    cmd.AddValue ("cellImport", "Префикс трасс эфира соседних ячеек для помех", cellImport);
+    cmd.AddValue ("checkpoint", "Записать снимок сети в момент simulationTime", checkpointFile);
+    cmd.AddValue ("restore", "Продолжить из снимка сети (позиции, SF, мощность, расписание)", restoreFile);
+    cmd.AddValue ("mobileFraction", "Доля подвижных устройств (случайное блуждание)", mobileFraction);
+    cmd.AddValue ("mobileSpeed", "Скорость подвижных устройств, м/с", mobileSpeed);
+    cmd.AddValue ("linkUpdateDistance", "Сдвиг подвижного устройства до пересчета потерь, м", linkUpdateDistance);
+    cmd.AddValue ("shadowingSigma", "СКО логнормального затенения, dB", shadowingSigma);
+    cmd.AddValue ("shadowingDistance", "Расстояние декорреляции затенения, м", shadowingDistance);
+    cmd.AddValue ("adr", "ADR на сетевом сервере (LinkADRReq в ответах)", adr);
+    cmd.AddValue ("adrHistory", "Число последних пакетов устройства для решения ADR", adrHistory);
+    cmd.AddValue ("adrInterval", "Период пакетного пересчета ADR, с", adrInterval);
+    cmd.AddValue ("adrMargin", "Запас ADR на установку, dB", adrMargin);
+    cmd.AddValue ("confirmedFraction", "Доля устройств с подтверждаемыми пакетами (ACK от шлюзов)", confirmedFraction);
+    cmd.AddValue ("maxTransmissions", "Число передач подтверждаемого пакета до получения ACK", maxTransmissions);
+    cmd.AddValue ("receptionPaths", "Число путей демодуляции шлюза", receptionPaths);
+    cmd.AddValue ("traceFile", "Файл двоичной трассы пакетов", traceFile);
+    cmd.AddValue ("metricsInterval", "Окно метрик PDR/SNR, с (0 - выключено)", metricsInterval);
+    cmd.AddValue ("metricsFile", "Файл метрик по окнам (.csv или .json)", metricsFile);
+    cmd.AddValue ("metricsPerDevice", "Писать в метрики счетчики каждого устройства", metricsPerDevice);
+    cmd.AddValue ("snrHistogram", "Бины гистограммы SNR метрик: min:ширина:число, dB", snrHistogram);
+    cmd.AddValue ("rssiHistogram", "Бины гистограммы RSSI метрик: min:ширина:число, dBm", rssiHistogram);
+    cmd.AddValue ("logFile", "Файл двоичного диагностического журнала (LogDecoder.cc)", logFile);
+    cmd.AddValue ("profileFile", "Файл свернутых стеков профиля (сборка с -DLORA_PROFILE)", profileFile);
+    cmd.AddValue ("coverageMap", "Записать карту покрытия области (.csv или растр) вместо прогона", coverageMap);
+    cmd.AddValue ("coverageSize", "Клеток карты покрытия на сторону", coverageSize);
+    cmd.AddValue ("coverageThreads", "Потоки карты покрытия (0 - по числу ядер)", coverageThreads);
+    cmd.Parse (argc, argv);
 
     // Настройка логирования
     LogComponentEnable ("LoraThreeDevicesWireless", LOG_LEVEL_INFO);
     LogComponentEnable ("LoraPacketTracker", LOG_LEVEL_INFO);
 
+    // Теплый старт: топология, радиопараметры и расписание берутся из снимка,
+    // прогон тратится только на измеряемый интервал
+    NS_ABORT_MSG_IF (cell >= 0 && !checkpointFile.empty (), "Снимок ячейки не хранит всю сеть");
+    LoraCheckpoint restored;
+    if (!restoreFile.empty ()) {
+        NS_ABORT_MSG_IF (cell >= 0, "Снимок хранит всю сеть, разбиение на ячейки с ним не поддерживается");
+        NS_ABORT_MSG_IF (!restored.Open (restoreFile), "Не удалось открыть снимок " << restoreFile);
+        NS_ABORT_MSG_IF (restored.GetHeader ().periodNs != Seconds (appPeriod).GetNanoSeconds (),
+                         "Снимок снят с периодом " << NanoSeconds (restored.GetHeader ().periodNs).GetSeconds ()
+                         << " с, задан --appPeriod=" << appPeriod);
+        nDevices = restored.GetNDevices ();
+        nGateways = restored.GetNGateways ();
+        NS_LOG_INFO("Снимок " << restoreFile << ": " << nDevices << " устройств, " << nGateways << " шлюзов, "
+                    << NanoSeconds (restored.GetHeader ().timeNs).GetSeconds () << " с прогрева (RngRun "
+                    << restored.GetHeader ().rngRun << ")");
+    }
+
     NS_LOG_INFO("Создаем беспроводную сеть LoRaWAN с " << nDevices << " устройствами");
 
+    // Один шлюз в центре, несколько - квадратной решеткой по области
+    std::vector<Vector> gatewayPositions = GatewayLatticePositions (nGateways, radius, 15.0); // Высота 15м
+    Ptr<ListPositionAllocator> restoredPositions = CreateObject<ListPositionAllocator> ();
+    if (restored.IsLoaded ()) {
+        for (int g = 0; g < nGateways; g++) {
+            gatewayPositions[g] = restored.GetGatewayPosition (g);
+        }
+        for (int i = 0; i < nDevices; i++) {
+            restoredPositions->Add (restored.GetDevicePosition (i));
+        }
+    }
+
+    // Разбиение на ячейки: расстановка всей сети задана плитками LoraTiledDisc,
+    // процесс разыгрывает только плитки своей ячейки и оставляет ее устройства.
+    // Шлюзы создаются все, чтобы устройства на границе принимались соседними
+    LoraCellPartition partition (gatewayPositions);
+    std::vector<uint32_t> deviceIndex; // Номера моделируемых устройств в сети
+    Ptr<ListPositionAllocator> cellPositions = CreateObject<ListPositionAllocator> ();
+    NS_ABORT_MSG_IF (population && cell >= 0,
+                     "Популяция без узлов не поддерживает --cell: ячейка отбирает устройства по плиткам, "
+                     "а популяция расставляет их сама");
+    NS_ABORT_MSG_IF (population && enableFading && coherenceTime > 0,
+                     "Популяция без узлов не поддерживает --coherenceTime: замирания ее устройств разыгрываются "
+                     "заново на каждую передачу, без состояния линии");
+    NS_ABORT_MSG_IF (population && mobileFraction > 0,
+                     "Популяция без узлов не поддерживает подвижные устройства: позиции хранятся "
+                     "без моделей мобильности");
+    NS_ABORT_MSG_IF (population && adr, "ADR требует сетевого сервера, а устройства популяции ему не известны");
+    NS_ABORT_MSG_IF (confirmedFraction > 0 && population,
+                     "Подтверждаемые пакеты не поддерживаются с --population: у устройств популяции нет MAC "
+                     "и PHY, которые повторяли бы кадр и принимали ACK");
+    NS_ABORT_MSG_IF (adr && !enableAWGN, "ADR требует включенного шума (--enableAWGN=true) для расчета SNR");
+    if (cell >= 0) {
+        NS_ABORT_MSG_IF (cell >= nGateways, "Ячейка " << cell << " вне 0.." << nGateways - 1);
+        NS_ABORT_MSG_IF (!sinr, "Разбиение на ячейки требует --sinr=true: помехи соседей учитывает LoraSinrReception");
+        // Около 16 плиток на ячейку решетки шлюзов
+        LoraTiledDisc disc (nDevices, radius, 4 * uint32_t (std::ceil (std::sqrt (double (nGateways)))));
+        partition.BoundRadii (disc);
+        std::vector<Vector> tilePositions;
+        uint32_t generated = 0;
+        for (uint32_t t = 0; t < disc.GetNTiles (); t++) {
+            if (disc.GetCount (t) == 0 || !partition.MayContain (disc, t, cell)) {
+                continue;
+            }
+            disc.Generate (t, tilePositions);
+            generated += tilePositions.size ();
+            for (uint32_t k = 0; k < tilePositions.size (); k++) {
+                if (partition.Assign (tilePositions[k]) == uint32_t (cell)) {
+                    deviceIndex.push_back (disc.GetFirstDevice (t) + k);
+                    cellPositions->Add (tilePositions[k]);
+                }
+            }
+        }
+        NS_LOG_INFO("Ячейка " << cell << ": " << deviceIndex.size () << " устройств из " << nDevices
+                    << " (разыграно " << generated << "), радиус до " << partition.GetCellRadius (cell) << " м");
+    } else if (!population) {
+        for (int i = 0; i < nDevices; i++) {
+            deviceIndex.push_back (i);
+        }
+    }
+
     // Создание узлов 
     NodeContainer endDevices;
-    endDevices.Create (nDevices);
+    endDevices.Create (deviceIndex.size ());
 
     NodeContainer gateways;
-    gateways.Create (1);  // Один шлюз
+    gateways.Create (nGateways);
 
     // Настройка мобильности
     MobilityHelper mobility;
     
-    // Шлюз в центре
     Ptr<ListPositionAllocator> positionAllocGateways = CreateObject<ListPositionAllocator> ();
-    positionAllocGateways->Add (Vector (0.0, 0.0, 15.0)); // Высота 15м
+    for (const Vector& pos : gatewayPositions) {
+        positionAllocGateways->Add (pos);
+    }
     mobility.SetPositionAllocator (positionAllocGateways);
     mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
     mobility.Install (gateways);
 
-    // Устройства распределяем случайно в радиусе 2км
+    // Устройства распределяем случайно в радиусе radius (по умолчанию 2км)
+    Ptr<PositionAllocator> positionAllocEd;
+    if (cell >= 0) {
+        positionAllocEd = cellPositions;
+    } else if (restored.IsLoaded ()) {
+        positionAllocEd = restoredPositions;
+    } else {
+        positionAllocEd = CreateObjectWithAttributes<UniformDiscPositionAllocator> ("X", DoubleValue (0.0),
+                                                                                  "Y", DoubleValue (0.0),
+                                                                                  "rho", DoubleValue (radius));
+    }
     MobilityHelper mobilityEd;
-    mobilityEd.SetPositionAllocator ("ns3::UniformDiscPositionAllocator",
-                                    "X", DoubleValue (0.0),
-                                    "Y", DoubleValue (0.0),
-                                    "rho", DoubleValue (2000.0)); // Радиус 2000м
+    mobilityEd.SetPositionAllocator (positionAllocEd);
     mobilityEd.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-    mobilityEd.Install (endDevices);
+
+    // Подвижные устройства - первые mobileFraction * n (позиции случайны):
+    // случайное блуждание с постоянной скоростью и сменой направления раз в минуту
+    uint32_t nMobile = std::min<uint32_t> (std::lround (mobileFraction * endDevices.GetN ()), endDevices.GetN ());
+    if (nMobile == 0) {
+        mobilityEd.Install (endDevices);
+    } else {
+        MobilityHelper mobilityVehicle;
+        mobilityVehicle.SetPositionAllocator (positionAllocEd);
+        mobilityVehicle.SetMobilityModel ("ns3::RandomWalk2dMobilityModel",
+                                          "Bounds", RectangleValue (Rectangle (-radius, radius, -radius, radius)),
+                                          "Speed", StringValue ("ns3::ConstantRandomVariable[Constant=" +
+                                                                std::to_string (mobileSpeed) + "]"),
+                                          "Mode", StringValue ("Time"),
+                                          "Time", TimeValue (Seconds (60)));
+        for (uint32_t i = 0; i < endDevices.GetN (); i++) {
+            (i < nMobile ? mobilityVehicle : mobilityEd).Install (endDevices.Get (i));
+        }
+        NS_LOG_INFO("Подвижных устройств: " << nMobile << ", скорость " << mobileSpeed << " м/с");
+    }
 
     // Создание канала с замираниями и шумами
     Ptr<LogDistancePropagationLossModel> logDistance = CreateObject<LogDistancePropagationLossModel> ();
     logDistance->SetAttribute ("Exponent", DoubleValue (3.0)); // Показатель затухания
     logDistance->SetAttribute ("ReferenceLoss", DoubleValue (46.0)); // Потери на 1м
 
-    // Модель замираний Рэлея
-    Ptr<RayleighFadingModel> rayleighFading = CreateObject<RayleighFadingModel> ();
-    
+    // Потери LogDistance для пар устройство-шлюз считаются один раз при установке
+    Ptr<LoraLinkBudgetCacheLossModel> linkCache = CreateObject<LoraLinkBudgetCacheLossModel> ();
+    linkCache->SetLossModel (logDistance);
+    // Подвижные устройства пересчитывают потери только после заметного сдвига
+    linkCache->SetUpdateDistance (linkUpdateDistance);
+    if (shadowingSigma > 0) {
+        linkCache->SetShadowing (shadowingSigma, shadowingDistance);
+        NS_LOG_INFO("Затенение: " << shadowingSigma << " dB, декорреляция " << shadowingDistance << " м");
+    }
+
     // Создание составной модели потерь
     Ptr<CompositePropagationLossModel> compositeLoss = CreateObject<CompositePropagationLossModel> ();
-    compositeLoss->AddLossModel (logDistance);
-    
+    compositeLoss->AddLossModel (linkCache);
+
+    // Таблица PER отображается в память и общая для всех процессов сценария
+    LoraPerTable perTable;
+    if (!perTableFile.empty ()) {
+        NS_ABORT_MSG_IF (!enableAWGN, "Таблица PER требует включенного шума (--enableAWGN=true)");
+        NS_ABORT_MSG_IF (!perTable.Open (perTableFile), "Не удалось открыть таблицу PER " << perTableFile);
+    }
+
+    // Замирания Рэлея и тепловой шум как мощность АБГШ (пакет принимается при SNR > 0 dB)
+    LoraNoiseFadingHelper noiseHelper;
+    noiseHelper.SetBandwidth (125000.0);
     if (enableFading) {
-        compositeLoss->AddLossModel (rayleighFading);
+        noiseHelper.SetRayleighFading (1.0, Seconds (coherenceTime));
         NS_LOG_INFO("Замирания Рэлея включены");
     }
+    if (enableAWGN) {
+        // При приеме по SINR или по таблице PER модель шума отсекает только то,
+        // что не примет даже SF12
+        double thresholdDb = sinr ? LORA_SINR_FLOOR_DB[5] : 0.0;
+        if (perTable.IsLoaded ()) {
+            thresholdDb = perTable.GetMinUsefulSnrDb ();
+        }
+        noiseHelper.SetThermalNoise (25.0, 3.0, thresholdDb);
+    } else {
+        noiseHelper.DisableNoise ();
+    }
+    // Подпотоки замираний по номеру устройства в сети и номеру шлюза: не
+    // зависят от числа устройств, порядка узлов и ячейки процесса
+    noiseHelper.SetLinks (endDevices, gateways, deviceIndex);
+    Ptr<LoraNoiseFadingLossModel> noiseModel = noiseHelper.Install (compositeLoss);
+
+    // Карта покрытия: RSSI, SNR, лучший шлюз и непокрытие по SF для каждой
+    // клетки квадрата области; сеть при этом не моделируется
+    if (!coverageMap.empty ()) {
+        NS_ABORT_MSG_IF (!noiseModel->IsNoiseEnabled (), "Карта покрытия требует включенного шума (--enableAWGN=true)");
+        AnalyticChannelParams coverageParams;
+        coverageParams.SetFromModel (noiseModel);
+        LoraCoverageMap coverage (coverageParams);
+        coverage.SetArea (-radius, -radius, 2 * radius, coverageSize);
+        coverage.SetSinrReception (sinr);
+        if (perTable.IsLoaded ()) {
+            // Порог SF - SNR, при котором PER пакета средней длины падает до 50%
+            double perThresholdDb[6];
+            for (uint8_t sf = 7; sf <= 12; sf++) {
+                perThresholdDb[sf - 7] = perTable.GetSnrForPerDb (sf, 1, 30 + LORA_MAC_OVERHEAD_BYTES, 0.5);
+            }
+            coverage.SetSfThresholds (perThresholdDb);
+        }
+        coverage.SetThreads (coverageThreads);
+        auto coverageStart = std::chrono::steady_clock::now ();
+        NS_ABORT_MSG_IF (!coverage.Write (coverageMap, gatewayPositions), "Не удалось записать " << coverageMap);
+        std::chrono::duration<double> coverageTime = std::chrono::steady_clock::now () - coverageStart;
+        NS_LOG_INFO("Карта покрытия " << coverageMap << ": " << coverageSize << "x" << coverageSize << " клеток, "
+                    << gatewayPositions.size () << " шлюзов, " << coverageTime.count () << " с ("
+                    << coverage.GetCells () / coverageTime.count () << " клеток/с)");
+        for (uint8_t sf = 7; sf <= 12; sf++) {
+            NS_LOG_INFO("SF" << int (sf) << ": покрыто (потери <= 10%) " << coverage.GetCoverage (sf) * 100
+                        << "% площади, среднее непокрытие " << coverage.GetMeanOutage (sf) * 100 << "%");
+        }
+        Simulator::Destroy ();
+        return 0;
+    }
+
+    // При нескольких шлюзах каждому устройству оставляем только шлюзы в пределах
+    // бюджета линии: 14 dBm до порога приема с запасом 10 dB на замирания
+    double maxRange = 0.0;
+    if (nGateways > 1 && noiseModel->IsNoiseEnabled ()) {
+        double minRxPowerDbm = noiseModel->GetNoiseFloorDbm () + noiseModel->GetSnrThreshold ();
+        maxRange = LoraGatewayGrid::RangeForLoss (14.0 - minRxPowerDbm + 10.0, 3.0, 46.0);
+        linkCache->SetMaxRange (maxRange);
+    }
+    linkCache->Install (endDevices, gateways);
+    // Состояния замираний заводятся заранее на все линии до кандидатов
+    noiseModel->ReserveFadingLinks (2 * uint64_t (endDevices.GetN ()) * linkCache->GetSlots ());
+    if (maxRange > 0) {
+        NS_LOG_INFO("Дальность отбора шлюзов: " << maxRange << " м, в среднем "
+                    << linkCache->GetMeanCandidates () << " шлюзов на устройство");
+    }
 
     // Модель задержки сигнала
     Ptr<ConstantSpeedPropagationDelayModel> delayModel = CreateObject<ConstantSpeedPropagationDelayModel> ();
 
-    // Создание беспроводного канала
-    Ptr<WirelessChannel> channel = CreateObject<WirelessChannel> ();
-    channel->SetPropagationLossModel (compositeLoss);
+    // Создание беспроводного канала. При отборе шлюзов по дальности передачи
+    // устройств уходят только шлюзам-кандидатам, а не всем PHY канала
+    Ptr<LoraCandidateChannel> candidateChannel;
+    Ptr<WirelessChannel> channel;
+    if (maxRange > 0) {
+        candidateChannel = CreateObject<LoraCandidateChannel> ();
+        channel = candidateChannel;
+    } else {
+        channel = CreateObject<WirelessChannel> ();
+    }
+    // При сборке с профилированием вся цепочка потерь меряется одной зоной
+    Ptr<PropagationLossModel> channelLoss = LoraProfilerHelper::WrapLossModel (compositeLoss);
+    channel->SetPropagationLossModel (channelLoss);
     channel->SetPropagationDelayModel (delayModel);
 
     //Создание LORAWAN стека с использованием нашего канала
@@ -147,7 +398,14 @@ int main (int argc, char *argv[])
 
     // LoRaWAN helper
     LorawanHelper helper;
-    helper.EnablePacketTracking(); // Включаем отслеживание пакетов
+    if (traceFile.empty ()) {
+        helper.EnablePacketTracking(); // Включаем отслеживание пакетов
+    }
+
+    // ACK адресуются устройствам: адреса должны быть уникальны
+    if (confirmedFraction > 0) {
+        helper.SetDeviceAddressGenerator (CreateObject<LoraDeviceAddressGenerator> (0, 1864));
+    }
 
     // Установка LoRa на устройства
     // Настройка для конечных устройств
@@ -157,15 +415,39 @@ int main (int argc, char *argv[])
     // Настройка для шлюза
     macHelper.SetDeviceType(LorawanMacHelper::GW);
     helper.Install(phyHelper, macHelper, gateways);
+    if (candidateChannel) {
+        candidateChannel->Install (endDevices, gateways, linkCache, channelLoss, delayModel);
+    }
 
     // Настройка индивидуальных параметров устройств
-    for (int i = 0; i < nDevices; i++) {
+    std::vector<DeviceRadioConfig> radioConfig = ParseDeviceConfig (deviceConfig);
+    if (restored.IsLoaded ()) {
+        radioConfig.clear ();
+        for (int i = 0; i < nDevices; i++) {
+            const LoraCheckpointDevice& d = restored.GetDevice (i);
+            NS_ABORT_MSG_IF (d.sf < 7 || d.sf > 12,
+                             "Снимок " << restoreFile << ": устройство " << i << " с SF" << unsigned (d.sf));
+            radioConfig.push_back ({uint8_t (12 - d.sf), uint8_t (d.txPowerDbm)});
+        }
+    }
+    NS_ABORT_MSG_IF (!radioConfig.empty () && radioConfig.size () != (size_t)nDevices,
+                     "deviceConfig задает " << radioConfig.size () << " устройств вместо " << nDevices);
+
+    for (uint32_t i = 0; i < endDevices.GetN (); i++) {
+        uint32_t device = deviceIndex[i];
         Ptr<Node> node = endDevices.Get(i);
         Ptr<LoraNetDevice> loraNetDev = node->GetDevice(0)->GetObject<LoraNetDevice>();
         Ptr<ClassAEndDeviceLorawanMac> edMac = loraNetDev->GetMac()->GetObject<ClassAEndDeviceLorawanMac>();
+
+        // Параметры, заданные извне (например, найденные Pso-Ga.cc)
+        if (!radioConfig.empty ()) {
+            edMac->SetDataRate(radioConfig[device].dataRate);
+            edMac->SetTransmissionPower(radioConfig[device].txPowerDbm);
+            continue;
+        }
         
         // Устанавливаем разные параметры для каждого устройства
-        switch(i) {
+        switch(device) {
             case 0: // Устройство 1 - близко к шлюзу
                 edMac->SetDataRate(5);  // SF7
                 edMac->SetTransmissionPower(14); // dBm
@@ -184,20 +466,156 @@ int main (int argc, char *argv[])
         }
     }
 
-    // Инициализация моделей шумов
-    ThermalNoiseModel thermalNoise;
-    thermalNoise.SetTemperatureCelsius(25.0);
-    thermalNoise.SetBandwidth(125000.0);
-    thermalNoise.SetNoiseFigure(3.0);
+    // Подтверждаемые пакеты: устройства равномерно по индексу, доля confirmedFraction
+    std::vector<bool> confirmed (endDevices.GetN (), false);
+    uint32_t nConfirmed = 0;
+    for (uint32_t i = 0; confirmedFraction > 0 && i < endDevices.GetN (); i++) {
+        confirmed[i] = std::floor ((i + 1) * confirmedFraction) > std::floor (i * confirmedFraction);
+        if (confirmed[i]) {
+            Ptr<ClassAEndDeviceLorawanMac> edMac = endDevices.Get (i)->GetDevice (0)->GetObject<LoraNetDevice> ()
+                                                       ->GetMac ()->GetObject<ClassAEndDeviceLorawanMac> ();
+            edMac->SetMType (LorawanMacHeader::CONFIRMED_DATA_UP);
+            edMac->SetMaxNumberOfTransmissions (maxTransmissions);
+            nConfirmed++;
+        }
+    }
 
-    AWGNModel awgnModel;
     if (enableAWGN) {
-        double thermalNoisePower = thermalNoise.GetThermalNoisePowerDbm();
-        awgnModel.SetNoisePower(thermalNoisePower);
-        NS_LOG_INFO("Тепловой шум: " << thermalNoisePower << " dBm");
+        NS_LOG_INFO("Тепловой шум: " << noiseModel->GetNoiseFloorDbm () << " dBm");
         NS_LOG_INFO("АБГШ включен");
     }
 
+    // Восходящие передачи разбираются один раз на пакет для счетчиков,
+    // трассы и метрик. С --sinr приемы и потери сообщает LoraSinrReception, а не PHY шлюзов
+    // Популяцию без узлов tracker знает по числу устройств: передачи сообщает она сама
+    LoraUplinkTracker uplinkTracker;
+    if (population) {
+        uplinkTracker.Install (uint32_t (nDevices), gateways, !sinr);
+    } else {
+        uplinkTracker.Install (endDevices, gateways, !sinr);
+    }
+    if (candidateChannel) {
+        candidateChannel->CheckCandidates (uplinkTracker);
+    }
+
+    // Счетчики по устройствам (строки RESULT для Replications.cc). Популяция
+    // считает отправки и доставки в своих массивах
+    LoraDeviceCounters deviceCounters;
+    if (!population) {
+        deviceCounters.Install (uplinkTracker);
+    }
+    for (uint32_t i = 0; restored.IsLoaded () && i < endDevices.GetN (); i++) {
+        deviceCounters.AddHistory (i, restored.GetDevice (i).sent, restored.GetDevice (i).received);
+        uplinkTracker.SetNextFrame (i, restored.GetDevice (i).fCnt);
+    }
+    if (cell >= 0) {
+        deviceCounters.SetGlobalIndices (deviceIndex);
+    }
+
+    // Решение о приеме по SINR: приемы и потери на шлюзах сообщает LoraSinrReception
+    LoraSinrReception sinrReception;
+    if (sinr) {
+        sinrReception.Install (uplinkTracker, noiseModel);
+        NS_LOG_INFO("Прием по SINR: пороги демодуляции SF7..SF12 от "
+                    << LORA_SINR_FLOOR_DB[0] << " до " << LORA_SINR_FLOOR_DB[5] << " dB");
+    }
+
+    // Пути демодуляции шлюзов: в модели SINR их занимает LoraSinrReception,
+    // иначе число путей задается PHY шлюзов ns-3
+    LoraReceptionPathPool pathPool;
+    if (sinr) {
+        pathPool.Resize (gateways.GetN (), receptionPaths);
+        sinrReception.SetReceptionPaths (&pathPool);
+    } else if (!population) {
+        pathPool.SetPhyPaths (gateways, receptionPaths);
+    }
+
+    // Трасса эфира ячейки для соседей и помехи из трасс соседних ячеек.
+    // Из соседних трасс берутся только шлюзы, которые слышат устройства ячейки
+    LoraAirtimeTraceWriter airtimeExport;
+    if (cell >= 0 && !cellExport.empty ()) {
+        std::string file = LoraCellTraceFile (cellExport, cell);
+        NS_ABORT_MSG_IF (!airtimeExport.Open (file, cell, nGateways), "Не удалось открыть " << file);
+        sinrReception.SetAirtimeExport (&airtimeExport);
+    }
+    if (cell >= 0 && !cellImport.empty ()) {
+        LoraGatewayGrid grid;
+        grid.Build (gatewayPositions, maxRange > 0 ? maxRange : HUGE_VAL);
+        std::vector<bool> heard (nGateways, maxRange <= 0);
+        for (uint32_t i = 0; i < endDevices.GetN () && maxRange > 0; i++) {
+            grid.ForEachCandidate (endDevices.Get (i)->GetObject<MobilityModel> ()->GetPosition (),
+                                   [&heard] (uint32_t g, double) { heard[g] = true; });
+        }
+        std::vector<LoraAirtimeRecord> neighbourAirtime;
+        uint32_t nNeighbours = 0;
+        for (int other = 0; other < nGateways; other++) {
+            if (other == cell || !partition.IsNeighbour (cell, other, maxRange)) {
+                continue;
+            }
+            std::string file = LoraCellTraceFile (cellImport, other);
+            NS_ABORT_MSG_IF (!LoadAirtimeTrace (file, heard, neighbourAirtime), "Не удалось прочитать " << file);
+            nNeighbours++;
+        }
+        NS_LOG_INFO("Помехи соседних ячеек: " << nNeighbours << " ячеек, " << neighbourAirtime.size ()
+                    << " передач на шлюзах ячейки");
+        sinrReception.SetExternalInterference (std::move (neighbourAirtime));
+    }
+
+    // Прием по таблице PER: по SINR - с длиной каждого пакета, иначе - со
+    // средней длиной (пакеты приложения 10..50 байт плюс заголовки MAC)
+    if (perTable.IsLoaded ()) {
+        if (sinr) {
+            sinrReception.SetPerTable (&perTable);
+        } else {
+            noiseModel->SetPerTable (&perTable, endDevices, 30 + LORA_MAC_OVERHEAD_BYTES);
+        }
+        NS_LOG_INFO("Прием по таблице PER " << perTableFile << ", отсев ниже SNR "
+                    << perTable.GetMinUsefulSnrDb () << " dB");
+    }
+
+    // Потоковая трасса пакетов вместо LoraPacketTracker (читается TraceReader.cc)
+    LoraPacketTraceWriter traceWriter;
+    if (!traceFile.empty ()) {
+        NS_ABORT_MSG_IF (!traceWriter.Open (traceFile), "Не удалось открыть " << traceFile);
+        if (noiseModel->IsNoiseEnabled ()) {
+            traceWriter.SetNoiseFloor (noiseModel->GetNoiseFloorDbm ());
+        }
+        traceWriter.Install (uplinkTracker, noiseModel);
+    }
+
+    // Метрики по окнам симулированного времени
+    LoraWindowedMetrics windowedMetrics;
+    if (metricsInterval > 0) {
+        NS_ABORT_MSG_IF (!windowedMetrics.Open (metricsFile), "Не удалось открыть " << metricsFile);
+        windowedMetrics.SetInterval (Seconds (metricsInterval));
+        windowedMetrics.SetPerDevice (metricsPerDevice);
+        NS_ABORT_MSG_IF (!windowedMetrics.SetSnrHistogram (snrHistogram), "Неверные бины SNR " << snrHistogram);
+        NS_ABORT_MSG_IF (!windowedMetrics.SetRssiHistogram (rssiHistogram), "Неверные бины RSSI " << rssiHistogram);
+        if (noiseModel->IsNoiseEnabled ()) {
+            windowedMetrics.SetNoiseFloor (noiseModel->GetNoiseFloorDbm ());
+        }
+        windowedMetrics.Install (uplinkTracker);
+    }
+
+    // Учет duty cycle по подполосам EU868 (время в эфире из таблицы)
+    LoraDutyCycle dutyCycleBudget;
+    if (dutyCycle) {
+        dutyCycleBudget.Install (uplinkTracker);
+    }
+
+    // Аналитическая оценка PDR по той же топологии и модели канала
+    AnalyticChannelParams analyticParams;
+    analyticParams.SetFromModel (noiseModel);
+    analyticParams.appPeriod = appPeriod;
+    analyticParams.sinrThresholds = sinr;
+    LoraAnalyticPdr analytic (analyticParams);
+    analytic.SetMaxRange (maxRange);
+    analytic.SetTopology (endDevices, gateways);
+    auto analyticStart = std::chrono::steady_clock::now ();
+    std::vector<double> predictedPdr = analytic.Evaluate (deviceCounters.GetSpreadingFactors (),
+                                                          deviceCounters.GetTxPowers ());
+    std::chrono::duration<double> analyticTime = std::chrono::steady_clock::now () - analyticStart;
+
     // Создание приложения
     Time appStopTime = Seconds (simulationTime);
     PeriodicSenderHelper appHelper = PeriodicSenderHelper ();
@@ -208,20 +626,125 @@ int main (int argc, char *argv[])
         "Min", DoubleValue (10), "Max", DoubleValue (50));
     appHelper.SetPacketSizeRandomVariable (rv);
 
-    ApplicationContainer appContainer = appHelper.Install (endDevices);
+    // Первые отправки продолжения по расписанию из снимка. Перед снимком
+    // задержки разыгрываются здесь, как это сделал бы PeriodicSender
+    // (U(0, период)): по ним снимок знает расписание приложений, а не только
+    // передачи PHY, которые сдвигают повторы и duty cycle MAC
+    std::vector<Time> initialDelays;
+    if (restored.IsLoaded ()) {
+        Ptr<UniformRandomVariable> delayRng = CreateObject<UniformRandomVariable> ();
+        for (int i = 0; i < nDevices; i++) {
+            initialDelays.push_back (restored.GetInitialDelay (i, delayRng));
+        }
+    } else if (!checkpointFile.empty () && !population) {
+        Ptr<UniformRandomVariable> delayRng = CreateObject<UniformRandomVariable> ();
+        for (int i = 0; i < nDevices; i++) {
+            initialDelays.push_back (Seconds (delayRng->GetValue (0, appPeriod)));
+        }
+    }
+
+    // Пакетный отправитель: тот же трафик без цепочки событий на каждое устройство
+    ApplicationContainer appContainer;
+    LoraDevicePopulation devicePopulation;
+    if (population) {
+        // Радиопараметры как у узлов: deviceConfig или три устройства из switch выше
+        auto setupStart = std::chrono::steady_clock::now ();
+        Ptr<UniformDiscPositionAllocator> disc = CreateObjectWithAttributes<UniformDiscPositionAllocator> (
+            "X", DoubleValue (0.0), "Y", DoubleValue (0.0), "rho", DoubleValue (radius));
+        if (restored.IsLoaded ()) {
+            devicePopulation.CreateDevices (nDevices, restoredPositions);
+            for (int i = 0; i < nDevices; i++) {
+                devicePopulation.AddHistory (i, restored.GetDevice (i).sent, restored.GetDevice (i).received,
+                                             restored.GetDevice (i).fCnt);
+            }
+        } else {
+            devicePopulation.CreateDevices (nDevices, disc);
+        }
+        std::vector<DeviceRadioConfig> populationRadio =
+            radioConfig.empty () ? ParseDeviceConfig ("5:14,3:10,1:6") : radioConfig;
+        for (uint32_t i = 0; i < populationRadio.size () && i < uint32_t (nDevices); i++) {
+            devicePopulation.SetRadio (i, populationRadio[i].GetSpreadingFactor (), populationRadio[i].txPowerDbm);
+        }
+        devicePopulation.SetPeriod (Seconds (appPeriod));
+        devicePopulation.SetSlot (Seconds (senderSlot));
+        devicePopulation.SetPacketSizeRandomVariable (rv);
+        for (uint32_t i = 0; i < initialDelays.size (); i++) {
+            devicePopulation.SetFirstSend (i, initialDelays[i]);
+        }
+        devicePopulation.SetFadingModel (noiseModel);
+        devicePopulation.SetLinkBudgetCache (linkCache);
+        devicePopulation.Install (uplinkTracker, gateways, compositeLoss, delayModel, maxRange);
+        devicePopulation.Start (Seconds (0), appStopTime);
+        std::chrono::duration<double> setupTime = std::chrono::steady_clock::now () - setupStart;
+        NS_LOG_INFO("Популяция: " << nDevices << " устройств, " << devicePopulation.GetMemoryBytes () / 1048576.0
+                    << " МБ, установка " << setupTime.count () << " с");
+    } else if (batchedSender) {
+        LoraBatchedSenderHelper batchedHelper;
+        batchedHelper.SetPeriod (Seconds (appPeriod));
+        batchedHelper.SetSlot (Seconds (senderSlot));
+        batchedHelper.SetPacketSizeRandomVariable (rv);
+        batchedHelper.SetInitialDelays (initialDelays);
+        appContainer = batchedHelper.Install (endDevices, gateways);
+        NS_LOG_INFO("Пакетная отправка: " << appContainer.GetN () << " отправителей, слот " << senderSlot << " с");
+    } else {
+        appContainer = appHelper.Install (endDevices);
+        for (uint32_t i = 0; i < initialDelays.size (); i++) {
+            DynamicCast<PeriodicSender> (appContainer.Get (i))->SetInitialDelay (initialDelays[i]);
+        }
+    }
     appContainer.Start (Seconds (0));
     appContainer.Stop (appStopTime);
 
-    // Подключение шлюза к серверу
+    // Подключение шлюза к серверу. Устройства популяции сервер не знает
+    // (у них нет MAC с адресом), поэтому с ней пакеты остаются на шлюзах
     NetworkServerHelper networkServerHelper;
-    networkServerHelper.SetGateways (gateways);
-    networkServerHelper.SetEndDevices (endDevices);
-    networkServerHelper.Install (gateways);
-
-    // Установка сетевых приложений
     ApplicationContainer serverContainer;
     ForwarderHelper forwarderHelper;
-    forwarderHelper.Install (gateways);
+    if (!population) {
+        networkServerHelper.SetGateways (gateways);
+        networkServerHelper.SetEndDevices (endDevices);
+        serverContainer = networkServerHelper.Install (gateways);
+
+        // Установка сетевых приложений
+        forwarderHelper.Install (gateways);
+    }
+
+    // ACK подтверждаемых пакетов планируются на шлюзах по сроку окна RX1/RX2.
+    // Сервер этим устройствам не отвечает, иначе ACK ушел бы дважды. С --sinr
+    // передачи шлюзов сообщаются модели SINR для полудуплекса
+    LoraDownlinkScheduler downlinkScheduler;
+    if (nConfirmed > 0) {
+        downlinkScheduler.Install (uplinkTracker, endDevices, gateways, confirmed);
+        Ptr<LoraDownlinkComponent> downlinkComponent = downlinkScheduler.CreateComponent ();
+        for (uint32_t k = 0; k < serverContainer.GetN (); k++) {
+            DynamicCast<NetworkServer> (serverContainer.Get (k))->AddComponent (downlinkComponent);
+        }
+        if (sinr) {
+            downlinkScheduler.TraceTransmit (MakeCallback (&LoraSinrReception::GatewayTransmitting, &sinrReception));
+        }
+        NS_LOG_INFO("Подтверждаемые пакеты: " << nConfirmed << " устройств, до " << maxTransmissions
+                    << " передач, ACK планируются шлюзами");
+    }
+
+    // ADR: наблюдения SNR в арене колец, решения пачкой раз в adrInterval,
+    // команды LinkADRReq уходят в ответах сервера
+    LoraAdrEngine adrEngine;
+    if (adr) {
+        adrEngine.SetHistory (adrHistory);
+        adrEngine.SetInterval (Seconds (adrInterval));
+        adrEngine.SetMargin (adrMargin);
+        adrEngine.SetNoiseFloor (noiseModel->GetNoiseFloorDbm ());
+        adrEngine.Install (uplinkTracker, &deviceCounters);
+        if (nConfirmed > 0) {
+            adrEngine.SetDownlinkScheduler (&downlinkScheduler);
+        }
+        Ptr<LoraAdrComponent> adrComponent = adrEngine.CreateComponent ();
+        for (uint32_t k = 0; k < serverContainer.GetN (); k++) {
+            DynamicCast<NetworkServer> (serverContainer.Get (k))->AddComponent (adrComponent);
+        }
+        NS_LOG_INFO("ADR: " << adrHistory << " наблюдений на устройство, пересчет раз в " << adrInterval
+                    << " с, запас " << adrMargin << " dB, " << adrEngine.GetMemoryBytes () / 1048576.0 << " МБ");
+    }
 
     // Дополнительная информация о канале
     NS_LOG_INFO("--- ПАРАМЕТРЫ КАНАЛА ---");
@@ -233,25 +756,188 @@ int main (int argc, char *argv[])
     // Запуск симуляции
     NS_LOG_INFO("Запуск симуляции на " << simulationTime << " секунд");
     Simulator::Stop (appStopTime + Hours (1));
+    LoraProfilerHelper::InstallScheduler (gateways);
+    if (!logFile.empty ()) {
+        NS_ABORT_MSG_IF (!LoraBinaryLog::Open (logFile), "Не удалось открыть журнал " << logFile);
+        NS_LOG_INFO("Диагностический журнал: " << logFile << ", уровень " << LORA_LOG_LEVEL);
+    }
+    auto simulationStart = std::chrono::steady_clock::now ();
     Simulator::Run ();
+    std::chrono::duration<double> simulationWallTime = std::chrono::steady_clock::now () - simulationStart;
+    BenchmarkSample benchmark = MeasureBenchmark (simulationWallTime.count (), appStopTime);
+    LoraProfilerHelper::Finish ();
+    if (!logFile.empty ()) {
+        LoraBinaryLog::Close ();
+        NS_LOG_INFO("Журнал: записей " << LoraBinaryLog::GetWritten () << ", ожиданий полного кольца "
+                    << LoraBinaryLog::GetWaits ());
+    }
+    windowedMetrics.Finish ();
+    airtimeExport.Close ();
+    for (const LoraAdrBatch& batch : adrEngine.GetBatches ()) {
+        NS_LOG_INFO("ADR " << batch.timeSeconds << " с: новых команд " << batch.decided << ", ожидают "
+                    << batch.pending << ", применено " << batch.applied << ", SF7..SF12: " << batch.perSf[0]
+                    << "/" << batch.perSf[1] << "/" << batch.perSf[2] << "/" << batch.perSf[3] << "/"
+                    << batch.perSf[4] << "/" << batch.perSf[5]);
+    }
+    if (nConfirmed > 0) {
+        NS_LOG_INFO("ACK: запрошено " << downlinkScheduler.GetRequested () << ", RX1 " << downlinkScheduler.GetSentRx1 ()
+                    << ", RX2 " << downlinkScheduler.GetSentRx2 () << ", отброшено " << downlinkScheduler.GetDropped ()
+                    << ", принято устройствами " << downlinkScheduler.GetDeviceReceived ());
+        NS_LOG_INFO("ACK: отказов шлюзам - занят " << downlinkScheduler.GetBlockedBusy () << ", duty cycle "
+                    << downlinkScheduler.GetBlockedDutyCycle () << "; наибольшая доля эфира шлюза "
+                    << 100.0 * downlinkScheduler.GetMaxGatewayDutyCycle (appStopTime) << "%");
+        NS_LOG_INFO("Потеряно восходящих пакетов во время передачи шлюза: " << downlinkScheduler.GetLostTransmitting ());
+    }
+    if (adr) {
+        NS_LOG_INFO("ADR: отправлено команд " << adrEngine.GetCommands () << ", применено " << adrEngine.GetApplied ());
+    }
+    if (candidateChannel) {
+        NS_LOG_INFO("Канал кандидатов: передач через отбор " << candidateChannel->GetFiltered ()
+                    << ", исходов приема на шлюзах " << candidateChannel->GetGatewayReceptions ()
+                    << ", из них вне кандидатов " << candidateChannel->GetOutsideCandidates ());
+    }
+    if (nMobile > 0) {
+        NS_LOG_INFO("Пересчетов потерь подвижных устройств: " << linkCache->GetRecomputes ()
+                    << " (" << linkCache->GetNMobile () << " устройств, порог " << linkUpdateDistance << " м)");
+    }
+
+    // Снимок на момент остановки приложений: следующая отправка приложения
+    // по его расписанию (первая отправка + k периодов), счетчики - за все
+    // прогоны цепочки снимков
+    if (!checkpointFile.empty ()) {
+        LoraCheckpoint snapshot;
+        snapshot.SetTime (appStopTime);
+        snapshot.SetPeriod (Seconds (appPeriod));
+        for (const Vector& pos : gatewayPositions) {
+            snapshot.AddGateway (pos);
+        }
+        int64_t stopNs = appStopTime.GetNanoSeconds ();
+        int64_t periodNs = Seconds (appPeriod).GetNanoSeconds ();
+        for (uint32_t i = 0; population && i < devicePopulation.GetN (); i++) {
+            snapshot.AddDevice (devicePopulation.GetPosition (i), devicePopulation.GetSpreadingFactor (i),
+                                devicePopulation.GetTxPower (i),
+                                NanoSeconds (devicePopulation.GetNextSendNs (i) - stopNs),
+                                devicePopulation.GetSent (i), devicePopulation.GetReceived (i),
+                                devicePopulation.GetFrameCounter (i));
+        }
+        for (uint32_t i = 0; i < endDevices.GetN (); i++) {
+            int64_t firstNs = initialDelays[i].GetNanoSeconds ();
+            int64_t periods = firstNs >= stopNs ? 0 : (stopNs - firstNs + periodNs - 1) / periodNs;
+            Time next = NanoSeconds (firstNs + periods * periodNs - stopNs);
+            snapshot.AddDevice (endDevices.Get (i)->GetObject<MobilityModel> ()->GetPosition (),
+                                deviceCounters.GetSpreadingFactor (i), deviceCounters.GetTxPowers ()[i], next,
+                                deviceCounters.GetSent (i), deviceCounters.GetReceived (i),
+                                uplinkTracker.GetNextFrame (i));
+        }
+        NS_ABORT_MSG_IF (!snapshot.Write (checkpointFile), "Не удалось записать снимок " << checkpointFile);
+        NS_LOG_INFO("Снимок сети записан в " << checkpointFile);
+    }
     Simulator::Destroy ();
 
     // Вывод результатов
-    LoraPacketTracker& tracker = helper.GetPacketTracker();
+    uint64_t sentPackets = traceWriter.GetSent ();
+    uint64_t deliveredPackets = traceWriter.GetDelivered ();
+    traceWriter.Close ();
+    if (traceFile.empty ()) {
+        LoraPacketTracker& tracker = helper.GetPacketTracker();
+        sentPackets = tracker.CountMacPacketsSent();
+        deliveredPackets = tracker.CountMacPacketsGloballyReceived();
+    }
+    // С --sinr решение о приеме принимает LoraSinrReception, а PHY шлюзов
+    // ns-3 принимают все выше порога SF12: итоги берутся из счетчиков устройств
+    if (sinr) {
+        sentPackets = deviceCounters.GetTotalSent ();
+        deliveredPackets = deviceCounters.GetTotalReceived ();
+    }
+    if (population) {
+        sentPackets = devicePopulation.GetSent ();
+        deliveredPackets = devicePopulation.GetReceived ();
+    }
     NS_LOG_INFO("--- РЕЗУЛЬТАТЫ СИМУЛЯЦИИ ---");
-    NS_LOG_INFO("Всего отправлено пакетов: " << tracker.CountMacPacketsSent());
-    NS_LOG_INFO("Успешно доставлено: " << tracker.CountMacPacketsGloballyReceived());
-    
-    double deliveryRatio = (double)tracker.CountMacPacketsGloballyReceived() / 
-                          (double)tracker.CountMacPacketsSent() * 100.0;
+    NS_LOG_INFO("Всего отправлено пакетов: " << sentPackets);
+    NS_LOG_INFO("Успешно доставлено: " << deliveredPackets);
+
+    double deliveryRatio = sentPackets > 0 ? 100.0 * deliveredPackets / sentPackets : 0.0;
     NS_LOG_INFO("Коэффициент доставки: " << deliveryRatio << "%");
+    if (sinr) {
+        NS_LOG_INFO("Прием по SINR: доставлено передач " << sinrReception.GetReceived () << ", потери: ниже порога SF "
+                    << sinrReception.GetLostUnderFloor () << ", захват " << sinrReception.GetLostInterference ()
+                    << ", передача шлюза " << sinrReception.GetLostTransmitting ()
+                    << ", максимум одновременных приемов " << sinrReception.GetMaxActive ());
+    }
+    if (sinr || !population) {
+        NS_LOG_INFO("Пути демодуляции: " << pathPool.GetPathsPerGateway () << " на шлюз, потеряно без пути "
+                    << pathPool.GetLostNoPath () << ", шлюзов в насыщении " << pathPool.GetSaturatedGateways ());
+    }
+    if (sinr) {
+        uint32_t peakBusy = 0;
+        for (uint32_t g = 0; g < pathPool.GetNGateways (); g++) {
+            peakBusy = std::max (peakBusy, pathPool.GetPeakBusy (g));
+        }
+        NS_LOG_INFO("Наибольшее число занятых путей шлюза: " << peakBusy);
+    }
+    if (cell >= 0) {
+        NS_LOG_INFO("Ячейка " << cell << ": записей трассы эфира " << airtimeExport.GetRecords ()
+                    << ", передач соседних ячеек " << sinrReception.GetExternal ());
+    }
+    if (batchedSender) {
+        uint64_t wakeups = 0;
+        for (uint32_t k = 0; k < appContainer.GetN (); k++) {
+            wakeups += DynamicCast<LoraBatchedSender> (appContainer.Get (k))->GetWakeups ();
+        }
+        NS_LOG_INFO("Пробуждений пакетного отправителя: " << wakeups);
+    }
+    if (dutyCycle) {
+        NS_LOG_INFO("Duty cycle: передач " << dutyCycleBudget.GetTransmissions () << ", сверх бюджета "
+                    << dutyCycleBudget.GetViolations () << ", вне подполос EU868 " << dutyCycleBudget.GetOutOfBand ()
+                    << ", наибольшая доля эфира устройства "
+                    << 100.0 * dutyCycleBudget.GetMaxDeviceDutyCycle (appStopTime) << "%");
+    }
+
+    if (population) {
+        NS_LOG_INFO("Пробуждений популяции: " << devicePopulation.GetWakeups () << ", симуляция "
+                    << simulationWallTime.count () << " с");
+        devicePopulation.Print (std::cout);
+    } else {
+        AnalyticErrorReport analyticError = CompareWithSimulation (predictedPdr, deviceCounters);
+        NS_LOG_INFO("Аналитическая оценка: " << analyticError.predictedPdr << "%, симуляция: "
+                    << analyticError.measuredPdr << "%");
+        NS_LOG_INFO("Ошибка по устройствам: средняя " << analyticError.meanAbsError
+                    << " п.п., максимальная " << analyticError.maxAbsError << " п.п.");
+        NS_LOG_INFO("Время: аналитика " << analyticTime.count () * 1e6 << " мкс, симуляция "
+                    << simulationWallTime.count () << " с");
+        deviceCounters.Print (std::cout);
+    }
+    PrintBenchmark (std::cout, benchmark);
+    if (LORA_PROFILE_ENABLED) {
+        NS_LOG_INFO("--- ПРОФИЛЬ ПО КОМПОНЕНТАМ ---");
+        for (const LoraProfileLine& line : LoraProfiler::GetBreakdown ()) {
+            NS_LOG_INFO(LORA_PROFILE_ZONE_DESCRIPTIONS[line.zone] << ": собственное " << line.selfMs << " мс ("
+                        << 100.0 * line.selfMs / (simulationWallTime.count () * 1e3) << "%), полное "
+                        << line.totalMs << " мс, вызовов " << line.calls);
+        }
+        // Зону ставит только собственный код: PeriodicSender и MAC модуля
+        // lorawan не правятся, и их Send остается внутри событий устройств
+        if (!batchedSender && !population) {
+            NS_LOG_INFO("Отправка MAC из PeriodicSender в зону не выделяется и входит в события устройств");
+        }
+        NS_ABORT_MSG_IF (!LoraProfiler::WriteFoldedStacks (profileFile), "Не удалось записать " << profileFile);
+        NS_LOG_INFO("Свернутые стеки профиля: " << profileFile);
+    }
+    if (cell < 0 && !population) {
+        PrintTopology (std::cout, endDevices, gateways);
+        PrintChannel (std::cout, analyticParams);
+    }
     
-    for (int i = 0; i < nDevices; i++) {
+    for (uint32_t i = 0; i < endDevices.GetN (); i++) {
         Ptr<Node> node = endDevices.Get(i);
         Vector pos = node->GetObject<MobilityModel>()->GetPosition();
-        double distance = sqrt(pos.x * pos.x + pos.y * pos.y);
-        NS_LOG_INFO("Устройство " << i << " позиция: (" << pos.x << ", " << pos.y 
-                    << "), расстояние до шлюза: " << distance << " м");
+        double distance = HUGE_VAL;
+        for (uint32_t g = 0; g < gateways.GetN (); g++) {
+            distance = std::min (distance, CalculateDistance (pos, gateways.Get (g)->GetObject<MobilityModel> ()->GetPosition ()));
+        }
+        NS_LOG_INFO("Устройство " << deviceIndex[i] << " позиция: (" << pos.x << ", " << pos.y 
+                    << "), расстояние до ближайшего шлюза: " << distance << " м");
     }
 
     return 0;
@@ -0,0 +1,241 @@
+#include "ns3/core-module.h"
+#include "ns3/log.h"
+
+#include "lora-replication.h"
+#include "lora-benchmark.h"
+
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("LoraBenchmark");
+
+// Пример:
+//   ./ns3 run "scratch/Benchmark --scenarios=build/scratch/ns3.46-devices-default,build/scratch/ns3.46-VM_NIR-default
+//              --nDevices=3,100,1000,10000,100000 --output=bench.csv"
+//   ./ns3 run "scratch/Benchmark ... --baseline=bench.csv --tolerance=0.1"
+// Точки запускаются последовательно, чтобы замеры не мешали друг другу.
+// VM_NIR* запускаются как есть (шум и замирания у каждого свои), devices -
+// со всеми вариантами --deviceVariants.
+
+// Одна точка сетки: сценарий, вариант аргументов, число устройств, период
+struct BenchmarkPoint
+{
+    std::string scenario;
+    std::string variant;
+    uint32_t nDevices;
+    double appPeriod;
+    bool ok;
+    BenchmarkSample sample;
+    uint64_t sent;
+    uint64_t received;
+
+    std::string Key() const
+    {
+        std::ostringstream key;
+        key << scenario << "|" << variant << "|" << nDevices << "|" << appPeriod;
+        return key.str();
+    }
+
+    double Pdr() const { return sent > 0 ? 100.0 * received / sent : 0.0; }
+};
+
+static std::vector<std::string>
+SplitList (const std::string& list, char separator)
+{
+    std::vector<std::string> items;
+    std::istringstream stream (list);
+    std::string item;
+    while (std::getline (stream, item, separator)) {
+        items.push_back (item);
+    }
+    return items;
+}
+
+// Имя сценария без каталога, чтобы базовая линия не зависела от пути сборки
+static std::string
+ScenarioName (const std::string& path)
+{
+    size_t slash = path.find_last_of ('/');
+    return slash == std::string::npos ? path : path.substr (slash + 1);
+}
+
+static const char* CSV_HEADER =
+    "scenario,variant,n_devices,app_period,simulated_s,wall_s,wall_per_sim_hour_s,events,events_per_s,"
+    "peak_rss_kb,sent,received,pdr\n";
+
+static void
+WriteCsvRow (std::ofstream& csv, const BenchmarkPoint& p)
+{
+    csv << p.scenario << "," << p.variant << "," << p.nDevices << "," << p.appPeriod << ","
+        << p.sample.simulatedSeconds << "," << p.sample.wallSeconds << "," << p.sample.WallPerSimulatedHour () << ","
+        << p.sample.events << "," << p.sample.EventsPerSecond () << "," << p.sample.peakRssKb << ","
+        << p.sent << "," << p.received << "," << p.Pdr () << "\n";
+}
+
+// Чтение файла результатов предыдущего запуска (того же формата)
+static std::map<std::string, BenchmarkPoint>
+ReadBaseline (const std::string& filename)
+{
+    std::map<std::string, BenchmarkPoint> baseline;
+    std::ifstream csv (filename);
+    std::string line;
+    std::getline (csv, line); // Заголовок
+    while (std::getline (csv, line)) {
+        std::vector<std::string> f = SplitList (line, ',');
+        if (f.size () < 13) {
+            continue;
+        }
+        BenchmarkPoint p;
+        p.scenario = f[0];
+        p.variant = f[1];
+        p.nDevices = std::stoul (f[2]);
+        p.appPeriod = std::stod (f[3]);
+        p.sample.simulatedSeconds = std::stod (f[4]);
+        p.sample.wallSeconds = std::stod (f[5]);
+        p.sample.events = std::stoull (f[7]);
+        p.sample.peakRssKb = std::stoull (f[9]);
+        p.sent = std::stoull (f[10]);
+        p.received = std::stoull (f[11]);
+        p.ok = true;
+        baseline[p.Key ()] = p;
+    }
+    return baseline;
+}
+
+int main (int argc, char *argv[])
+{
+    // Параметры
+    std::string scenarios = "";     // Исполняемые файлы сценариев через запятую
+    std::string nDevicesList = "3,100,1000,10000,100000";
+    std::string appPeriodList = "600";
+    std::string deviceVariants = "--enableFading=true --enableAWGN=true;--enableFading=true --enableAWGN=false;"
+                                 "--enableFading=false --enableAWGN=true;--enableFading=false --enableAWGN=false";
+    double simulationTime = 3600;   // Симулированное время каждой точки, с
+    uint32_t repeats = 1;           // Повторы точки, берется самый быстрый
+    std::string output = "benchmark.csv";
+    std::string baselineFile = "";  // Результаты для сравнения (пусто - без сравнения)
+    double tolerance = 0.1;         // Допустимое замедление относительно базовой линии
+    double memoryTolerance = 0.1;   // Допустимый рост пиковой памяти
+
+    CommandLine cmd (__FILE__);
+    cmd.AddValue ("scenarios", "Исполняемые файлы сценариев через запятую", scenarios);
+    cmd.AddValue ("nDevices", "Числа устройств через запятую", nDevicesList);
+    cmd.AddValue ("appPeriods", "Периоды отправки через запятую, с", appPeriodList);
+    cmd.AddValue ("deviceVariants", "Варианты аргументов devices через ';'", deviceVariants);
+    cmd.AddValue ("simulationTime", "Симулированное время каждой точки, с", simulationTime);
+    cmd.AddValue ("repeats", "Повторы каждой точки (берется минимальное время)", repeats);
+    cmd.AddValue ("output", "Файл CSV с результатами", output);
+    cmd.AddValue ("baseline", "Файл CSV базовой линии для поиска регрессий", baselineFile);
+    cmd.AddValue ("tolerance", "Допустимое относительное замедление", tolerance);
+    cmd.AddValue ("memoryTolerance", "Допустимый относительный рост пиковой памяти", memoryTolerance);
+    cmd.Parse (argc, argv);
+
+    LogComponentEnable ("LoraBenchmark", LOG_LEVEL_INFO);
+
+    NS_ABORT_MSG_IF (scenarios.empty (), "Не задан --scenarios");
+    repeats = std::max (repeats, 1u);
+
+    // Сетка точек
+    std::vector<BenchmarkPoint> points;
+    std::vector<std::string> commands;
+    for (const std::string& scenario : SplitList (scenarios, ',')) {
+        std::vector<std::string> variants (1, "");
+        if (ScenarioName (scenario).find ("devices") != std::string::npos) {
+            variants = SplitList (deviceVariants, ';');
+        }
+        for (const std::string& variant : variants) {
+            for (const std::string& n : SplitList (nDevicesList, ',')) {
+                for (const std::string& period : SplitList (appPeriodList, ',')) {
+                    BenchmarkPoint p;
+                    p.scenario = ScenarioName (scenario);
+                    p.variant = variant;
+                    p.nDevices = std::stoul (n);
+                    p.appPeriod = std::stod (period);
+                    p.ok = false;
+                    p.sent = p.received = 0;
+                    points.push_back (p);
+                    commands.push_back (scenario + " --nDevices=" + n + " --appPeriod=" + period +
+                                        " --simulationTime=" + std::to_string (simulationTime) + " " +
+                                        variant + " --RngRun=1 2>/dev/null");
+                }
+            }
+        }
+    }
+
+    std::ofstream csv (output);
+    csv << CSV_HEADER;
+
+    NS_LOG_INFO("Точек: " << points.size () << ", повторов каждой: " << repeats);
+    for (size_t i = 0; i < points.size (); i++) {
+        BenchmarkPoint& p = points[i];
+        std::string out;
+        for (uint32_t r = 0; r < repeats; r++) {
+            BenchmarkSample sample;
+            if (RunProcess (commands[i], out) != 0 || !ParseBenchmark (out, sample)) {
+                continue;
+            }
+            if (!p.ok || sample.wallSeconds < p.sample.wallSeconds) {
+                p.sample = sample;
+                p.ok = true;
+                ReplicationResult result;
+                result.devices = ParseDeviceResults (out);
+                p.sent = result.GetSent ();
+                p.received = result.GetReceived ();
+            }
+        }
+        if (!p.ok) {
+            NS_LOG_INFO(p.scenario << " " << p.variant << " nDevices=" << p.nDevices << ": ошибка запуска");
+            continue;
+        }
+        NS_LOG_INFO(std::fixed << std::setprecision (3) << p.scenario << " " << p.variant
+                    << " nDevices=" << p.nDevices << " appPeriod=" << p.appPeriod << ": "
+                    << p.sample.WallPerSimulatedHour () << " с на час, "
+                    << std::setprecision (0) << p.sample.EventsPerSecond () << " событий/с, "
+                    << p.sample.peakRssKb / 1024 << " МБ, PDR " << std::setprecision (2) << p.Pdr () << "%");
+        WriteCsvRow (csv, p);
+        csv.flush ();
+    }
+    NS_LOG_INFO("Результаты записаны в " << output);
+
+    if (baselineFile.empty ()) {
+        return 0;
+    }
+
+    // Сравнение с базовой линией: время на симулированный час не должно
+    // вырасти больше чем на tolerance, пиковая память - больше чем на
+    // memoryTolerance; число событий при том же RngRun меняется только при
+    // изменении модели
+    std::map<std::string, BenchmarkPoint> baseline = ReadBaseline (baselineFile);
+    uint32_t regressions = 0;
+    for (const BenchmarkPoint& p : points) {
+        auto it = baseline.find (p.Key ());
+        if (!p.ok || it == baseline.end ()) {
+            continue;
+        }
+        const BenchmarkPoint& b = it->second;
+        double ratio = p.sample.WallPerSimulatedHour () / b.sample.WallPerSimulatedHour ();
+        if (ratio > 1.0 + tolerance) {
+            regressions++;
+            NS_LOG_INFO("РЕГРЕССИЯ " << p.scenario << " " << p.variant << " nDevices=" << p.nDevices
+                        << ": " << std::setprecision (3) << b.sample.WallPerSimulatedHour () << " -> "
+                        << p.sample.WallPerSimulatedHour () << " с на час (x" << ratio << ")");
+        }
+        if (b.sample.peakRssKb > 0 && p.sample.peakRssKb > (1.0 + memoryTolerance) * b.sample.peakRssKb) {
+            regressions++;
+            NS_LOG_INFO("РЕГРЕССИЯ ПАМЯТИ " << p.scenario << " " << p.variant << " nDevices=" << p.nDevices
+                        << ": " << b.sample.peakRssKb / 1024 << " -> " << p.sample.peakRssKb / 1024 << " МБ (x"
+                        << std::setprecision (3) << double (p.sample.peakRssKb) / b.sample.peakRssKb << ")");
+        }
+        if (p.sample.events != b.sample.events) {
+            NS_LOG_INFO("Изменилось число событий " << p.scenario << " " << p.variant << " nDevices="
+                        << p.nDevices << ": " << b.sample.events << " -> " << p.sample.events);
+        }
+    }
+    NS_LOG_INFO("Регрессий: " << regressions);
+
+    return regressions > 0 ? 2 : 0;
+}
@@ -0,0 +1,155 @@
+#include "ns3/core-module.h"
+#include "ns3/log.h"
+
+#include "lora-chirp.h"
+
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("LoraChirpPer");
+
+// Пример:
+//   ./ns3 run "scratch/ChirpPer --sf=7,8,9,10,11,12 --cr=1,4 --snrMin=-25 --snrMax=0 --packets=2000"
+//   python3 Python/export_chirps.py --sf=8 --fs=1e6 --output=chirps.txt
+//   ./ns3 run "scratch/ChirpPer --validate=chirps.txt"
+// Точки (SF, CR, SNR) независимы и считаются параллельно на всех ядрах.
+
+// Одна точка кривой
+struct PerPoint
+{
+    uint8_t sf;
+    uint8_t cr;
+    double snrDb;
+    LoraErrorRates rates;
+};
+
+static std::vector<std::string>
+SplitList (const std::string& list, char separator)
+{
+    std::vector<std::string> items;
+    std::istringstream stream (list);
+    std::string item;
+    while (std::getline (stream, item, separator)) {
+        if (!item.empty ()) {
+            items.push_back (item);
+        }
+    }
+    return items;
+}
+
+// Сверка с эталоном из Python/export_chirps.py (ValidateLoraChirps)
+static bool
+ValidateAgainstReference (const std::string& filename)
+{
+    std::ifstream in (filename);
+    NS_ABORT_MSG_IF (!in, "Не удалось открыть " << filename);
+
+    LoraChirpValidation result = ValidateLoraChirps (in);
+    for (const LoraChirpValidation::Mismatch& miss : result.mismatches) {
+        NS_LOG_INFO("SF" << miss.sf << " символ " << miss.symbol << ": демодулирован как " << miss.decided);
+    }
+    NS_LOG_INFO("Символов сверено: " << result.blocks << ", расхождений символов: " << result.mismatches.size ()
+                << ", неверных блоков: " << result.badBlocks << ", максимальная ошибка отсчета: "
+                << std::scientific << result.maxError);
+    return result.Passed ();
+}
+
+int main (int argc, char *argv[])
+{
+    // Параметры
+    std::string sfList = "7,8,9,10,11,12";
+    std::string crList = "1";       // 1..4 - кодовая скорость 4/5..4/8
+    double snrMin = -25;            // SNR в полосе сигнала, дБ
+    double snrMax = 0;
+    double snrStep = 1;
+    uint32_t packets = 1000;        // Пакетов в точке
+    uint32_t payload = 20;          // Длина полезной нагрузки, байт
+    bool fading = false;            // Рэлеевские замирания на пакет
+    uint32_t jobs = 0;              // Число потоков (0 - по числу ядер)
+    uint32_t seed = 1;
+    std::string output = "per.csv";
+    std::string validate = "";      // Эталонные отсчеты loramod (пусто - без сверки)
+
+    CommandLine cmd (__FILE__);
+    cmd.AddValue ("sf", "SF через запятую", sfList);
+    cmd.AddValue ("cr", "CR через запятую (1..4)", crList);
+    cmd.AddValue ("snrMin", "Минимальный SNR, дБ", snrMin);
+    cmd.AddValue ("snrMax", "Максимальный SNR, дБ", snrMax);
+    cmd.AddValue ("snrStep", "Шаг SNR, дБ", snrStep);
+    cmd.AddValue ("packets", "Число пакетов в точке", packets);
+    cmd.AddValue ("payload", "Длина полезной нагрузки, байт", payload);
+    cmd.AddValue ("fading", "Рэлеевские замирания на пакет", fading);
+    cmd.AddValue ("jobs", "Число потоков", jobs);
+    cmd.AddValue ("seed", "Начальное значение генератора", seed);
+    cmd.AddValue ("output", "Файл CSV с кривыми SER/PER", output);
+    cmd.AddValue ("validate", "Файл эталонных отсчетов из Python/export_chirps.py", validate);
+    cmd.Parse (argc, argv);
+
+    LogComponentEnable ("LoraChirpPer", LOG_LEVEL_INFO);
+
+    if (!validate.empty ()) {
+        bool ok = ValidateAgainstReference (validate);
+        NS_LOG_INFO(ok ? "Сверка с loramod пройдена" : "Сверка с loramod НЕ пройдена");
+        return ok ? 0 : 1;
+    }
+
+    if (jobs == 0) {
+        jobs = std::max (1u, std::thread::hardware_concurrency ());
+    }
+
+    std::vector<PerPoint> points;
+    for (const std::string& sf : SplitList (sfList, ',')) {
+        for (const std::string& cr : SplitList (crList, ',')) {
+            for (double snr = snrMin; snr <= snrMax + 1e-9; snr += snrStep) {
+                PerPoint p;
+                p.sf = std::stoul (sf);
+                p.cr = std::stoul (cr);
+                p.snrDb = snr;
+                NS_ABORT_MSG_IF (p.sf < 6 || p.sf > 12 || p.cr < 1 || p.cr > 4,
+                                 "Недопустимые SF" << sf << " / CR" << cr);
+                points.push_back (p);
+            }
+        }
+    }
+
+    NS_LOG_INFO("Точек: " << points.size () << ", пакетов в точке: " << packets << ", потоков: " << jobs);
+
+    // Потоки разбирают точки по общему счетчику; у каждой точки свой
+    // генератор, поэтому результат не зависит от числа потоков
+    std::atomic<size_t> next (0);
+    std::mutex logMutex;
+    std::vector<std::thread> workers;
+    for (uint32_t j = 0; j < jobs; j++) {
+        workers.emplace_back ([&] () {
+            for (size_t i = next++; i < points.size (); i = next++) {
+                PerPoint& p = points[i];
+                p.rates = SimulateLoraErrorRates (p.sf, p.cr, p.snrDb, payload, packets, fading,
+                                                  uint64_t (seed) << 32 | i);
+                std::lock_guard<std::mutex> lock (logMutex);
+                NS_LOG_INFO("SF" << unsigned (p.sf) << " CR4/" << 4 + p.cr << " SNR " << std::fixed
+                            << std::setprecision (1) << p.snrDb << " дБ: SER " << std::scientific
+                            << std::setprecision (3) << p.rates.GetSer () << ", PER " << p.rates.GetPer ());
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join ();
+    }
+
+    std::ofstream csv (output);
+    csv << "sf,cr,snr_db,symbols,symbol_errors,ser,packets,packet_errors,per\n";
+    for (const PerPoint& p : points) {
+        csv << unsigned (p.sf) << "," << unsigned (p.cr) << "," << p.snrDb << "," << p.rates.symbols << ","
+            << p.rates.symbolErrors << "," << p.rates.GetSer () << "," << p.rates.packets << ","
+            << p.rates.packetErrors << "," << p.rates.GetPer () << "\n";
+    }
+    NS_LOG_INFO("Кривые записаны в " << output);
+
+    return 0;
+}
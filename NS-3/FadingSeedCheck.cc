@@ -0,0 +1,66 @@
+#include "ns3/core-module.h"
+#include "ns3/log.h"
+
+#include "lora-block-fading.h"
+
+#include <vector>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("LoraFadingSeedCheck");
+
+// Пример:
+//   ./ns3 run "scratch/FadingSeedCheck"
+// Проверка засева блочных замираний без AssignStreams, как в сценариях:
+// один и тот же --RngRun повторяет последовательность, разные - различаются,
+// а линии первых устройств не меняются, когда устройств в сети больше.
+
+// Коэффициенты линий устройство-шлюз 0 первых links из nDevices устройств
+static std::vector<double>
+Draw (uint64_t run, uint32_t links, uint32_t nDevices, uint32_t perLink)
+{
+    RngSeedManager::SetRun (run);
+    LoraBlockFading fading;
+    fading.SetMeanPowerGain (2.0);
+    std::vector<double> gains;
+    for (uint32_t k = 0; k < perLink; k++) {
+        for (uint32_t device = 0; device < nDevices; device++) {
+            double gainDb = fading.GetGainDb (LoraBlockFading::LinkKey (device, 0, true), Seconds (k));
+            if (device < links) {
+                gains.push_back (gainDb);
+            }
+        }
+    }
+    return gains;
+}
+
+int main (int argc, char *argv[])
+{
+    // Параметры
+    uint32_t links = 100;           // Линий устройство-шлюз
+    uint32_t perLink = 10;          // Коэффициентов на линию
+
+    CommandLine cmd (__FILE__);
+    cmd.AddValue ("links", "Число линий", links);
+    cmd.AddValue ("perLink", "Коэффициентов на линию", perLink);
+    cmd.Parse (argc, argv);
+
+    LogComponentEnable ("LoraFadingSeedCheck", LOG_LEVEL_INFO);
+
+    std::vector<double> run1 = Draw (1, links, links, perLink);
+    std::vector<double> run1Again = Draw (1, links, links, perLink);
+    std::vector<double> run1More = Draw (1, links, 3 * links, perLink);
+    std::vector<double> run2 = Draw (2, links, links, perLink);
+
+    uint32_t equal = 0;
+    for (size_t i = 0; i < run1.size (); i++) {
+        equal += run1[i] == run2[i];
+    }
+    NS_ABORT_MSG_IF (run1 != run1Again, "Один и тот же RngRun дал разные замирания");
+    NS_ABORT_MSG_IF (run1 != run1More, "Замирания первых устройств сдвинулись при большем числе устройств");
+    NS_ABORT_MSG_IF (equal > 0, "RngRun 1 и 2 совпали в " << equal << " из " << run1.size () << " коэффициентов");
+    NS_LOG_INFO("Замирания: " << run1.size () << " коэффициентов, RngRun 1 повторяется и не зависит "
+                "от числа устройств, RngRun 2 отличается");
+    return 0;
+}
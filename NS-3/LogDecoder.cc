@@ -0,0 +1,90 @@
+#include "ns3/core-module.h"
+#include "ns3/log.h"
+
+#include "lora-binary-log.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("LoraLogDecoder");
+
+// Пример:
+//   CXXFLAGS="-DLORA_LOG_LEVEL=4" ./ns3 configure && ./ns3 build
+//   ./ns3 run "scratch/devices --nDevices=10000 --logFile=debug.blg"
+//   ./ns3 run "scratch/LogDecoder --input=debug.blg --component=LoraNoiseFading --output=debug.txt"
+// Строка вывода: "<время, с> <компонент> узел <n>: <сообщение>". Записи разных
+// потоков идут пачками сброса, внутри потока - по времени.
+
+int main (int argc, char *argv[])
+{
+    // Параметры
+    std::string input = "";     // Файл журнала
+    std::string output = "";    // Текстовый вывод (пусто - stdout)
+    std::string component = ""; // Только этот компонент (пусто - все)
+    double from = 0;            // Окно по симулированному времени, с
+    double to = -1;             // Конец окна (отрицательное - до конца)
+
+    CommandLine cmd (__FILE__);
+    cmd.AddValue ("input", "Файл двоичного журнала", input);
+    cmd.AddValue ("output", "Текстовый файл сообщений (пусто - stdout)", output);
+    cmd.AddValue ("component", "Компонент, например LoraNoiseFading (пусто - все)", component);
+    cmd.AddValue ("from", "Начало окна, с", from);
+    cmd.AddValue ("to", "Конец окна, с (отрицательное - до конца)", to);
+    cmd.Parse (argc, argv);
+
+    LogComponentEnable ("LoraLogDecoder", LOG_LEVEL_INFO);
+
+    LoraBinaryLogReader reader;
+    NS_ABORT_MSG_IF (!reader.Open (input), "Не удалось прочитать журнал " << input);
+    NS_ABORT_MSG_IF (reader.GetHeader ().nEvents > LORA_LOG_EVENTS_COUNT,
+                     "Журнал записан более новой версией: событий " << reader.GetHeader ().nEvents);
+
+    int componentFilter = -1;
+    for (int c = 0; c < LORA_LOG_COMPONENTS && !component.empty (); c++) {
+        if (component == LORA_LOG_COMPONENT_NAMES[c]) {
+            componentFilter = c;
+        }
+    }
+    NS_ABORT_MSG_IF (!component.empty () && componentFilter < 0, "Неизвестный компонент " << component);
+
+    std::ofstream file;
+    if (!output.empty ()) {
+        file.open (output);
+        NS_ABORT_MSG_IF (!file, "Не удалось открыть " << output);
+    }
+    std::ostream& out = output.empty () ? std::cout : file;
+
+    LoraLogRecord record;
+    std::vector<uint64_t> perEvent (LORA_LOG_EVENTS_COUNT, 0);
+    uint64_t nRecords = 0;
+    uint64_t nPrinted = 0;
+    while (reader.Next (record)) {
+        nRecords++;
+        double time = record.timeNs * 1e-9;
+        if ((componentFilter >= 0 && record.component != componentFilter) || time < from || (to >= 0 && time > to)) {
+            continue;
+        }
+        if (record.event < LORA_LOG_EVENTS_COUNT) {
+            perEvent[record.event]++;
+        }
+        out << time << " "
+            << (record.component < LORA_LOG_COMPONENTS ? LORA_LOG_COMPONENT_NAMES[record.component] : "?")
+            << " узел " << record.context << ": " << LoraLogFormat (record) << "\n";
+        nPrinted++;
+    }
+
+    NS_LOG_INFO("Журнал: " << nRecords << " записей, выведено " << nPrinted);
+    for (uint32_t e = 0; e < LORA_LOG_EVENTS_COUNT; e++) {
+        if (perEvent[e] > 0) {
+            NS_LOG_INFO(LORA_LOG_COMPONENT_NAMES[LORA_LOG_EVENTS[e].component] << " событие " << e << ": "
+                        << perEvent[e]);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include "ns3/core-module.h"
+#include "ns3/log.h"
+
+#include "lora-replication.h"
+#include "lora-benchmark.h"
+#include "lora-cell-partition.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("LoraPartitioned");
+
+// Пример:
+//   ./ns3 run "scratch/Partitioned --scenario=build/scratch/ns3.46-devices-default --nGateways=64
+//              --args='--nDevices=200000 --radius=20000 --batchedSender=true'"
+// Каждая ячейка шлюза - отдельный процесс devices с --cell=<k>. Первый проход
+// пишет трассы эфира ячеек, второй повторяет ячейки с помехами из трасс
+// соседей. Итоговые строки RESULT объединяются в один отчет PDR и печатаются
+// в том же формате, поэтому Partitioned можно запускать из Replications.
+
+// Итог одного процесса ячейки
+struct CellRun
+{
+    int exitStatus = -1;
+    std::vector<DeviceResult> devices;
+    BenchmarkSample benchmark;
+};
+
+// Пул из jobs потоков; ячейки запускаются по очереди номеров
+static std::vector<CellRun>
+RunCells (const std::vector<std::string>& commands, unsigned jobs)
+{
+    std::vector<CellRun> runs (commands.size ());
+    std::atomic<size_t> next (0);
+    auto worker = [&] () {
+        std::string output;
+        for (size_t i = next++; i < commands.size (); i = next++) {
+            runs[i].exitStatus = RunProcess (commands[i], output);
+            runs[i].devices = ParseDeviceResults (output);
+            ParseBenchmark (output, runs[i].benchmark);
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned j = 0; j < std::max (1u, std::min<unsigned> (jobs, commands.size ())); j++) {
+        pool.emplace_back (worker);
+    }
+    for (std::thread& t : pool) {
+        t.join ();
+    }
+    return runs;
+}
+
+// Один проход по всем ячейкам; false, если хоть одна ячейка упала
+static bool
+RunPass (const std::string& command, uint32_t nCells, const std::string& extra, unsigned jobs,
+         std::vector<CellRun>& runs, double& wallSeconds)
+{
+    std::vector<std::string> commands;
+    for (uint32_t k = 0; k < nCells; k++) {
+        commands.push_back (command + " --cell=" + std::to_string (k) + extra);
+    }
+    auto start = std::chrono::steady_clock::now ();
+    runs = RunCells (commands, jobs);
+    wallSeconds = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+    bool ok = true;
+    for (uint32_t k = 0; k < nCells; k++) {
+        if (runs[k].exitStatus != 0) {
+            NS_LOG_INFO("Ячейка " << k << " завершилась с ошибкой (статус " << runs[k].exitStatus << ")");
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main (int argc, char *argv[])
+{
+    // Параметры
+    std::string scenario = "";      // Путь к собранному сценарию devices
+    std::string scenarioArgs = "";  // Дополнительные аргументы сценария
+    uint32_t nGateways = 4;         // Число шлюзов = число ячеек
+    uint32_t jobs = 0;              // Число параллельных процессов (0 - по числу ядер)
+    bool interference = true;       // Второй проход с помехами соседних ячеек
+    std::string tracePrefix = "cell"; // Префикс файлов трасс эфира
+    bool keepTraces = false;        // Не удалять трассы эфира после прогона
+    std::string output = "";        // CSV с PDR по ячейкам (пусто - не писать)
+
+    CommandLine cmd (__FILE__);
+    cmd.AddValue ("scenario", "Исполняемый файл сценария devices", scenario);
+    cmd.AddValue ("args", "Аргументы, передаваемые сценарию", scenarioArgs);
+    cmd.AddValue ("nGateways", "Количество шлюзов (ячеек)", nGateways);
+    cmd.AddValue ("jobs", "Число одновременно работающих процессов", jobs);
+    cmd.AddValue ("interference", "Учитывать помехи соседних ячеек вторым проходом", interference);
+    cmd.AddValue ("tracePrefix", "Префикс файлов трасс эфира ячеек", tracePrefix);
+    cmd.AddValue ("keepTraces", "Оставить файлы трасс эфира", keepTraces);
+    cmd.AddValue ("output", "Файл CSV с PDR по ячейкам", output);
+    cmd.Parse (argc, argv);
+
+    LogComponentEnable ("LoraPartitioned", LOG_LEVEL_INFO);
+
+    NS_ABORT_MSG_IF (scenario.empty (), "Не задан --scenario");
+    NS_ABORT_MSG_IF (nGateways == 0, "Нужен хотя бы один шлюз");
+    if (jobs == 0) {
+        jobs = std::max (1u, std::thread::hardware_concurrency ());
+    }
+
+    // Все ячейки одного прогона видят одну расстановку: RngRun передается дальше
+    std::string command = scenario + " " + scenarioArgs + " --sinr=true --nGateways=" +
+                          std::to_string (nGateways) + " --RngRun=" +
+                          std::to_string (RngSeedManager::GetRun ());
+    NS_LOG_INFO("Разбиение на " << nGateways << " ячеек, " << jobs << " процессов: " << command);
+
+    // Проход 1: ячейки независимо, запись трасс эфира
+    std::vector<CellRun> runs;
+    double exportWall = 0;
+    bool ok = RunPass (command, nGateways, " --cellExport=" + tracePrefix, jobs, runs, exportWall);
+    double totalWall = exportWall;
+    double cellSeconds = 0;
+    for (const CellRun& r : runs) {
+        cellSeconds += r.benchmark.wallSeconds;
+    }
+
+    // Проход 2: те же ячейки с помехами соседей из трасс первого прохода
+    if (ok && interference && nGateways > 1) {
+        double importWall = 0;
+        ok = RunPass (command, nGateways, " --cellImport=" + tracePrefix, jobs, runs, importWall);
+        totalWall += importWall;
+        for (const CellRun& r : runs) {
+            cellSeconds += r.benchmark.wallSeconds;
+        }
+    }
+
+    if (!keepTraces) {
+        for (uint32_t k = 0; k < nGateways; k++) {
+            std::remove (LoraCellTraceFile (tracePrefix, k).c_str ());
+        }
+    }
+    NS_ABORT_MSG_IF (!ok, "Не все ячейки завершились успешно");
+
+    // Объединение: устройства ячеек не пересекаются, номера глобальные
+    std::vector<DeviceResult> devices;
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    std::map<uint32_t, std::pair<uint64_t, uint64_t>> perSf;
+    for (const CellRun& r : runs) {
+        for (const DeviceResult& d : r.devices) {
+            devices.push_back (d);
+            sent += d.sent;
+            received += d.received;
+            perSf[d.sf].first += d.sent;
+            perSf[d.sf].second += d.received;
+        }
+    }
+    std::sort (devices.begin (), devices.end (),
+               [] (const DeviceResult& a, const DeviceResult& b) { return a.device < b.device; });
+
+    NS_LOG_INFO("=== РЕЗУЛЬТАТЫ ПО ЯЧЕЙКАМ ===");
+    NS_LOG_INFO("Устройств: " << devices.size () << ", отправлено " << sent << ", доставлено " << received);
+    NS_LOG_INFO("Коэффициент доставки: " << std::fixed << std::setprecision (2)
+                << (sent > 0 ? 100.0 * received / sent : 0.0) << "%");
+    for (const auto& sf : perSf) {
+        NS_LOG_INFO("SF" << sf.first << ": " << (sf.second.first > 0 ? 100.0 * sf.second.second / sf.second.first : 0.0)
+                    << "% (" << sf.second.first << " пакетов)");
+    }
+    // Доля параллельности: сумма времени Simulator::Run по ячейкам к общему времени
+    NS_LOG_INFO("Время: " << totalWall << " с, сумма по ячейкам " << cellSeconds << " с, ускорение "
+                << (totalWall > 0 ? cellSeconds / totalWall : 0.0) << " на " << jobs << " процессах");
+
+    if (!output.empty ()) {
+        std::ofstream csv (output);
+        csv << "cell,devices,sent,received,pdr,wall\n";
+        for (uint32_t k = 0; k < nGateways; k++) {
+            uint64_t s = 0;
+            uint64_t d = 0;
+            for (const DeviceResult& r : runs[k].devices) {
+                s += r.sent;
+                d += r.received;
+            }
+            csv << k << "," << runs[k].devices.size () << "," << s << "," << d << ","
+                << (s > 0 ? 100.0 * d / s : 0.0) << "," << runs[k].benchmark.wallSeconds << "\n";
+        }
+        NS_LOG_INFO("PDR по ячейкам записан в " << output);
+    }
+
+    for (const DeviceResult& d : devices) {
+        std::cout << "RESULT device=" << d.device << " sf=" << d.sf << " sent=" << d.sent
+                  << " received=" << d.received << "\n";
+    }
+    std::cout.flush ();
+    return 0;
+}
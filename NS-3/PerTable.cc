@@ -0,0 +1,79 @@
+#include "ns3/core-module.h"
+#include "ns3/log.h"
+
+#include "lora-per-table.h"
+
+#include <iomanip>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("LoraPerTableGenerator");
+
+// Пример:
+//   ./ns3 run "scratch/PerTable --output=per.bin"
+//   ./ns3 run "scratch/devices --nDevices=1000 --perTable=per.bin"
+// Таблица строится по аналитическим SER/PER (lora-per-table.h) и не требует
+// внешних данных. С --input печатается сводка по готовому файлу.
+
+int main (int argc, char *argv[])
+{
+    // Параметры
+    std::string output = "per.bin";
+    std::string input = "";         // Проверить существующую таблицу вместо построения
+    double snrMin = -30;            // dB
+    double snrMax = 10;
+    double snrStep = 0.1;
+    uint32_t maxLength = 255;       // Наибольшая PHY-нагрузка, байт
+    uint32_t lengthStep = 8;        // Ширина бина длины, байт
+    uint32_t payload = 30 + LORA_MAC_OVERHEAD_BYTES; // Длина для сводки, байт
+
+    CommandLine cmd (__FILE__);
+    cmd.AddValue ("output", "Файл таблицы PER", output);
+    cmd.AddValue ("input", "Открыть готовую таблицу и напечатать сводку", input);
+    cmd.AddValue ("snrMin", "Нижняя граница SNR, dB", snrMin);
+    cmd.AddValue ("snrMax", "Верхняя граница SNR, dB", snrMax);
+    cmd.AddValue ("snrStep", "Шаг SNR, dB", snrStep);
+    cmd.AddValue ("maxLength", "Наибольшая длина PHY-нагрузки, байт", maxLength);
+    cmd.AddValue ("lengthStep", "Ширина бина длины, байт", lengthStep);
+    cmd.AddValue ("payload", "Длина пакета для сводки, байт", payload);
+    cmd.Parse (argc, argv);
+
+    LogComponentEnable ("LoraPerTableGenerator", LOG_LEVEL_INFO);
+
+    LoraPerTable table;
+    if (input.empty ()) {
+        NS_ABORT_MSG_IF (snrStep <= 0 || snrMax <= snrMin || lengthStep == 0, "Неверные границы таблицы");
+        table.Generate (snrMin, snrMax, snrStep, maxLength, lengthStep);
+        NS_ABORT_MSG_IF (!table.Write (output), "Не удалось записать " << output);
+        NS_LOG_INFO("Таблица записана в " << output);
+    } else {
+        NS_ABORT_MSG_IF (!table.Open (input), "Не удалось открыть таблицу PER " << input);
+    }
+
+    const LoraPerTableHeader& h = table.GetHeader ();
+    NS_LOG_INFO("SNR " << h.snrMinDb << ".." << h.snrMinDb + (h.nSnr - 1) * h.snrStepDb << " dB, шаг "
+                << h.snrStepDb << ", длины до " << h.nLength * h.lengthStep << " байт, шаг " << h.lengthStep
+                << ", размер " << (h.headerSize + size_t (h.nSf) * h.nCr * h.nLength * h.nSnr * sizeof (float)) / 1024
+                << " КБ");
+
+    // SNR, при котором PER падает до 50% и 1%, для CR 4/5 и заданной длины
+    for (uint8_t sf = 7; sf <= 12; sf++) {
+        double snr50 = NAN;
+        double snr1 = NAN;
+        for (double snr = h.snrMinDb; snr <= h.snrMinDb + (h.nSnr - 1) * h.snrStepDb; snr += 0.05) {
+            double per = table.Lookup (sf, 1, payload, snr);
+            if (std::isnan (snr50) && per <= 0.5) {
+                snr50 = snr;
+            }
+            if (std::isnan (snr1) && per <= 0.01) {
+                snr1 = snr;
+            }
+        }
+        NS_LOG_INFO("SF" << unsigned (sf) << ", " << payload << " байт: PER 50% при " << std::fixed
+                    << std::setprecision (2) << snr50 << " dB, PER 1% при " << snr1 << " dB");
+    }
+    NS_LOG_INFO("Отсев ниже SNR " << table.GetMinUsefulSnrDb () << " dB");
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "lora-per-table.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+using namespace lorawan;
+
+// Проверка LoraPerTable без ns-3:
+//   g++ -O2 -std=c++17 -o per-table-check NS-3/PerTableCheck.cc
+//   ./per-table-check [временный файл]
+// Таблица строится Generate, записывается и открывается через mmap. Lookup
+// должен совпадать с LoraPacketErrorRate в узлах, линейно интерполировать
+// между ними и прижимать SNR и длину к краям. Обрезанный файл и файл с
+// чужой сигнатурой Open должен отклонить. Код возврата 0 - все проверки пройдены.
+
+static uint32_t failures = 0;
+
+static void
+Check (bool condition, const std::string& what)
+{
+    if (!condition) {
+        std::printf ("ОШИБКА: %s\n", what.c_str ());
+        failures++;
+    }
+}
+
+static bool
+Near (double a, double b)
+{
+    return std::fabs (a - b) <= 1e-6;
+}
+
+// Копия файла: первые size байт и, если задано, другая сигнатура
+static void
+WriteCopy (const std::string& from, const std::string& to, size_t size, const char* magic = nullptr)
+{
+    std::ifstream in (from, std::ios::binary);
+    std::vector<char> bytes ((std::istreambuf_iterator<char> (in)), std::istreambuf_iterator<char> ());
+    bytes.resize (std::min (size, bytes.size ()));
+    if (magic != nullptr) {
+        std::memcpy (bytes.data (), magic, 8);
+    }
+    std::ofstream out (to, std::ios::binary);
+    out.write (bytes.data (), bytes.size ());
+}
+
+int main (int argc, char *argv[])
+{
+    std::string file = argc > 1 ? argv[1] : "per-table-check.bin";
+    std::string broken = file + ".broken";
+
+    // SNR -20..10 dB с шагом 1, длины до 64 байт бинами по 8
+    const double snrMin = -20;
+    const double snrMax = 10;
+    const uint32_t lengthStep = 8;
+    LoraPerTable generated;
+    generated.Generate (snrMin, snrMax, 1.0, 64, lengthStep);
+    Check (generated.Write (file), "запись " + file);
+
+    LoraPerTable table;
+    Check (table.Open (file), "открытие " + file);
+    if (!table.IsLoaded ()) {
+        return 1;
+    }
+    const LoraPerTableHeader& h = table.GetHeader ();
+    Check (h.nSnr == 31 && h.nLength == 8, "размеры таблицы");
+
+    for (uint8_t sf = 7; sf <= 12; sf++) {
+        for (uint8_t cr = 1; cr <= 4; cr++) {
+            std::string point = "SF" + std::to_string (sf) + " CR" + std::to_string (cr);
+            // Узлы: значение модели для длины верхней границы бина
+            for (uint32_t k = 0; k < h.nSnr; k++) {
+                double snrDb = snrMin + k;
+                double expected = float (LoraPacketErrorRate (sf, cr, 2 * lengthStep, snrDb));
+                Check (Near (table.Lookup (sf, cr, 2 * lengthStep, snrDb), expected),
+                       point + " узел SNR " + std::to_string (snrDb));
+                // Любая длина бина дает то же значение
+                Check (table.Lookup (sf, cr, lengthStep + 1, snrDb) == table.Lookup (sf, cr, 2 * lengthStep, snrDb),
+                       point + " бин длины");
+            }
+            // Интерполяция между узлами
+            for (uint32_t k = 0; k + 1 < h.nSnr; k++) {
+                double a = table.Lookup (sf, cr, 20, snrMin + k);
+                double b = table.Lookup (sf, cr, 20, snrMin + k + 1);
+                Check (Near (table.Lookup (sf, cr, 20, snrMin + k + 0.25), a + 0.25 * (b - a)),
+                       point + " интерполяция у SNR " + std::to_string (snrMin + k));
+            }
+            // Края: SNR и длина прижимаются к крайним бинам
+            Check (table.Lookup (sf, cr, 20, snrMin - 15) == table.Lookup (sf, cr, 20, snrMin), point + " SNR ниже");
+            Check (table.Lookup (sf, cr, 20, snrMax + 15) == table.Lookup (sf, cr, 20, snrMax), point + " SNR выше");
+            Check (table.Lookup (sf, cr, 0, 0) == table.Lookup (sf, cr, 1, 0), point + " нулевая длина");
+            Check (table.Lookup (sf, cr, 1000, 0) == table.Lookup (sf, cr, 64, 0), point + " длина выше");
+        }
+    }
+
+    // Обрезанный файл, файл из одного заголовка и чужая сигнатура
+    size_t fullSize = h.headerSize + size_t (h.nSf) * h.nCr * h.nLength * h.nSnr * sizeof (float);
+    LoraPerTable rejected;
+    WriteCopy (file, broken, fullSize - sizeof (float));
+    Check (!rejected.Open (broken), "обрезанный на один float файл открылся");
+    WriteCopy (file, broken, h.headerSize);
+    Check (!rejected.Open (broken), "файл из одного заголовка открылся");
+    WriteCopy (file, broken, sizeof (LoraPerTableHeader) - 1);
+    Check (!rejected.Open (broken), "файл короче заголовка открылся");
+    WriteCopy (file, broken, fullSize, "LORAPER0");
+    Check (!rejected.Open (broken), "файл с чужой сигнатурой открылся");
+    WriteCopy (file, broken, fullSize);
+    Check (rejected.Open (broken), "полная копия не открылась");
+
+    std::remove (broken.c_str ());
+    std::remove (file.c_str ());
+    std::printf (failures == 0 ? "Проверка пройдена\n" : "Проверка НЕ пройдена: %u ошибок\n", failures);
+    return failures == 0 ? 0 : 1;
+}
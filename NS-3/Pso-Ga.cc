@@ -0,0 +1,385 @@
+#include "ns3/core-module.h"
+#include "ns3/log.h"
+
+#include "lora-analytic-pdr.h"
+#include "lora-device-config.h"
+#include "lora-replication.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("LoraPsoGa");
+
+// Гибридный оптимизатор PSO-GA для выбора SF и мощности каждого устройства.
+// Каждая частица - назначение DR:мощность для всех устройств; приспособленность
+// оценивается запуском сценария (devices.cc с --deviceConfig) в пуле процессов
+// или, с --surrogate, аналитической моделью LoraAnalyticPdr по топологии сценария.
+// Все назначения проверяются на одних и тех же RngRun, поэтому одинаковые
+// геномы дают одинаковый результат и берутся из кэша.
+
+// Допустимые значения параметров (EU868)
+static const int MIN_DATA_RATE = 0;    // SF12
+static const int MAX_DATA_RATE = 5;    // SF7
+static const int MIN_TX_POWER = 2;     // dBm
+static const int MAX_TX_POWER = 14;    // dBm
+static const double MEAN_PAYLOAD = 30; // Средний размер пакета (10-50 байт), байт
+
+// Оценка приспособленности: доля доставленных пакетов минус штраф за энергию.
+// Энергия нормирована на случай, когда все устройства работают на SF12 и 14 dBm.
+class FitnessEvaluator
+{
+public:
+    FitnessEvaluator (const std::string& command, uint32_t runs, unsigned jobs, double energyWeight)
+        : command (command), runs (runs), jobs (jobs), energyWeight (energyWeight),
+          surrogate (nullptr), cacheHits (0), evaluations (0)
+    {
+    }
+
+    // Аналитическая модель вместо запуска сценария
+    void SetSurrogate (const LoraAnalyticPdr* analytic) { surrogate = analytic; }
+
+    // Оценивает все геномы; новые уникальные геномы запускаются параллельно
+    std::vector<double> Evaluate (const std::vector<std::vector<DeviceRadioConfig>>& genomes)
+    {
+        std::vector<std::string> keys;
+        std::vector<std::string> pendingKeys;
+        std::vector<const std::vector<DeviceRadioConfig>*> pendingGenomes;
+        std::unordered_set<std::string> pendingSet;
+        for (const std::vector<DeviceRadioConfig>& genome : genomes) {
+            keys.push_back (FormatDeviceConfig (genome));
+            if (cache.count (keys.back ()) || !pendingSet.insert (keys.back ()).second) {
+                cacheHits++;
+            } else {
+                pendingKeys.push_back (keys.back ());
+                pendingGenomes.push_back (&genome);
+            }
+        }
+
+        std::vector<double> pendingFitness (pendingKeys.size ());
+        if (surrogate != nullptr) {
+            EvaluateSurrogate (pendingGenomes, pendingFitness);
+        } else {
+            std::vector<std::string> commands;
+            for (const std::string& key : pendingKeys) {
+                for (uint32_t run = 1; run <= runs; run++) {
+                    commands.push_back (command + " --deviceConfig=" + key + " --RngRun=" + std::to_string (run));
+                }
+            }
+            std::vector<ReplicationResult> results = RunCommands (commands, jobs);
+
+            for (size_t g = 0; g < pendingKeys.size (); g++) {
+                std::vector<ReplicationResult> genomeResults (results.begin () + g * runs,
+                                                              results.begin () + (g + 1) * runs);
+                pendingFitness[g] = Fitness (*pendingGenomes[g], genomeResults);
+            }
+        }
+
+        for (size_t g = 0; g < pendingKeys.size (); g++) {
+            cache[pendingKeys[g]] = pendingFitness[g];
+            evaluations++;
+        }
+
+        std::vector<double> fitness;
+        for (const std::string& key : keys) {
+            fitness.push_back (cache[key]);
+        }
+        return fitness;
+    }
+
+    uint64_t GetCacheHits () const { return cacheHits; }
+    uint64_t GetEvaluations () const { return evaluations; }
+
+private:
+    // Геномы делятся между потоками; каждый поток сам вызывает Evaluate модели
+    void EvaluateSurrogate (const std::vector<const std::vector<DeviceRadioConfig>*>& genomes,
+                            std::vector<double>& fitness) const
+    {
+        std::atomic<size_t> next (0);
+        auto worker = [&] () {
+            std::vector<uint8_t> sf;
+            std::vector<double> power;
+            for (size_t g = next++; g < genomes.size (); g = next++) {
+                const std::vector<DeviceRadioConfig>& genome = *genomes[g];
+                sf.resize (genome.size ());
+                power.resize (genome.size ());
+                for (size_t i = 0; i < genome.size (); i++) {
+                    sf[i] = genome[i].GetSpreadingFactor ();
+                    power[i] = genome[i].txPowerDbm;
+                }
+                std::vector<double> pdr = surrogate->Evaluate (sf, power);
+                // Каждое устройство отправляет одинаковое число пакетов
+                double energy = 0;
+                for (size_t i = 0; i < genome.size (); i++) {
+                    energy += PacketEnergy (genome[i]);
+                }
+                fitness[g] = LoraAnalyticPdr::NetworkPdr (pdr) -
+                             energyWeight * energy / (genome.size () * MaxPacketEnergy ());
+            }
+        };
+        std::vector<std::thread> pool;
+        for (unsigned j = 0; j < std::min<size_t> (jobs, genomes.size ()); j++) {
+            pool.emplace_back (worker);
+        }
+        for (std::thread& t : pool) {
+            t.join ();
+        }
+    }
+
+    static double PacketEnergy (const DeviceRadioConfig& c)
+    {
+        return pow (10.0, c.txPowerDbm / 10.0) * LoraTimeOnAir (c.GetSpreadingFactor (), MEAN_PAYLOAD);
+    }
+
+    static double MaxPacketEnergy ()
+    {
+        return pow (10.0, MAX_TX_POWER / 10.0) * LoraTimeOnAir (12, MEAN_PAYLOAD);
+    }
+
+    double Fitness (const std::vector<DeviceRadioConfig>& genome,
+                    const std::vector<ReplicationResult>& results) const
+    {
+        double sent = 0;
+        double received = 0;
+        double energy = 0;
+        for (const ReplicationResult& r : results) {
+            if (!r.IsOk ()) {
+                return -1.0; // Сценарий не отработал: худшая оценка
+            }
+            for (const DeviceResult& d : r.devices) {
+                sent += d.sent;
+                received += d.received;
+                energy += d.sent * PacketEnergy (genome[d.device]);
+            }
+        }
+        if (sent == 0) {
+            return -1.0;
+        }
+        return received / sent - energyWeight * energy / (sent * MaxPacketEnergy ());
+    }
+
+    std::string command;
+    uint32_t runs;
+    unsigned jobs;
+    double energyWeight;
+    const LoraAnalyticPdr* surrogate;
+    std::unordered_map<std::string, double> cache;
+    uint64_t cacheHits;
+    uint64_t evaluations;
+};
+
+// Частица: по две координаты на устройство (DR, мощность)
+struct Particle
+{
+    std::vector<double> position;
+    std::vector<double> velocity;
+    std::vector<double> bestPosition;
+    double fitness;
+    double bestFitness;
+};
+
+static std::vector<DeviceRadioConfig>
+Decode (const std::vector<double>& position)
+{
+    std::vector<DeviceRadioConfig> genome (position.size () / 2);
+    for (size_t i = 0; i < genome.size (); i++) {
+        int dataRate = std::clamp ((int)std::floor (position[2 * i]), MIN_DATA_RATE, MAX_DATA_RATE);
+        int power = std::clamp (2 * (int)std::lround (position[2 * i + 1] / 2), MIN_TX_POWER, MAX_TX_POWER);
+        genome[i] = {uint8_t (dataRate), uint8_t (power)};
+    }
+    return genome;
+}
+
+static void
+ClampPosition (std::vector<double>& position)
+{
+    for (size_t i = 0; i < position.size (); i += 2) {
+        position[i] = std::clamp (position[i], (double)MIN_DATA_RATE, MAX_DATA_RATE + 0.999);
+        position[i + 1] = std::clamp (position[i + 1], (double)MIN_TX_POWER, (double)MAX_TX_POWER);
+    }
+}
+
+int main (int argc, char *argv[])
+{
+    // Параметры
+    std::string scenario = "";      // Путь к собранному сценарию devices.cc
+    std::string scenarioArgs = "";  // Дополнительные аргументы сценария
+    uint32_t nDevices = 3;          // Количество устройств
+    uint32_t particles = 40;        // Размер роя
+    uint32_t iterations = 50;       // Количество итераций
+    uint32_t runs = 1;              // Повторов сценария на оценку
+    uint32_t jobs = 0;              // Число параллельных процессов (0 - по числу ядер)
+    double energyWeight = 0.2;      // Вес штрафа за энергию
+    double inertia = 0.7;           // Инерция PSO
+    double cognitive = 1.5;         // Притяжение к личному лучшему
+    double social = 1.5;            // Притяжение к глобальному лучшему
+    double gaFraction = 0.2;        // Доля худших частиц, заменяемых потомками GA
+    double mutationRate = 0.05;     // Вероятность мутации параметров устройства
+    uint32_t seed = 1;              // Seed оптимизатора
+    bool surrogate = false;         // Аналитическая оценка вместо запуска сценария
+
+    CommandLine cmd (__FILE__);
+    cmd.AddValue ("scenario", "Исполняемый файл сценария devices.cc", scenario);
+    cmd.AddValue ("args", "Аргументы, передаваемые сценарию", scenarioArgs);
+    cmd.AddValue ("nDevices", "Количество устройств", nDevices);
+    cmd.AddValue ("particles", "Размер роя", particles);
+    cmd.AddValue ("iterations", "Количество итераций", iterations);
+    cmd.AddValue ("runs", "Повторов сценария (RngRun 1..runs) на одну оценку", runs);
+    cmd.AddValue ("jobs", "Число одновременно работающих процессов", jobs);
+    cmd.AddValue ("energyWeight", "Вес штрафа за энергию", energyWeight);
+    cmd.AddValue ("inertia", "Инерция PSO", inertia);
+    cmd.AddValue ("cognitive", "Коэффициент личного лучшего", cognitive);
+    cmd.AddValue ("social", "Коэффициент глобального лучшего", social);
+    cmd.AddValue ("gaFraction", "Доля частиц, заменяемых скрещиванием", gaFraction);
+    cmd.AddValue ("mutationRate", "Вероятность мутации", mutationRate);
+    cmd.AddValue ("seed", "Seed оптимизатора", seed);
+    cmd.AddValue ("surrogate", "Оценивать аналитической моделью по топологии сценария", surrogate);
+    cmd.Parse (argc, argv);
+
+    LogComponentEnable ("LoraPsoGa", LOG_LEVEL_INFO);
+
+    NS_ABORT_MSG_IF (scenario.empty (), "Не задан --scenario");
+    NS_ABORT_MSG_IF (particles == 0, "Рой должен содержать хотя бы одну частицу");
+    if (jobs == 0) {
+        jobs = std::max (1u, std::thread::hardware_concurrency ());
+    }
+
+    std::string command = scenario + " " + scenarioArgs + " --nDevices=" + std::to_string (nDevices);
+    FitnessEvaluator evaluator (command, runs, jobs, energyWeight);
+
+    // Топология и параметры канала (шум, порог, замирания, период) берутся
+    // из одного запуска сценария с теми же аргументами
+    std::unique_ptr<LoraAnalyticPdr> analytic;
+    if (surrogate) {
+        std::string output;
+        int status = RunProcess (command + " --RngRun=1", output);
+        NS_ABORT_MSG_IF (status != 0, "Сценарий завершился с кодом " << status << ": " << command);
+        std::vector<Vector> devicePositions;
+        std::vector<Vector> gatewayPositions;
+        ParseTopology (output, devicePositions, gatewayPositions);
+        NS_ABORT_MSG_IF (devicePositions.size () != nDevices || gatewayPositions.empty (),
+                         "Сценарий не вывел топологию (строки POSITION/GATEWAY)");
+        AnalyticChannelParams params;
+        NS_ABORT_MSG_IF (!ParseChannel (output, params), "Сценарий не вывел параметры канала (строка CHANNEL)");
+        analytic.reset (new LoraAnalyticPdr (params));
+        analytic->SetTopology (devicePositions, gatewayPositions);
+        evaluator.SetSurrogate (analytic.get ());
+        NS_LOG_INFO("Аналитическая оценка по топологии из " << devicePositions.size () << " устройств, шум "
+                    << params.noiseFloorDbm << " dBm, порог SNR " << params.snrThresholdDb << " dB, замирания "
+                    << (params.enableFading ? "вкл" : "выкл"));
+    }
+    std::mt19937_64 rng (seed);
+    std::uniform_real_distribution<double> unit (0.0, 1.0);
+
+    NS_LOG_INFO("=== PSO-GA: " << particles << " частиц, " << nDevices << " устройств, "
+                << jobs << " процессов ===");
+
+    // Начальный рой
+    std::vector<Particle> swarm (particles);
+    for (Particle& p : swarm) {
+        p.position.resize (2 * nDevices);
+        p.velocity.assign (2 * nDevices, 0.0);
+        for (uint32_t i = 0; i < nDevices; i++) {
+            p.position[2 * i] = MIN_DATA_RATE + unit (rng) * (MAX_DATA_RATE + 1 - MIN_DATA_RATE);
+            p.position[2 * i + 1] = MIN_TX_POWER + unit (rng) * (MAX_TX_POWER - MIN_TX_POWER);
+        }
+        p.bestPosition = p.position;
+        p.fitness = p.bestFitness = -HUGE_VAL;
+    }
+    std::vector<double> globalBest = swarm[0].position;
+    double globalBestFitness = -HUGE_VAL;
+
+    for (uint32_t it = 0; it < iterations; it++) {
+        // Параллельная оценка всего роя
+        std::vector<std::vector<DeviceRadioConfig>> genomes;
+        for (const Particle& p : swarm) {
+            genomes.push_back (Decode (p.position));
+        }
+        std::vector<double> fitness = evaluator.Evaluate (genomes);
+
+        for (uint32_t k = 0; k < particles; k++) {
+            Particle& p = swarm[k];
+            p.fitness = fitness[k];
+            if (p.fitness > p.bestFitness) {
+                p.bestFitness = p.fitness;
+                p.bestPosition = p.position;
+            }
+            if (p.fitness > globalBestFitness) {
+                globalBestFitness = p.fitness;
+                globalBest = p.position;
+            }
+        }
+
+        NS_LOG_INFO("Итерация " << it << ": лучшая приспособленность " << globalBestFitness
+                    << ", оценок " << evaluator.GetEvaluations ()
+                    << ", попаданий в кэш " << evaluator.GetCacheHits ());
+
+        // GA: худшие частицы заменяются потомками личных лучших решений
+        std::vector<uint32_t> order (particles);
+        for (uint32_t k = 0; k < particles; k++) {
+            order[k] = k;
+        }
+        std::sort (order.begin (), order.end (),
+                   [&swarm] (uint32_t a, uint32_t b) { return swarm[a].fitness > swarm[b].fitness; });
+        uint32_t nChildren = std::min ((uint32_t)(gaFraction * particles), particles - 1);
+        std::uniform_int_distribution<uint32_t> pick (0, particles - nChildren - 1);
+        auto tournament = [&] () -> const Particle& {
+            const Particle& a = swarm[order[pick (rng)]];
+            const Particle& b = swarm[order[pick (rng)]];
+            return a.bestFitness > b.bestFitness ? a : b;
+        };
+        for (uint32_t c = 0; c < nChildren; c++) {
+            Particle& child = swarm[order[particles - 1 - c]];
+            const Particle& mother = tournament ();
+            const Particle& father = tournament ();
+            for (uint32_t i = 0; i < nDevices; i++) {
+                // Равномерное скрещивание по устройствам: DR и мощность наследуются вместе
+                const Particle& parent = unit (rng) < 0.5 ? mother : father;
+                child.position[2 * i] = parent.bestPosition[2 * i];
+                child.position[2 * i + 1] = parent.bestPosition[2 * i + 1];
+                if (unit (rng) < mutationRate) {
+                    child.position[2 * i] = MIN_DATA_RATE + unit (rng) * (MAX_DATA_RATE + 1 - MIN_DATA_RATE);
+                    child.position[2 * i + 1] = MIN_TX_POWER + unit (rng) * (MAX_TX_POWER - MIN_TX_POWER);
+                }
+            }
+            std::fill (child.velocity.begin (), child.velocity.end (), 0.0);
+            // Личный лучший заменяемой частицы к потомку не относится: его
+            // займет собственная позиция потомка после оценки
+            child.bestPosition = child.position;
+            child.fitness = child.bestFitness = -HUGE_VAL;
+        }
+
+        // PSO: сдвиг остальных частиц
+        for (uint32_t k = 0; k < particles - nChildren; k++) {
+            Particle& p = swarm[order[k]];
+            for (size_t d = 0; d < p.position.size (); d++) {
+                p.velocity[d] = inertia * p.velocity[d] +
+                                cognitive * unit (rng) * (p.bestPosition[d] - p.position[d]) +
+                                social * unit (rng) * (globalBest[d] - p.position[d]);
+                p.position[d] += p.velocity[d];
+            }
+            ClampPosition (p.position);
+        }
+    }
+
+    // Результаты
+    std::string best = FormatDeviceConfig (Decode (globalBest));
+    NS_LOG_INFO("=== РЕЗУЛЬТАТЫ PSO-GA ===");
+    NS_LOG_INFO("Лучшая приспособленность: " << globalBestFitness);
+    NS_LOG_INFO("Оценок сценария: " << evaluator.GetEvaluations () << ", из кэша: " << evaluator.GetCacheHits ());
+    std::vector<DeviceRadioConfig> bestGenome = Decode (globalBest);
+    for (uint32_t i = 0; i < nDevices; i++) {
+        NS_LOG_INFO("Устройство " << i << ": SF" << unsigned(bestGenome[i].GetSpreadingFactor ())
+                    << ", мощность " << unsigned(bestGenome[i].txPowerDbm) << "dBm");
+    }
+    std::cout << "BEST deviceConfig=" << best << std::endl;
+
+    return 0;
+}
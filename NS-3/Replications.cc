@@ -0,0 +1,108 @@
+#include "ns3/core-module.h"
+#include "ns3/log.h"
+
+#include "lora-replication.h"
+
+#include <fstream>
+#include <iomanip>
+#include <thread>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("LoraReplications");
+
+// Пример:
+//   ./ns3 run "scratch/Replications --scenario=build/scratch/ns3.46-VM_NIR-default --runs=64"
+// Каждый повтор запускается отдельным процессом сценария с --RngRun=<firstRun + k>.
+
+static void
+LogInterval (const std::string& name, const ConfidenceInterval& ci, double confidence)
+{
+    NS_LOG_INFO(name << ": " << std::fixed << std::setprecision(2) << ci.mean << "% ± "
+                << ci.halfWidth << "% (" << confidence * 100 << "% ДИ, n=" << ci.n << ")");
+}
+
+static void
+WriteCsvRow (std::ofstream& csv, const std::string& group, uint32_t key, const ConfidenceInterval& ci)
+{
+    csv << group << "," << key << "," << ci.n << "," << ci.mean << "," << ci.stddev << ","
+        << ci.mean - ci.halfWidth << "," << ci.mean + ci.halfWidth << "\n";
+}
+
+int main (int argc, char *argv[])
+{
+    // Параметры
+    std::string scenario = "";      // Путь к собранному сценарию
+    std::string scenarioArgs = "";  // Дополнительные аргументы сценария
+    uint32_t runs = 32;             // Количество повторов
+    uint32_t firstRun = 1;          // RngRun первого повтора
+    uint32_t jobs = 0;              // Число параллельных процессов (0 - по числу ядер)
+    double confidence = 0.95;       // Уровень доверия
+    std::string output = "";        // CSV с итогами (пусто - не писать)
+
+    CommandLine cmd (__FILE__);
+    cmd.AddValue ("scenario", "Исполняемый файл сценария (VM_NIR, VM_NIR_1, VM_NIR_2, devices)", scenario);
+    cmd.AddValue ("args", "Аргументы, передаваемые сценарию", scenarioArgs);
+    cmd.AddValue ("runs", "Количество независимых повторов", runs);
+    cmd.AddValue ("firstRun", "RngRun первого повтора", firstRun);
+    cmd.AddValue ("jobs", "Число одновременно работающих процессов", jobs);
+    cmd.AddValue ("confidence", "Уровень доверия интервалов", confidence);
+    cmd.AddValue ("output", "Файл CSV с итогами", output);
+    cmd.Parse (argc, argv);
+
+    LogComponentEnable ("LoraReplications", LOG_LEVEL_INFO);
+
+    NS_ABORT_MSG_IF (scenario.empty (), "Не задан --scenario");
+    if (jobs == 0) {
+        jobs = std::max (1u, std::thread::hardware_concurrency ());
+    }
+
+    std::vector<uint64_t> runIds;
+    for (uint32_t k = 0; k < runs; k++) {
+        runIds.push_back (firstRun + k);
+    }
+
+    std::string command = scenario + " " + scenarioArgs;
+    NS_LOG_INFO("Запуск " << runs << " повторов на " << jobs << " процессах: " << command);
+
+    std::vector<ReplicationResult> results = RunReplications (command, runIds, jobs);
+
+    uint32_t failed = 0;
+    for (const ReplicationResult& r : results) {
+        if (!r.IsOk ()) {
+            failed++;
+            NS_LOG_INFO("Повтор RngRun=" << r.run << " завершился с ошибкой (статус " << r.exitStatus << ")");
+        }
+    }
+
+    PdrSamples samples = CollectPdrSamples (results);
+
+    // Результаты
+    NS_LOG_INFO("=== РЕЗУЛЬТАТЫ ПОВТОРОВ ===");
+    NS_LOG_INFO("Успешных повторов: " << runs - failed << " из " << runs);
+    ConfidenceInterval total = MeanConfidenceInterval (samples.total, confidence);
+    LogInterval ("Коэффициент доставки", total, confidence);
+    for (const auto& sf : samples.perSf) {
+        LogInterval ("SF" + std::to_string (sf.first), MeanConfidenceInterval (sf.second, confidence), confidence);
+    }
+    for (const auto& device : samples.perDevice) {
+        LogInterval ("Устройство " + std::to_string (device.first),
+                     MeanConfidenceInterval (device.second, confidence), confidence);
+    }
+
+    if (!output.empty ()) {
+        std::ofstream csv (output);
+        csv << "group,key,n,mean_pdr,stddev,ci_low,ci_high\n";
+        WriteCsvRow (csv, "total", 0, total);
+        for (const auto& sf : samples.perSf) {
+            WriteCsvRow (csv, "sf", sf.first, MeanConfidenceInterval (sf.second, confidence));
+        }
+        for (const auto& device : samples.perDevice) {
+            WriteCsvRow (csv, "device", device.first, MeanConfidenceInterval (device.second, confidence));
+        }
+        NS_LOG_INFO("Итоги записаны в " << output);
+    }
+
+    return failed == runs ? 1 : 0;
+}
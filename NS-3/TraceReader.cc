@@ -0,0 +1,142 @@
+#include "ns3/core-module.h"
+#include "ns3/log.h"
+
+#include "lora-packet-trace.h"
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+using namespace lorawan;
+
+NS_LOG_COMPONENT_DEFINE ("LoraTraceReader");
+
+// Пример:
+//   ./ns3 run "scratch/devices --nDevices=1000 --simulationTime=604800 --traceFile=week.trc"
+//   ./ns3 run "scratch/TraceReader --input=week.trc"
+// Итоги совпадают с выводом сценария ("Всего отправлено пакетов", "Коэффициент доставки").
+
+int main (int argc, char *argv[])
+{
+    // Параметры
+    std::string input = "";     // Файл трассы
+    bool perDevice = false;     // Печатать строки RESULT по устройствам
+
+    CommandLine cmd (__FILE__);
+    cmd.AddValue ("input", "Файл двоичной трассы пакетов", input);
+    cmd.AddValue ("perDevice", "Печатать строки RESULT по устройствам", perDevice);
+    cmd.Parse (argc, argv);
+
+    LogComponentEnable ("LoraTraceReader", LOG_LEVEL_INFO);
+
+    LoraPacketTraceReader reader;
+    NS_ABORT_MSG_IF (!reader.Open (input), "Не удалось прочитать трассу " << input);
+    const LoraTraceFileHeader& header = reader.GetHeader ();
+
+    std::vector<uint64_t> sent (header.nDevices, 0);
+    std::vector<uint64_t> delivered (header.nDevices, 0);
+    std::vector<uint8_t> deviceSf (header.nDevices, 0);
+    uint64_t sentPerSf[13] = {0};
+    uint64_t deliveredPerSf[13] = {0};
+    uint64_t retransmitted = 0;
+
+    // По шлюзам: приемы, потери по причинам, средние RSSI и SNR принятых пакетов
+    std::vector<uint64_t> gatewayReceived (header.nGateways, 0);
+    std::vector<uint64_t> gatewayInterference (header.nGateways, 0);
+    std::vector<uint64_t> gatewayUnderSensitivity (header.nGateways, 0);
+    std::vector<uint64_t> gatewayNoMoreReceivers (header.nGateways, 0);
+    std::vector<double> rssiSum (header.nGateways, 0.0);
+    std::vector<double> snrSum (header.nGateways, 0.0);
+    std::vector<uint64_t> snrCount (header.nGateways, 0);
+
+    LoraTraceRecord record;
+    uint64_t nRecords = 0;
+    double lastTime = 0;
+    while (reader.Next (record)) {
+        nRecords++;
+        lastTime = record.timeNs * 1e-9;
+        if (record.device >= header.nDevices || record.sf > 12) {
+            continue;
+        }
+        if (record.event == TRACE_SENT) {
+            sent[record.device]++;
+            deviceSf[record.device] = record.sf;
+            sentPerSf[record.sf]++;
+            continue;
+        }
+        if (record.event == TRACE_RETRANSMITTED) {
+            retransmitted++;
+            continue;
+        }
+        if (record.event == TRACE_DELIVERED) {
+            delivered[record.device]++;
+            deliveredPerSf[record.sf]++;
+        }
+        if (record.gateway >= header.nGateways) {
+            continue;
+        }
+        switch (record.event) {
+            case TRACE_DELIVERED:
+            case TRACE_RECEIVED:
+                gatewayReceived[record.gateway]++;
+                if (!std::isnan (record.powerDbm)) {
+                    rssiSum[record.gateway] += record.powerDbm;
+                }
+                if (!std::isnan (record.snrDb)) {
+                    snrSum[record.gateway] += record.snrDb;
+                    snrCount[record.gateway]++;
+                }
+                break;
+            case TRACE_INTERFERENCE:
+                gatewayInterference[record.gateway]++;
+                break;
+            case TRACE_UNDER_SENSITIVITY:
+                gatewayUnderSensitivity[record.gateway]++;
+                break;
+            case TRACE_NO_MORE_RECEIVERS:
+                gatewayNoMoreReceivers[record.gateway]++;
+                break;
+        }
+    }
+
+    uint64_t totalSent = 0;
+    uint64_t totalDelivered = 0;
+    for (uint32_t i = 0; i < header.nDevices; i++) {
+        totalSent += sent[i];
+        totalDelivered += delivered[i];
+    }
+
+    NS_LOG_INFO("Трасса: " << nRecords << " записей, " << header.nDevices << " устройств, "
+                << header.nGateways << " шлюзов, последнее событие " << lastTime << " с");
+    NS_LOG_INFO("Всего отправлено пакетов: " << totalSent << " (повторных передач " << retransmitted << ")");
+    NS_LOG_INFO("Успешно доставлено: " << totalDelivered);
+    NS_LOG_INFO("Коэффициент доставки: " << (totalSent > 0 ? 100.0 * totalDelivered / totalSent : 0.0) << "%");
+
+    for (int s = 7; s <= 12; s++) {
+        if (sentPerSf[s] > 0) {
+            NS_LOG_INFO("SF" << s << ": отправлено " << sentPerSf[s] << ", доставлено " << deliveredPerSf[s]
+                        << " (" << 100.0 * deliveredPerSf[s] / sentPerSf[s] << "%)");
+        }
+    }
+    for (uint32_t g = 0; g < header.nGateways; g++) {
+        double meanRssi = gatewayReceived[g] > 0 ? rssiSum[g] / gatewayReceived[g] : NAN;
+        double meanSnr = snrCount[g] > 0 ? snrSum[g] / snrCount[g] : NAN;
+        NS_LOG_INFO("Шлюз " << g << ": принято " << gatewayReceived[g]
+                    << ", средний RSSI " << meanRssi << " dBm, средний SNR " << meanSnr
+                    << " dB; потери: интерференция " << gatewayInterference[g]
+                    << ", ниже чувствительности " << gatewayUnderSensitivity[g]
+                    << ", нет свободных путей " << gatewayNoMoreReceivers[g]);
+    }
+
+    // Тот же формат, что у LoraDeviceCounters::Print
+    if (perDevice) {
+        for (uint32_t i = 0; i < header.nDevices; i++) {
+            std::cout << "RESULT device=" << i << " sf=" << unsigned(deviceSf[i])
+                      << " sent=" << sent[i] << " received=" << delivered[i] << "\n";
+        }
+        std::cout.flush();
+    }
+
+    return 0;
+}
@@ -0,0 +1,353 @@
+#ifndef LORA_ADR_H
+#define LORA_ADR_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lorawan-module.h"
+
+#include "lora-binary-log.h"
+#include "lora-device-counters.h"
+#include "lora-downlink-scheduler.h"
+#include "lora-reception-thresholds.h"
+#include "lora-uplink-tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Индекс мощности LinkADRReq для EU868: 0 - 16 dBm (MaxEIRP), шаг 2 dB
+inline uint8_t LoraTxPowerIndex(double txPowerDbm)
+{
+    return uint8_t(std::min(std::max((16.0 - txPowerDbm) / 2.0, 0.0), 7.0));
+}
+
+// Одно наблюдение восходящего пакета: лучший SNR по шлюзам и число шлюзов
+struct LoraAdrSample
+{
+    float snrDb;
+    uint8_t gateways;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(LoraAdrSample) == 8, "LoraAdrSample должна занимать 8 байт");
+
+// Итог одного пакетного пересчета: по ним видно, как быстро сходится сеть
+struct LoraAdrBatch
+{
+    double timeSeconds;
+    uint32_t decided;       // Новых команд в этом пересчете
+    uint32_t pending;       // Команд, еще не примененных устройствами
+    uint64_t applied;       // Применено с начала прогона
+    uint32_t perSf[6];      // Устройств на SF7..SF12
+};
+
+class LoraAdrEngine;
+
+// Компонент контроллера сетевого сервера: добавляет LinkADRReq, решенный
+// LoraAdrEngine, в ответ на восходящий пакет устройства (класс A слышит
+// сервер только в окнах RX1/RX2 после своей передачи)
+class LoraAdrComponent : public NetworkControllerComponent
+{
+public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::LoraAdrComponent")
+                                .SetParent<NetworkControllerComponent>()
+                                .SetGroupName("Lorawan")
+                                .AddConstructor<LoraAdrComponent>();
+        return tid;
+    }
+
+    LoraAdrComponent()
+        : engine(nullptr)
+    {
+    }
+
+    void SetEngine(LoraAdrEngine* adrEngine) { engine = adrEngine; }
+
+    void OnReceivedPacket(Ptr<const Packet> packet,
+                          Ptr<EndDeviceStatus> status,
+                          Ptr<NetworkStatus> networkStatus) override;
+
+    void BeforeSendingReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override {}
+
+    // Неотправленная команда остается в ожидании и уйдет со следующим ответом
+    void OnFailedReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override {}
+
+private:
+    LoraAdrEngine* engine;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LoraAdrComponent);
+
+// ADR на сетевом сервере. Последние history наблюдений каждого устройства
+// (SNR лучшего шлюза и число шлюзов) лежат кольцом в одной непрерывной
+// арене [устройство][history], выделенной в Install; на пути пакета только
+// запись в кольцо, без выделений памяти. Передачи и приемы шлюзами
+// приходят из LoraUplinkTracker; первый прием передачи открывает запись
+// кольца, копии на других шлюзах дополняют ее через номер записи,
+// сохраненный по slot передачи.
+//
+// Решения принимаются пачкой раз в interval по алгоритму Semtech: для
+// устройств с полным кольцом запас = max SNR - порог SF - margin, каждые
+// 3 dB запаса - шаг DR вверх до DR5, затем мощность вниз на 2 dB; при
+// отрицательном запасе мощность растет до 14 dBm. Новая команда ждет
+// следующего восходящего пакета и уходит в его ответе (LoraAdrComponent),
+// а для устройств с подтверждаемыми пакетами - в ACK LoraDownlinkScheduler.
+// Команда считается примененной, когда устройство передает с новыми DR и
+// мощностью; до этого она повторяется в каждом ответе, а кольцо
+// устройства после применения очищается.
+class LoraAdrEngine
+{
+public:
+    LoraAdrEngine()
+        : history(20),
+          interval(Seconds(1800)),
+          marginDb(10.0),
+          minTxPowerDbm(2),
+          maxTxPowerDbm(14),
+          noiseFloorDbm(NAN),
+          counters(nullptr),
+          downlink(nullptr),
+          enabledChannels{0, 1, 2},
+          nCommands(0),
+          nApplied(0)
+    {
+    }
+
+    // Длина кольца наблюдений на устройство (не больше 255)
+    void SetHistory(uint32_t n) { history = std::min<uint32_t>(std::max<uint32_t>(n, 1), 255); }
+
+    // Период пакетного пересчета решений
+    void SetInterval(Time period) { interval = period; }
+
+    // Запас на установку, dB
+    void SetMargin(double db) { marginDb = db; }
+
+    void SetTxPowerRange(int minDbm, int maxDbm)
+    {
+        minTxPowerDbm = minDbm;
+        maxTxPowerDbm = maxDbm;
+    }
+
+    // Уровень шума для пересчета мощности приема в SNR
+    void SetNoiseFloor(double dbm) { noiseFloorDbm = dbm; }
+
+    // Вызывается после настройки DR и мощности устройств. counters (если
+    // задан) получает примененные SF и мощность для строк RESULT и снимка
+    void Install(LoraUplinkTracker& tracker, LoraDeviceCounters* deviceCounters = nullptr)
+    {
+        uplinks = &tracker;
+        counters = deviceCounters;
+        uint32_t nDevices = tracker.GetNDevices();
+        arena.assign(size_t(nDevices) * history, LoraAdrSample());
+        state.assign(nDevices, DeviceState());
+        sampleBySlot.assign(tracker.GetSlots(), NO_SAMPLE);
+
+        for (uint32_t i = 0; i < nDevices; i++) {
+            Ptr<ClassAEndDeviceLorawanMac> mac = tracker.GetMac(i);
+            deviceByMac[PeekPointer(mac)] = i;
+            state[i].dataRate = mac->GetDataRate();
+            state[i].txPowerDbm = int8_t(mac->GetTransmissionPower());
+        }
+        tracker.TraceSent(MakeCallback(&LoraAdrEngine::Sent, this));
+        tracker.TraceReceived(MakeCallback(&LoraAdrEngine::Received, this));
+
+        Simulator::Schedule(interval, &LoraAdrEngine::Batch, this);
+    }
+
+    // Планировщик ACK: его устройствам команды уходят в ACK, а не в ответ сервера
+    void SetDownlinkScheduler(LoraDownlinkScheduler* scheduler) { downlink = scheduler; }
+
+    // Компонент для NetworkServer::AddComponent
+    Ptr<LoraAdrComponent> CreateComponent()
+    {
+        Ptr<LoraAdrComponent> component = CreateObject<LoraAdrComponent>();
+        component->SetEngine(this);
+        return component;
+    }
+
+    // Сервер принял восходящий пакет: при ожидающей команде добавляем
+    // LinkADRReq в ответ (один раз на пакет, сколько бы шлюзов его ни приняли)
+    void OnServerUplink(Ptr<const Packet> packet, Ptr<EndDeviceStatus> status)
+    {
+        auto it = deviceByMac.find(PeekPointer(status->GetMac()));
+        if (it == deviceByMac.end()) {
+            return;
+        }
+        DeviceState& s = state[it->second];
+        if (s.pendingDataRate < 0 || s.attachedUid == packet->GetUid()) {
+            return;
+        }
+        s.attachedUid = packet->GetUid();
+        uint8_t txPowerIndex = LoraTxPowerIndex(s.pendingTxPowerDbm);
+        if (downlink == nullptr ||
+            !downlink->AddLinkAdrReq(packet->GetUid(), s.pendingDataRate, txPowerIndex, &enabledChannels)) {
+            status->m_reply.frameHeader.AddLinkAdrReq(s.pendingDataRate, txPowerIndex, enabledChannels, 1);
+            status->m_reply.frameHeader.SetAsDownlink();
+            status->m_reply.macHeader.SetMType(LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
+            status->m_reply.needsReply = true;
+        }
+        nCommands++;
+    }
+
+    uint64_t GetCommands() const { return nCommands; }
+    uint64_t GetApplied() const { return nApplied; }
+    const std::vector<LoraAdrBatch>& GetBatches() const { return batches; }
+
+    // Память арены и состояний, байт
+    size_t GetMemoryBytes() const
+    {
+        return arena.capacity() * sizeof(LoraAdrSample) + state.capacity() * sizeof(DeviceState) +
+               sampleBySlot.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    static constexpr uint32_t NO_SAMPLE = UINT32_MAX;
+
+    struct DeviceState
+    {
+        uint64_t attachedUid = UINT64_MAX;  // Пакет, в ответ на который уже добавлена команда
+        uint8_t head = 0;                   // Следующая запись кольца
+        uint8_t count = 0;                  // Заполнено записей
+        uint8_t dataRate = 0;               // DR и мощность последней передачи
+        int8_t txPowerDbm = 0;
+        int8_t pendingDataRate = -1;        // Команда в ожидании; -1 - нет
+        int8_t pendingTxPowerDbm = 0;
+    };
+
+    void Sent(const LoraUplink& uplink)
+    {
+        uint32_t device = uplink.device;
+        DeviceState& s = state[device];
+        s.dataRate = uplinks->GetMac(device)->GetDataRate();
+        s.txPowerDbm = int8_t(uplink.txPowerDbm);
+        if (s.pendingDataRate >= 0 && s.dataRate == uint8_t(s.pendingDataRate) &&
+            s.txPowerDbm == s.pendingTxPowerDbm) {
+            // Команда применена: старые наблюдения относятся к прежним DR и мощности
+            s.pendingDataRate = -1;
+            s.head = 0;
+            s.count = 0;
+            nApplied++;
+            if (counters != nullptr) {
+                counters->SetRadio(device, uplink.sf, s.txPowerDbm);
+            }
+        }
+        sampleBySlot[uplink.slot] = NO_SAMPLE;
+    }
+
+    void Received(const LoraUplink& uplink, const LoraUplinkReception& reception)
+    {
+        if (std::isnan(reception.rssiDbm)) {
+            return;
+        }
+        float snr = reception.rssiDbm - noiseFloorDbm;
+        uint32_t& index = sampleBySlot[uplink.slot];
+        if (index != NO_SAMPLE) {
+            // Копия на другом шлюзе дополняет наблюдение этого пакета
+            LoraAdrSample& sample = arena[index];
+            sample.snrDb = std::max(sample.snrDb, snr);
+            sample.gateways++;
+            return;
+        }
+        DeviceState& s = state[uplink.device];
+        index = uplink.device * history + s.head;
+        arena[index] = {snr, 1, {0, 0, 0}};
+        s.head = (s.head + 1) % history;
+        s.count = std::min<uint32_t>(s.count + 1, history);
+    }
+
+    void Batch()
+    {
+        LoraAdrBatch batch = {Simulator::Now().GetSeconds(), 0, 0, 0, {0, 0, 0, 0, 0, 0}};
+        for (uint32_t d = 0; d < state.size(); d++) {
+            DeviceState& s = state[d];
+            if (s.pendingDataRate < 0 && s.count >= history && Decide(d)) {
+                batch.decided++;
+            }
+            if (s.pendingDataRate >= 0) {
+                batch.pending++;
+            }
+            batch.perSf[5 - std::min<uint8_t>(s.dataRate, 5)]++;
+        }
+        batch.applied = nApplied;
+        batches.push_back(batch);
+        Simulator::Schedule(interval, &LoraAdrEngine::Batch, this);
+    }
+
+    // Решение для устройства с полным кольцом; true - назначена новая команда
+    bool Decide(uint32_t device)
+    {
+        DeviceState& s = state[device];
+        const LoraAdrSample* ring = &arena[size_t(device) * history];
+        float snrMax = ring[0].snrDb;
+        for (uint32_t k = 1; k < history; k++) {
+            snrMax = std::max(snrMax, ring[k].snrDb);
+        }
+        uint8_t sf = 12 - std::min<uint8_t>(s.dataRate, 5);
+        int steps = int(std::floor((snrMax - LORA_SINR_FLOOR_DB[sf - 7] - marginDb) / 3.0));
+
+        int dataRate = s.dataRate;
+        int power = s.txPowerDbm;
+        while (steps > 0 && dataRate < 5) {
+            dataRate++;
+            steps--;
+        }
+        while (steps > 0 && power - 2 >= minTxPowerDbm) {
+            power -= 2;
+            steps--;
+        }
+        while (steps < 0 && power + 2 <= maxTxPowerDbm) {
+            power += 2;
+            steps++;
+        }
+        if (dataRate == s.dataRate && power == s.txPowerDbm) {
+            return false;
+        }
+        LORA_BLOG(LORA_LOG_ADR_COMMAND, device, s.dataRate, dataRate, power);
+        s.pendingDataRate = dataRate;
+        s.pendingTxPowerDbm = power;
+        s.attachedUid = UINT64_MAX;
+        return true;
+    }
+
+    uint32_t history;
+    Time interval;
+    double marginDb;
+    int minTxPowerDbm;
+    int maxTxPowerDbm;
+    double noiseFloorDbm;
+    LoraUplinkTracker* uplinks = nullptr;
+    LoraDeviceCounters* counters;
+    LoraDownlinkScheduler* downlink;
+    const std::list<int> enabledChannels;      // Маска каналов LinkADRReq: три канала EU868
+
+    std::vector<LoraAdrSample> arena;          // [устройство][history]
+    std::vector<DeviceState> state;
+    std::vector<uint32_t> sampleBySlot;        // Запись арены по slot передачи; NO_SAMPLE - еще не принята
+    std::unordered_map<const ClassAEndDeviceLorawanMac*, uint32_t> deviceByMac;
+
+    uint64_t nCommands;
+    uint64_t nApplied;
+    std::vector<LoraAdrBatch> batches;
+};
+
+inline void
+LoraAdrComponent::OnReceivedPacket(Ptr<const Packet> packet,
+                                   Ptr<EndDeviceStatus> status,
+                                   Ptr<NetworkStatus> networkStatus)
+{
+    if (engine != nullptr) {
+        engine->OnServerUplink(packet, status);
+    }
+}
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_ADR_H */
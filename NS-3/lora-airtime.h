@@ -0,0 +1,252 @@
+#ifndef LORA_AIRTIME_H
+#define LORA_AIRTIME_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lorawan-module.h"
+
+#include "lora-uplink-tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Индексы полос в таблице времени в эфире
+enum LoraBandwidthIndex : uint8_t
+{
+    LORA_BW125 = 0,
+    LORA_BW250 = 1,
+    LORA_BW500 = 2,
+};
+
+static constexpr uint32_t LORA_MAX_PHY_PAYLOAD = 255;
+
+// Длительность символа 2^SF / BW, нс (целое для 125/250/500 кГц)
+constexpr int64_t LoraSymbolTimeNs(uint8_t sf, uint8_t bw)
+{
+    return (int64_t(1) << sf) * (8000 >> bw);
+}
+
+// Оптимизация низкой скорости обязательна при символе от 16 мс
+constexpr bool LoraLowDataRateOptimize(uint8_t sf, uint8_t bw)
+{
+    return LoraSymbolTimeNs(sf, bw) >= 16000000;
+}
+
+// Символы после преамбулы: явный заголовок, CRC, кодовая скорость 4/(4 + cr)
+constexpr uint32_t LoraPayloadSymbolCount(uint8_t sf, uint8_t bw, uint8_t cr, uint32_t payloadBytes)
+{
+    int32_t numerator = 8 * int32_t(payloadBytes) - 4 * sf + 28 + 16;
+    int32_t denominator = 4 * (sf - (LoraLowDataRateOptimize(sf, bw) ? 2 : 0));
+    int32_t blocks = numerator > 0 ? (numerator + denominator - 1) / denominator : 0;
+    return 8 + blocks * (4 + cr);
+}
+
+// Время в эфире, нс: (8 символов преамбулы + 4.25 + нагрузка) * Tsym
+constexpr int64_t LoraComputeAirtimeNs(uint8_t sf, uint8_t bw, uint8_t cr, uint32_t payloadBytes)
+{
+    return (4 * (8 + int64_t(LoraPayloadSymbolCount(sf, bw, cr, payloadBytes))) + 17) * LoraSymbolTimeNs(sf, bw) / 4;
+}
+
+// Время в эфире для всех (SF7..12, BW, CR 4/5..4/8, длина 0..255), вычисляется
+// при компиляции: на пакет - одно чтение из массива вместо pow/ceil
+struct LoraAirtimeTable
+{
+    int64_t ns[6][3][4][LORA_MAX_PHY_PAYLOAD + 1];
+};
+
+constexpr LoraAirtimeTable BuildLoraAirtimeTable()
+{
+    LoraAirtimeTable table{};
+    for (uint8_t s = 0; s < 6; s++) {
+        for (uint8_t bw = 0; bw < 3; bw++) {
+            for (uint8_t cr = 0; cr < 4; cr++) {
+                for (uint32_t length = 0; length <= LORA_MAX_PHY_PAYLOAD; length++) {
+                    table.ns[s][bw][cr][length] = LoraComputeAirtimeNs(7 + s, bw, 1 + cr, length);
+                }
+            }
+        }
+    }
+    return table;
+}
+
+inline constexpr LoraAirtimeTable LORA_AIRTIME_TABLE = BuildLoraAirtimeTable();
+
+// SF7, 20 байт, 125 кГц, CR 4/5: 56.576 мс; SF12, 51 байт: 2465.792 мс
+static_assert(LORA_AIRTIME_TABLE.ns[0][LORA_BW125][0][20] == 56576000, "ToA SF7");
+static_assert(LORA_AIRTIME_TABLE.ns[5][LORA_BW125][0][51] == 2465792000, "ToA SF12");
+
+// Время в эфире PHY-нагрузки payloadBytes (длиннее 255 байт не бывает)
+constexpr int64_t LoraAirtimeNs(uint8_t sf, uint32_t payloadBytes, uint8_t cr = 1, uint8_t bw = LORA_BW125)
+{
+    return LORA_AIRTIME_TABLE.ns[sf - 7][bw][cr - 1][std::min(payloadBytes, LORA_MAX_PHY_PAYLOAD)];
+}
+
+inline Time LoraAirtime(uint8_t sf, uint32_t payloadBytes, uint8_t cr = 1, uint8_t bw = LORA_BW125)
+{
+    return NanoSeconds(LoraAirtimeNs(sf, payloadBytes, cr, bw));
+}
+
+// Время передачи пакета: BW 125 кГц, CR 4/5, явный заголовок, CRC, преамбула 8 символов.
+// Дробная длина (средний размер пакета) округляется вверх.
+inline double LoraTimeOnAir(uint8_t sf, double payloadBytes)
+{
+    return LoraAirtimeNs(sf, uint32_t(std::ceil(std::max(payloadBytes, 0.0)))) * 1e-9;
+}
+
+// Подполосы EU868 (ETSI EN 300 220) и их ограничения duty cycle.
+// Доля задается делителем: 100 - 1%, 1000 - 0.1%, 10 - 10%.
+struct LoraSubBand
+{
+    double minHz;
+    double maxHz;
+    uint32_t dutyCycleDivisor;
+};
+
+static constexpr LoraSubBand LORA_EU868_SUB_BANDS[] = {
+    {863.0e6, 865.0e6, 1000},
+    {865.0e6, 868.0e6, 100},
+    {868.0e6, 868.6e6, 100},
+    {868.7e6, 869.2e6, 1000},
+    {869.4e6, 869.65e6, 10},
+    {869.7e6, 870.0e6, 100},
+};
+static constexpr uint32_t LORA_EU868_N_SUB_BANDS = sizeof(LORA_EU868_SUB_BANDS) / sizeof(LoraSubBand);
+
+// Индекс подполосы по частоте (Гц или МГц), LORA_EU868_N_SUB_BANDS - вне полос
+inline uint32_t LoraSubBandIndex(double frequency)
+{
+    double hz = frequency < 1e6 ? frequency * 1e6 : frequency;
+    for (uint32_t b = 0; b < LORA_EU868_N_SUB_BANDS; b++) {
+        if (hz >= LORA_EU868_SUB_BANDS[b].minHz && hz <= LORA_EU868_SUB_BANDS[b].maxHz) {
+            return b;
+        }
+    }
+    return LORA_EU868_N_SUB_BANDS;
+}
+
+// Учет duty cycle EU868 маркерными корзинами по (устройство, подполоса).
+// Корзина копит право на эфир со скоростью доли подполосы, но не больше,
+// чем доля окна наблюдения (по умолчанию час); передача тратит время в эфире.
+// Запас хранится в наносекундах "реального" времени (передача стоит
+// ToA * делитель), поэтому пополнение и списание - целочисленные и без
+// деления. Корзины лежат одним плоским массивом [устройство][подполоса].
+//
+// MAC ns-3 сам выдерживает паузу после каждой передачи; здесь по
+// отправкам LoraUplinkTracker (частота, SF и длина уже разобраны)
+// считается, сколько передач укладывается в бюджет корзин, а
+// CanTransmit/GetWaitTime дают тот же ответ без передачи.
+class LoraDutyCycle
+{
+public:
+    LoraDutyCycle()
+        : windowNs(Hours(1).GetNanoSeconds()),
+          nTransmissions(0),
+          nViolations(0),
+          nOutOfBand(0)
+    {
+    }
+
+    // Окно наблюдения ETSI; задается до Install
+    void SetWindow(Time window) { windowNs = window.GetNanoSeconds(); }
+
+    void Install(LoraUplinkTracker& tracker)
+    {
+        Resize(tracker.GetNDevices());
+        tracker.TraceSent(MakeCallback(&LoraDutyCycle::Sent, this));
+    }
+
+    // Корзины без подключения к узлам (аналитика, собственный MAC)
+    void Resize(uint32_t nDevices)
+    {
+        buckets.assign(size_t(nDevices) * LORA_EU868_N_SUB_BANDS, Bucket{windowNs, 0});
+        deviceAirtimeNs.assign(nDevices, 0);
+    }
+
+    // Хватает ли запаса на передачу длительностью airtimeNs в момент nowNs
+    bool CanTransmit(uint32_t device, uint32_t band, int64_t airtimeNs, int64_t nowNs)
+    {
+        Bucket& b = Refill(device, band, nowNs);
+        return b.credit >= airtimeNs * LORA_EU868_SUB_BANDS[band].dutyCycleDivisor;
+    }
+
+    // Списывает передачу; false - бюджет подполосы превышен (запас уходит в минус)
+    bool Consume(uint32_t device, uint32_t band, int64_t airtimeNs, int64_t nowNs)
+    {
+        bool allowed = CanTransmit(device, band, airtimeNs, nowNs);
+        buckets[size_t(device) * LORA_EU868_N_SUB_BANDS + band].credit -=
+            airtimeNs * LORA_EU868_SUB_BANDS[band].dutyCycleDivisor;
+        deviceAirtimeNs[device] += airtimeNs;
+        return allowed;
+    }
+
+    // Через сколько передача станет разрешенной (0 - уже можно)
+    Time GetWaitTime(uint32_t device, uint32_t band, int64_t airtimeNs, int64_t nowNs)
+    {
+        Bucket& b = Refill(device, band, nowNs);
+        int64_t cost = airtimeNs * LORA_EU868_SUB_BANDS[band].dutyCycleDivisor;
+        return NanoSeconds(std::max<int64_t>(cost - b.credit, 0));
+    }
+
+    uint64_t GetTransmissions() const { return nTransmissions; }
+    uint64_t GetViolations() const { return nViolations; }
+    uint64_t GetOutOfBand() const { return nOutOfBand; }
+
+    // Суммарное время в эфире устройства, нс
+    int64_t GetAirtimeNs(uint32_t device) const { return deviceAirtimeNs[device]; }
+
+    // Наибольшая доля времени в эфире среди устройств за время elapsed
+    double GetMaxDeviceDutyCycle(Time elapsed) const
+    {
+        int64_t maxAirtime = 0;
+        for (int64_t airtime : deviceAirtimeNs) {
+            maxAirtime = std::max(maxAirtime, airtime);
+        }
+        return elapsed.IsStrictlyPositive() ? double(maxAirtime) / elapsed.GetNanoSeconds() : 0.0;
+    }
+
+private:
+    struct Bucket
+    {
+        int64_t credit;     // Накопленное время, нс (не больше окна)
+        int64_t lastNs;     // Момент последнего пополнения
+    };
+
+    Bucket& Refill(uint32_t device, uint32_t band, int64_t nowNs)
+    {
+        Bucket& b = buckets[size_t(device) * LORA_EU868_N_SUB_BANDS + band];
+        b.credit = std::min(b.credit + (nowNs - b.lastNs), windowNs);
+        b.lastNs = nowNs;
+        return b;
+    }
+
+    void Sent(const LoraUplink& uplink)
+    {
+        // Без LoraTag частота 0 и подполоса не находится
+        uint32_t band = LoraSubBandIndex(uplink.frequency);
+        if (band == LORA_EU868_N_SUB_BANDS) {
+            nOutOfBand++;
+            return;
+        }
+        nTransmissions++;
+        if (!Consume(uplink.device, band, LoraAirtimeNs(uplink.sf, uplink.size), uplink.sentNs)) {
+            nViolations++;
+        }
+    }
+
+    int64_t windowNs;
+    std::vector<Bucket> buckets;            // [устройство][подполоса]
+    std::vector<int64_t> deviceAirtimeNs;
+    uint64_t nTransmissions;
+    uint64_t nViolations;
+    uint64_t nOutOfBand;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_AIRTIME_H */
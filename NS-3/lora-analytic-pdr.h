@@ -0,0 +1,293 @@
+#ifndef LORA_ANALYTIC_PDR_H
+#define LORA_ANALYTIC_PDR_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+
+#include "lora-airtime.h"
+#include "lora-device-counters.h"
+#include "lora-gateway-grid.h"
+#include "lora-noise-fading-loss-model.h"
+#include "lora-reception-thresholds.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Параметры канала и трафика для аналитической оценки
+struct AnalyticChannelParams
+{
+    double exponent = 3.0;           // LogDistance Exponent
+    double referenceLossDb = 46.0;   // LogDistance ReferenceLoss
+    double referenceDistance = 1.0;  // LogDistance ReferenceDistance, м
+    bool enableNoise = true;
+    double noiseFloorDbm = -100.0;
+    double snrThresholdDb = 0.0;
+    bool sinrThresholds = false;     // Порог по SF из LORA_SINR_FLOOR_DB вместо snrThresholdDb
+    bool enableFading = false;
+    double meanPowerGain = 2.0;      // Среднее |h|^2 = 2 sigma^2
+    double appPeriod = 600.0;        // Период PeriodicSender, с
+    uint32_t nChannels = 3;          // Каналы EU868 по умолчанию
+    double meanPayload = 30.0;       // Средний размер пакета (10-50 байт), байт
+    uint32_t dutyCycleDivisor = 100; // Duty cycle подполосы 868.0-868.6 МГц (1%)
+
+    // Параметры шума и замираний берутся из модели канала сценария
+    void SetFromModel(Ptr<LoraNoiseFadingLossModel> model)
+    {
+        enableNoise = model->IsNoiseEnabled();
+        noiseFloorDbm = model->GetNoiseFloorDbm();
+        snrThresholdDb = model->GetSnrThreshold();
+        enableFading = model->IsFadingEnabled();
+        meanPowerGain = 2.0 * model->GetSigma() * model->GetSigma();
+    }
+};
+
+// Аналитическая оценка PDR каждого устройства вместо Simulator::Run().
+// P(доставка) = P(хотя бы один шлюз принял без замирания ниже порога)
+//             * P(нет коллизии в чистой ALOHA на том же SF и канале).
+// Для рэлеевских замираний P(g * Prx > Pmin) = exp(-10^((Pmin - Prx)/10) / mean).
+// Потери на трассе для всех пар устройство-шлюз считаются один раз в SetTopology,
+// поэтому Evaluate - несколько проходов по плоским массивам без ветвлений по узлам.
+// С SetMaxRange хранятся только шлюзы в пределах дальности (по LoraGatewayGrid).
+class LoraAnalyticPdr
+{
+public:
+    explicit LoraAnalyticPdr(const AnalyticChannelParams& params)
+        : params(params),
+          nDevices(0),
+          nGateways(0),
+          maxRange(0.0)
+    {
+    }
+
+    // Дальность отбора шлюзов, м (0 - все шлюзы); задается до SetTopology
+    void SetMaxRange(double range) { maxRange = range; }
+
+    void SetTopology(const std::vector<Vector>& devicePositions, const std::vector<Vector>& gatewayPositions)
+    {
+        nDevices = devicePositions.size();
+        nGateways = gatewayPositions.size();
+        candidateStart.assign(1, 0);
+        pathLossDb.clear();
+        if (maxRange > 0) {
+            grid.Build(gatewayPositions, maxRange);
+        }
+        for (size_t i = 0; i < nDevices; i++) {
+            if (maxRange > 0) {
+                grid.ForEachCandidate(devicePositions[i],
+                                      [this](uint32_t, double distance) { pathLossDb.push_back(PathLoss(distance)); });
+            } else {
+                for (size_t g = 0; g < nGateways; g++) {
+                    pathLossDb.push_back(PathLoss(CalculateDistance(devicePositions[i], gatewayPositions[g])));
+                }
+            }
+            candidateStart.push_back(pathLossDb.size());
+        }
+    }
+
+    void SetTopology(NodeContainer endDevices, NodeContainer gateways)
+    {
+        std::vector<Vector> devicePositions;
+        std::vector<Vector> gatewayPositions;
+        for (uint32_t i = 0; i < endDevices.GetN(); i++) {
+            devicePositions.push_back(endDevices.Get(i)->GetObject<MobilityModel>()->GetPosition());
+        }
+        for (uint32_t g = 0; g < gateways.GetN(); g++) {
+            gatewayPositions.push_back(gateways.Get(g)->GetObject<MobilityModel>()->GetPosition());
+        }
+        SetTopology(devicePositions, gatewayPositions);
+    }
+
+    // Ожидаемый PDR (0..1) каждого устройства; SF вне 7..12 - ошибка
+    std::vector<double> Evaluate(const std::vector<uint8_t>& sf, const std::vector<double>& txPowerDbm) const
+    {
+        NS_ABORT_MSG_IF(sf.size() != nDevices || txPowerDbm.size() != nDevices,
+                        "Аналитике передано " << sf.size() << " SF и " << txPowerDbm.size()
+                                             << " мощностей для " << nDevices << " устройств");
+        for (size_t i = 0; i < nDevices; i++) {
+            NS_ABORT_MSG_IF(sf[i] < 7 || sf[i] > 12,
+                            "Устройство " << i << ": SF" << unsigned(sf[i]) << " вне SF7..SF12");
+        }
+        std::vector<double> pdr(nDevices);
+
+        // Нагрузка на каждый SF: число устройств * ToA / (период * число каналов).
+        // Устройство не передает чаще, чем позволяет duty cycle: ToA * делитель
+        double devicesPerSf[13] = {0};
+        for (size_t i = 0; i < nDevices; i++) {
+            devicesPerSf[sf[i]] += 1;
+        }
+        // По индексу sf - 7: вероятность без коллизии и мощность на пороге приема
+        double noCollision[6];
+        double minRxPowerDbm[6];
+        for (int s = 7; s <= 12; s++) {
+            double airtime = LoraTimeOnAir(s, params.meanPayload);
+            double period = std::max(params.appPeriod, airtime * params.dutyCycleDivisor);
+            double load = std::max(devicesPerSf[s] - 1, 0.0) * airtime / (period * params.nChannels);
+            noCollision[s - 7] = exp(-2 * load);
+            double thresholdDb = params.sinrThresholds ? LORA_SINR_FLOOR_DB[s - 7] : params.snrThresholdDb;
+            minRxPowerDbm[s - 7] = params.enableNoise ? params.noiseFloorDbm + thresholdDb : -HUGE_VAL;
+        }
+
+        for (size_t i = 0; i < nDevices; i++) {
+            // Вероятность, что ни один шлюз не принял пакет
+            double missAll = 1.0;
+            for (size_t k = candidateStart[i]; k < candidateStart[i + 1]; k++) {
+                double marginDb = txPowerDbm[i] - pathLossDb[k] - minRxPowerDbm[sf[i] - 7];
+                double pLink;
+                if (params.enableFading) {
+                    pLink = exp(-pow(10.0, -marginDb / 10.0) / params.meanPowerGain);
+                } else {
+                    pLink = marginDb > 0 ? 1.0 : 0.0;
+                }
+                missAll *= 1.0 - pLink;
+            }
+            pdr[i] = (1.0 - missAll) * noCollision[sf[i] - 7];
+        }
+        return pdr;
+    }
+
+    // PDR сети при равном числе пакетов от каждого устройства
+    static double NetworkPdr(const std::vector<double>& pdr)
+    {
+        double sum = 0;
+        for (double p : pdr) {
+            sum += p;
+        }
+        return pdr.empty() ? 0.0 : sum / pdr.size();
+    }
+
+private:
+    double PathLoss(double distance) const
+    {
+        double loss = params.referenceLossDb;
+        if (distance > params.referenceDistance) {
+            loss += 10 * params.exponent * log10(distance / params.referenceDistance);
+        }
+        return loss;
+    }
+
+    AnalyticChannelParams params;
+    size_t nDevices;
+    size_t nGateways;
+    double maxRange;
+    LoraGatewayGrid grid;
+    std::vector<size_t> candidateStart; // CSR: candidateStart[i]..candidateStart[i+1]
+    std::vector<double> pathLossDb;     // Потери до шлюзов-кандидатов устройства
+};
+
+// Печать расположения узлов строками POSITION/GATEWAY, чтобы внешние
+// инструменты (Pso-Ga.cc) строили аналитическую модель по той же топологии
+inline void PrintTopology(std::ostream& os, NodeContainer endDevices, NodeContainer gateways)
+{
+    for (uint32_t i = 0; i < endDevices.GetN(); i++) {
+        Vector pos = endDevices.Get(i)->GetObject<MobilityModel>()->GetPosition();
+        os << "POSITION device=" << i << " x=" << pos.x << " y=" << pos.y << " z=" << pos.z << "\n";
+    }
+    for (uint32_t g = 0; g < gateways.GetN(); g++) {
+        Vector pos = gateways.Get(g)->GetObject<MobilityModel>()->GetPosition();
+        os << "GATEWAY index=" << g << " x=" << pos.x << " y=" << pos.y << " z=" << pos.z << "\n";
+    }
+    os.flush();
+}
+
+inline void ParseTopology(const std::string& output,
+                          std::vector<Vector>& devicePositions,
+                          std::vector<Vector>& gatewayPositions)
+{
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        unsigned index;
+        Vector pos;
+        if (std::sscanf(line.c_str(), "POSITION device=%u x=%lf y=%lf z=%lf", &index, &pos.x, &pos.y, &pos.z) == 4) {
+            devicePositions.resize(std::max<size_t>(devicePositions.size(), index + 1));
+            devicePositions[index] = pos;
+        } else if (std::sscanf(line.c_str(), "GATEWAY index=%u x=%lf y=%lf z=%lf", &index, &pos.x, &pos.y, &pos.z) == 4) {
+            gatewayPositions.resize(std::max<size_t>(gatewayPositions.size(), index + 1));
+            gatewayPositions[index] = pos;
+        }
+    }
+}
+
+// Печать параметров канала строкой CHANNEL: внешние оптимизаторы строят
+// аналитическую модель с тем же шумом, порогом и замираниями, что у сценария
+inline void PrintChannel(std::ostream& os, const AnalyticChannelParams& p)
+{
+    os << "CHANNEL exponent=" << p.exponent << " reference_loss=" << p.referenceLossDb
+       << " reference_distance=" << p.referenceDistance << " noise=" << p.enableNoise
+       << " noise_floor=" << p.noiseFloorDbm << " snr_threshold=" << p.snrThresholdDb
+       << " fading=" << p.enableFading << " mean_gain=" << p.meanPowerGain << " period=" << p.appPeriod
+       << " sinr=" << p.sinrThresholds << "\n";
+    os.flush();
+}
+
+inline bool ParseChannel(const std::string& output, AnalyticChannelParams& p)
+{
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        int noise;
+        int fading;
+        int sinrThresholds;
+        if (std::sscanf(line.c_str(),
+                        "CHANNEL exponent=%lf reference_loss=%lf reference_distance=%lf noise=%d noise_floor=%lf "
+                        "snr_threshold=%lf fading=%d mean_gain=%lf period=%lf sinr=%d",
+                        &p.exponent, &p.referenceLossDb, &p.referenceDistance, &noise, &p.noiseFloorDbm,
+                        &p.snrThresholdDb, &fading, &p.meanPowerGain, &p.appPeriod, &sinrThresholds) == 10) {
+            p.enableNoise = noise != 0;
+            p.enableFading = fading != 0;
+            p.sinrThresholds = sinrThresholds != 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Сравнение аналитической оценки с результатом симуляции
+struct AnalyticErrorReport
+{
+    double predictedPdr;    // PDR сети по аналитике, %
+    double measuredPdr;     // PDR сети по симуляции, %
+    double meanAbsError;    // Средняя абсолютная ошибка по устройствам, п.п.
+    double maxAbsError;     // Максимальная ошибка по устройствам, п.п.
+};
+
+inline AnalyticErrorReport CompareWithSimulation(const std::vector<double>& predicted,
+                                                 const LoraDeviceCounters& counters)
+{
+    AnalyticErrorReport report = {0.0, 0.0, 0.0, 0.0};
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    double weightedPredicted = 0;
+    uint32_t nMeasured = 0;
+    for (uint32_t i = 0; i < counters.GetNDevices(); i++) {
+        if (counters.GetSent(i) == 0) {
+            continue;
+        }
+        double measured = double(counters.GetReceived(i)) / counters.GetSent(i);
+        double error = 100.0 * fabs(predicted[i] - measured);
+        report.meanAbsError += error;
+        report.maxAbsError = std::max(report.maxAbsError, error);
+        sent += counters.GetSent(i);
+        received += counters.GetReceived(i);
+        weightedPredicted += predicted[i] * counters.GetSent(i);
+        nMeasured++;
+    }
+    if (nMeasured > 0) {
+        report.meanAbsError /= nMeasured;
+        report.predictedPdr = 100.0 * weightedPredicted / sent;
+        report.measuredPdr = 100.0 * received / sent;
+    }
+    return report;
+}
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_ANALYTIC_PDR_H */
@@ -0,0 +1,341 @@
+#ifndef LORA_BASIC_SCENARIO_H
+#define LORA_BASIC_SCENARIO_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lorawan-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/log.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+
+#include "lora-noise-fading-loss-model.h"
+#include "lora-link-budget-cache.h"
+#include "lora-uplink-tracker.h"
+#include "lora-device-counters.h"
+#include "lora-analytic-pdr.h"
+#include "lora-packet-trace.h"
+#include "lora-windowed-metrics.h"
+#include "lora-benchmark.h"
+#include "lora-binary-log.h"
+#include "lora-reception-paths.h"
+#include "lora-per-table.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Общая обвязка сценариев VM_NIR, VM_NIR_1 и VM_NIR_2: один шлюз в центре,
+// устройства в круге 2 км, LogDistance через кэш потерь, стек LoRaWAN,
+// счетчики, трасса, метрики по окнам, аналитическая оценка, приложение,
+// сервер и итоги. Сценарий задает только модель шума и замираний:
+//
+//   LoraBasicScenario scenario ("LoraAWGN");
+//   scenario.AddOptions (cmd);
+//   ...
+//   LoraNoiseFadingHelper noiseHelper;   // шум и замирания сценария
+//   scenario.InstallChannel (noiseHelper);
+//   scenario.InstallNetwork ();
+//   scenario.Run ();
+//   scenario.Report ("=== РЕЗУЛЬТАТЫ ... ===");
+//
+// Журнал ведется компонентом сценария, имя которого передается в конструктор.
+class LoraBasicScenario
+{
+public:
+    // Параметры (задаются AddOptions)
+    int nDevices = 3;
+    double simulationTime = 3600;
+    double appPeriod = 600;
+    std::string traceFile = "";     // Двоичная трасса пакетов (пусто - LoraPacketTracker)
+    double metricsInterval = 0;     // Окно метрик, с (0 - метрики не пишутся)
+    std::string metricsFile = "metrics.csv"; // Файл метрик (.csv или .json)
+    bool metricsPerDevice = false;  // Счетчики каждого устройства в каждом окне
+    std::string snrHistogram = "";  // Бины гистограммы SNR "min:ширина:число" (пусто - -30:1:60)
+    std::string rssiHistogram = ""; // Бины гистограммы RSSI (пусто - -140:2:50)
+    uint32_t receptionPaths = LORA_GATEWAY_RECEPTION_PATHS; // Пути демодуляции шлюза
+    std::string logFile = "";       // Двоичный диагностический журнал (пусто - выключен)
+    std::string perTableFile = "";  // Таблица PER из PerTable.cc (пусто - порог SNR)
+
+    explicit LoraBasicScenario(const std::string& logComponent)
+        : NS_LOG_TEMPLATE_DEFINE(logComponent)
+    {
+    }
+
+    LoraBasicScenario(const LoraBasicScenario&) = delete;
+    LoraBasicScenario& operator=(const LoraBasicScenario&) = delete;
+
+    void AddOptions(CommandLine& cmd)
+    {
+        cmd.AddValue("nDevices", "Количество устройств", nDevices);
+        cmd.AddValue("simulationTime", "Время симуляции, с", simulationTime);
+        cmd.AddValue("appPeriod", "Период отправки данных, с", appPeriod);
+        cmd.AddValue("receptionPaths", "Число путей демодуляции шлюза", receptionPaths);
+        cmd.AddValue("logFile", "Файл двоичного диагностического журнала (LogDecoder.cc)", logFile);
+        cmd.AddValue("traceFile", "Файл двоичной трассы пакетов", traceFile);
+        cmd.AddValue("metricsInterval", "Окно метрик PDR/SNR, с (0 - выключено)", metricsInterval);
+        cmd.AddValue("metricsFile", "Файл метрик по окнам (.csv или .json)", metricsFile);
+        cmd.AddValue("metricsPerDevice", "Писать в метрики счетчики каждого устройства", metricsPerDevice);
+        cmd.AddValue("snrHistogram", "Бины гистограммы SNR метрик: min:ширина:число, dB", snrHistogram);
+        cmd.AddValue("rssiHistogram", "Бины гистограммы RSSI метрик: min:ширина:число, dBm", rssiHistogram);
+    }
+
+    // Прием по таблице PER (сценарии с порогом по шуму)
+    void AddPerTableOption(CommandLine& cmd)
+    {
+        cmd.AddValue("perTable", "Файл таблицы PER(SNR, SF, CR, длина)", perTableFile);
+    }
+
+    // Открывает --perTable; порог модели шума - минимальный полезный SNR
+    // таблицы, без таблицы - defaultDb
+    double OpenPerTable(double defaultDb)
+    {
+        NS_ABORT_MSG_IF(!perTableFile.empty() && !perTable.Open(perTableFile),
+                        "Не удалось открыть таблицу PER " << perTableFile);
+        return perTable.IsLoaded() ? perTable.GetMinUsefulSnrDb() : defaultDb;
+    }
+
+    // Узлы, мобильность и канал: потери LogDistance + модель шума noiseHelper
+    Ptr<LoraNoiseFadingLossModel> InstallChannel(LoraNoiseFadingHelper& noiseHelper)
+    {
+        NS_LOG_INFO("Создаем сеть с " << nDevices << " устройствами");
+
+        // Создание узлов
+        endDevices.Create(nDevices);
+        gateways.Create(1);
+
+        // Мобильность
+        MobilityHelper mobility;
+        Ptr<ListPositionAllocator> positionAllocGateways = CreateObject<ListPositionAllocator>();
+        positionAllocGateways->Add(Vector(0.0, 0.0, 15.0));
+        mobility.SetPositionAllocator(positionAllocGateways);
+        mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+        mobility.Install(gateways);
+
+        MobilityHelper mobilityEd;
+        mobilityEd.SetPositionAllocator("ns3::UniformDiscPositionAllocator",
+                                        "X", DoubleValue(0.0),
+                                        "Y", DoubleValue(0.0),
+                                        "rho", DoubleValue(2000.0));
+        mobilityEd.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+        mobilityEd.Install(endDevices);
+
+        Ptr<LogDistancePropagationLossModel> logDistance = CreateObject<LogDistancePropagationLossModel>();
+        logDistance->SetAttribute("Exponent", DoubleValue(3.0));
+        logDistance->SetAttribute("ReferenceLoss", DoubleValue(46.0));
+
+        // Потери LogDistance для пар устройство-шлюз считаются один раз при установке
+        Ptr<LoraLinkBudgetCacheLossModel> linkCache = CreateObject<LoraLinkBudgetCacheLossModel>();
+        linkCache->SetLossModel(logDistance);
+        linkCache->Install(endDevices, gateways);
+
+        Ptr<CompositePropagationLossModel> compositeLoss = CreateObject<CompositePropagationLossModel>();
+        compositeLoss->AddLossModel(linkCache);
+
+        // Подпотоки замираний по номерам устройств и шлюзов, а не id узлов
+        noiseHelper.SetLinks(endDevices, gateways);
+        noiseModel = noiseHelper.Install(compositeLoss);
+
+        channel = CreateObject<WirelessChannel>();
+        channel->SetPropagationLossModel(compositeLoss);
+        channel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+        return noiseModel;
+    }
+
+    // Стек LoRaWAN, параметры устройств, учет пакетов, приложение и сервер
+    void InstallNetwork()
+    {
+        PhyLoraPropModelHelper phyHelper;
+        phyHelper.SetFrequency(868e6);
+        phyHelper.SetChannel(channel);
+
+        LorawanMacHelper macHelper;
+        macHelper.SetRegion(LorawanMacHelper::EU);
+
+        if (traceFile.empty()) {
+            helper.EnablePacketTracking();
+        }
+
+        // Установка на устройства
+        macHelper.SetDeviceType(LorawanMacHelper::ED_A);
+        helper.Install(phyHelper, macHelper, endDevices);
+
+        macHelper.SetDeviceType(LorawanMacHelper::GW);
+        helper.Install(phyHelper, macHelper, gateways);
+
+        // Пути демодуляции шлюза и потери при занятости всех путей
+        pathPool.SetPhyPaths(gateways, receptionPaths);
+
+        // Настройка параметров устройств
+        for (int i = 0; i < nDevices; i++) {
+            Ptr<Node> node = endDevices.Get(i);
+            Ptr<LoraNetDevice> loraNetDev = node->GetDevice(0)->GetObject<LoraNetDevice>();
+            Ptr<ClassAEndDeviceLorawanMac> edMac = loraNetDev->GetMac()->GetObject<ClassAEndDeviceLorawanMac>();
+
+            switch (i) {
+                case 0:
+                    edMac->SetDataRate(5);
+                    edMac->SetTransmissionPower(14);
+                    NS_LOG_INFO("Устройство 0: SF7, мощность 14dBm");
+                    break;
+                case 1:
+                    edMac->SetDataRate(3);
+                    edMac->SetTransmissionPower(10);
+                    NS_LOG_INFO("Устройство 1: SF9, мощность 10dBm");
+                    break;
+                case 2:
+                    edMac->SetDataRate(1);
+                    edMac->SetTransmissionPower(6);
+                    NS_LOG_INFO("Устройство 2: SF11, мощность 6dBm");
+                    break;
+            }
+        }
+
+        // Прием по таблице PER вместо порога SNR (средняя длина пакета 10..50 байт
+        // плюс заголовки MAC)
+        if (perTable.IsLoaded()) {
+            noiseModel->SetPerTable(&perTable, endDevices, 30 + LORA_MAC_OVERHEAD_BYTES);
+            NS_LOG_INFO("Прием по таблице PER " << perTableFile);
+        }
+
+        // Восходящие передачи разбираются один раз на пакет для счетчиков,
+        // трассы и метрик
+        uplinkTracker.Install(endDevices, gateways);
+
+        // Счетчики по устройствам (строки RESULT для Replications.cc)
+        deviceCounters.Install(uplinkTracker);
+
+        // Потоковая трасса пакетов вместо LoraPacketTracker (читается TraceReader.cc)
+        if (!traceFile.empty()) {
+            NS_ABORT_MSG_IF(!traceWriter.Open(traceFile), "Не удалось открыть " << traceFile);
+            if (noiseModel->IsNoiseEnabled()) {
+                traceWriter.SetNoiseFloor(noiseModel->GetNoiseFloorDbm());
+            }
+            traceWriter.Install(uplinkTracker, noiseModel);
+        }
+
+        // Метрики по окнам симулированного времени
+        if (metricsInterval > 0) {
+            NS_ABORT_MSG_IF(!windowedMetrics.Open(metricsFile), "Не удалось открыть " << metricsFile);
+            windowedMetrics.SetInterval(Seconds(metricsInterval));
+            windowedMetrics.SetPerDevice(metricsPerDevice);
+            NS_ABORT_MSG_IF(!windowedMetrics.SetSnrHistogram(snrHistogram), "Неверные бины SNR " << snrHistogram);
+            NS_ABORT_MSG_IF(!windowedMetrics.SetRssiHistogram(rssiHistogram), "Неверные бины RSSI " << rssiHistogram);
+            if (noiseModel->IsNoiseEnabled()) {
+                windowedMetrics.SetNoiseFloor(noiseModel->GetNoiseFloorDbm());
+            }
+            windowedMetrics.Install(uplinkTracker);
+        }
+
+        // Аналитическая оценка PDR по той же топологии и модели канала
+        analyticParams.SetFromModel(noiseModel);
+        analyticParams.appPeriod = appPeriod;
+        LoraAnalyticPdr analytic(analyticParams);
+        analytic.SetTopology(endDevices, gateways);
+        auto analyticStart = std::chrono::steady_clock::now();
+        predictedPdr = analytic.Evaluate(deviceCounters.GetSpreadingFactors(), deviceCounters.GetTxPowers());
+        analyticSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - analyticStart).count();
+
+        // Приложение
+        appStopTime = Seconds(simulationTime);
+        PeriodicSenderHelper appHelper = PeriodicSenderHelper();
+        appHelper.SetPeriod(Seconds(appPeriod));
+
+        Ptr<RandomVariableStream> rv = CreateObjectWithAttributes<UniformRandomVariable>(
+            "Min", DoubleValue(10), "Max", DoubleValue(50));
+        appHelper.SetPacketSizeRandomVariable(rv);
+
+        ApplicationContainer appContainer = appHelper.Install(endDevices);
+        appContainer.Start(Seconds(0));
+        appContainer.Stop(appStopTime);
+
+        // Сервер
+        NetworkServerHelper networkServerHelper;
+        networkServerHelper.SetGateways(gateways);
+        networkServerHelper.SetEndDevices(endDevices);
+        networkServerHelper.Install(gateways);
+
+        ForwarderHelper forwarderHelper;
+        forwarderHelper.Install(gateways);
+    }
+
+    void Run()
+    {
+        NS_LOG_INFO("Запуск симуляции на " << simulationTime << " секунд");
+        Simulator::Stop(appStopTime + Hours(1));
+        if (!logFile.empty()) {
+            NS_ABORT_MSG_IF(!LoraBinaryLog::Open(logFile), "Не удалось открыть журнал " << logFile);
+        }
+        auto simulationStart = std::chrono::steady_clock::now();
+        Simulator::Run();
+        std::chrono::duration<double> simulationWallTime = std::chrono::steady_clock::now() - simulationStart;
+        benchmark = MeasureBenchmark(simulationWallTime.count(), appStopTime);
+        windowedMetrics.Finish();
+        LoraBinaryLog::Close();
+        Simulator::Destroy();
+    }
+
+    // Итоги в журнал и строки RESULT, BENCH, POSITION, GATEWAY и CHANNEL в stdout
+    void Report(const std::string& title)
+    {
+        uint64_t sentPackets = traceWriter.GetSent();
+        uint64_t deliveredPackets = traceWriter.GetDelivered();
+        traceWriter.Close();
+        if (traceFile.empty()) {
+            LoraPacketTracker& tracker = helper.GetPacketTracker();
+            sentPackets = tracker.CountMacPacketsSent();
+            deliveredPackets = tracker.CountMacPacketsGloballyReceived();
+        }
+        NS_LOG_INFO(title);
+        NS_LOG_INFO("Всего отправлено пакетов: " << sentPackets);
+        NS_LOG_INFO("Успешно доставлено: " << deliveredPackets);
+
+        double deliveryRatio = sentPackets > 0 ? 100.0 * deliveredPackets / sentPackets : 0.0;
+        NS_LOG_INFO("Коэффициент доставки: " << deliveryRatio << "%");
+        NS_LOG_INFO("Потеряно без свободного пути демодуляции (" << receptionPaths << " путей): "
+                    << pathPool.GetLostNoPath());
+
+        AnalyticErrorReport analyticError = CompareWithSimulation(predictedPdr, deviceCounters);
+        NS_LOG_INFO("Аналитическая оценка: " << analyticError.predictedPdr << "%, симуляция: "
+                    << analyticError.measuredPdr << "%");
+        NS_LOG_INFO("Ошибка по устройствам: средняя " << analyticError.meanAbsError
+                    << " п.п., максимальная " << analyticError.maxAbsError << " п.п.");
+        NS_LOG_INFO("Время: аналитика " << analyticSeconds * 1e6 << " мкс, симуляция "
+                    << benchmark.wallSeconds << " с");
+
+        deviceCounters.Print(std::cout);
+        PrintBenchmark(std::cout, benchmark);
+        PrintTopology(std::cout, endDevices, gateways);
+        PrintChannel(std::cout, analyticParams);
+    }
+
+private:
+    NS_LOG_TEMPLATE_DECLARE;
+
+    NodeContainer endDevices;
+    NodeContainer gateways;
+    LoraPerTable perTable;
+    Ptr<LoraNoiseFadingLossModel> noiseModel;
+    Ptr<WirelessChannel> channel;
+    LorawanHelper helper;
+    LoraReceptionPathPool pathPool;
+    LoraUplinkTracker uplinkTracker;
+    LoraDeviceCounters deviceCounters;
+    LoraPacketTraceWriter traceWriter;
+    LoraWindowedMetrics windowedMetrics;
+    AnalyticChannelParams analyticParams;
+    std::vector<double> predictedPdr;
+    double analyticSeconds = 0;
+    Time appStopTime;
+    BenchmarkSample benchmark;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_BASIC_SCENARIO_H */
@@ -0,0 +1,310 @@
+#ifndef LORA_BATCHED_SENDER_H
+#define LORA_BATCHED_SENDER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/lorawan-module.h"
+
+#include "lora-profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Календарная очередь моментов периодической отправки: кольцо корзин шириной
+// slot, корзина - индексы устройств. Слот не шире периода, а корзин на две
+// больше, чем слотов в периоде, поэтому за один оборот кольца устройство
+// встречается в корзине один раз; устройства следующего оборота остаются в ней.
+class LoraSendCalendar
+{
+public:
+    LoraSendCalendar()
+        : periodNs(1),
+          slotNs(1),
+          currentSlot(0)
+    {
+    }
+
+    void Reset(int64_t period, int64_t slot, uint32_t nDevices, int64_t nowNs)
+    {
+        periodNs = std::max<int64_t>(period, 1);
+        slotNs = std::max<int64_t>(std::min(slot, periodNs), 1);
+        buckets.assign(periodNs / slotNs + 2, std::vector<uint32_t>());
+        nextSendNs.assign(nDevices, 0);
+        currentSlot = nowNs / slotNs;
+    }
+
+    int64_t GetNextSend(uint32_t device) const { return nextSendNs[device]; }
+
+    // Первая отправка устройства в момент timeNs
+    void Add(uint32_t device, int64_t timeNs)
+    {
+        nextSendNs[device] = timeNs;
+        Insert(device);
+    }
+
+    // Начало ближайшего непустого слота; пустые пропускаются без событий.
+    // false - в очереди нет устройств
+    bool NextSlot(int64_t& slotStartNs)
+    {
+        for (uint64_t k = 0; k < buckets.size(); k++) {
+            if (!buckets[(currentSlot + k) % buckets.size()].empty()) {
+                currentSlot += k;
+                slotStartNs = currentSlot * slotNs;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Вызывает send(device, timeNs) для отправок текущего слота, переносит
+    // устройства на период вперед и переходит к следующему слоту
+    template <typename F>
+    void PopSlot(F send)
+    {
+        int64_t slotEnd = (currentSlot + 1) * slotNs;
+        due.swap(buckets[currentSlot % buckets.size()]);
+        for (uint32_t d : due) {
+            if (nextSendNs[d] >= slotEnd) {
+                // Устройство следующего оборота кольца
+                buckets[currentSlot % buckets.size()].push_back(d);
+                continue;
+            }
+            send(d, nextSendNs[d]);
+            nextSendNs[d] += periodNs;
+            Insert(d);
+        }
+        due.clear();
+        currentSlot++;
+    }
+
+    // Память очереди, байт
+    size_t GetMemoryBytes() const
+    {
+        size_t bytes = nextSendNs.capacity() * sizeof(int64_t) + buckets.capacity() * sizeof(buckets[0]);
+        for (const std::vector<uint32_t>& b : buckets) {
+            bytes += b.capacity() * sizeof(uint32_t);
+        }
+        return bytes;
+    }
+
+private:
+    void Insert(uint32_t device)
+    {
+        buckets[(nextSendNs[device] / slotNs) % buckets.size()].push_back(device);
+    }
+
+    int64_t periodNs;
+    int64_t slotNs;
+    int64_t currentSlot;
+    std::vector<int64_t> nextSendNs;
+    std::vector<std::vector<uint32_t>> buckets;
+    std::vector<uint32_t> due;
+};
+
+// Периодическая отправка для группы устройств одним приложением вместо
+// PeriodicSender на каждом устройстве. Моменты следующей отправки лежат в
+// календарной очереди LoraSendCalendar. Приложение просыпается только на непустых слотах и планирует отправки
+// этого слота на их точное время, поэтому в планировщике одновременно
+// ждут лишь отправки одного слота, а не по событию на каждое устройство.
+// Трафик тот же, что у PeriodicSender: первая отправка через U(0, период),
+// дальше строго с периодом, размер пакета - базовый плюс случайная добавка.
+class LoraBatchedSender : public Application
+{
+public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::LoraBatchedSender")
+                .SetParent<Application>()
+                .SetGroupName("Lorawan")
+                .AddConstructor<LoraBatchedSender>()
+                .AddAttribute("Interval",
+                              "Период отправки каждого устройства",
+                              TimeValue(Seconds(600)),
+                              MakeTimeAccessor(&LoraBatchedSender::interval),
+                              MakeTimeChecker())
+                .AddAttribute("Slot",
+                              "Ширина корзины календарной очереди",
+                              TimeValue(Seconds(1)),
+                              MakeTimeAccessor(&LoraBatchedSender::slot),
+                              MakeTimeChecker());
+        return tid;
+    }
+
+    LoraBatchedSender()
+        : interval(Seconds(600)),
+          slot(Seconds(1)),
+          basePacketSize(10),
+          initialDelay(CreateObject<UniformRandomVariable>()),
+          running(false),
+          nWakeups(0),
+          nSent(0)
+    {
+    }
+
+    void SetInterval(Time period) { interval = period; }
+    void SetSlot(Time width) { slot = width; }
+
+    // Размер пакета = base + packetSize->GetInteger(), как в PeriodicSender
+    void SetBasePacketSize(uint8_t size) { basePacketSize = size; }
+    void SetPacketSizeRandomVariable(Ptr<RandomVariableStream> rv) { packetSize = rv; }
+
+    // firstSend - задержка первой отправки (отрицательная - U(0, период))
+    void AddEndDevice(Ptr<Node> node, Time firstSend = Time(-1))
+    {
+        Ptr<LoraNetDevice> loraNetDev = node->GetDevice(0)->GetObject<LoraNetDevice>();
+        deviceMac.push_back(loraNetDev->GetMac());
+        deviceNode.push_back(node->GetId());
+        firstSendNs.push_back(firstSend.IsStrictlyNegative() ? -1 : firstSend.GetNanoSeconds());
+    }
+
+    uint32_t GetNDevices() const { return deviceMac.size(); }
+
+    // Поток задержек первой отправки; поток размера пакета задает владелец
+    // packetSize
+    int64_t AssignStreams(int64_t stream) override
+    {
+        initialDelay->SetStream(stream);
+        return 1;
+    }
+
+    // Пробуждения приложения и отправленные пакеты
+    uint64_t GetWakeups() const { return nWakeups; }
+    uint64_t GetSent() const { return nSent; }
+
+private:
+    void StartApplication() override
+    {
+        int64_t now = Simulator::Now().GetNanoSeconds();
+        calendar.Reset(interval.GetNanoSeconds(), slot.GetNanoSeconds(), deviceMac.size(), now);
+        for (uint32_t d = 0; d < deviceMac.size(); d++) {
+            int64_t delay = firstSendNs[d] >= 0
+                                ? firstSendNs[d]
+                                : Seconds(initialDelay->GetValue(0, interval.GetSeconds())).GetNanoSeconds();
+            calendar.Add(d, now + delay);
+        }
+        running = true;
+        ScheduleWake();
+    }
+
+    void StopApplication() override
+    {
+        running = false;
+        wakeEvent.Cancel();
+    }
+
+    void ScheduleWake()
+    {
+        int64_t slotStart;
+        if (calendar.NextSlot(slotStart)) {
+            int64_t delay = std::max<int64_t>(slotStart - Simulator::Now().GetNanoSeconds(), 0);
+            wakeEvent = Simulator::Schedule(NanoSeconds(delay), &LoraBatchedSender::Wake, this);
+        }
+    }
+
+    void Wake()
+    {
+        nWakeups++;
+        int64_t now = Simulator::Now().GetNanoSeconds();
+        calendar.PopSlot([this, now](uint32_t d, int64_t timeNs) {
+            Simulator::ScheduleWithContext(deviceNode[d], NanoSeconds(std::max<int64_t>(timeNs - now, 0)),
+                                           &LoraBatchedSender::SendPacket, this, d);
+        });
+        ScheduleWake();
+    }
+
+    void SendPacket(uint32_t device)
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_MAC_SEND);
+        if (!running) {
+            return;
+        }
+        uint32_t size = basePacketSize + (packetSize ? packetSize->GetInteger() : 0);
+        deviceMac[device]->Send(Create<Packet>(size));
+        nSent++;
+    }
+
+    Time interval;
+    Time slot;
+    uint8_t basePacketSize;
+    Ptr<RandomVariableStream> packetSize;
+    Ptr<UniformRandomVariable> initialDelay;
+    bool running;
+
+    std::vector<Ptr<LorawanMac>> deviceMac;
+    std::vector<uint32_t> deviceNode;
+    std::vector<int64_t> firstSendNs;
+    LoraSendCalendar calendar;
+    EventId wakeEvent;
+    uint64_t nWakeups;
+    uint64_t nSent;
+};
+
+// Установка LoraBatchedSender: по одному приложению на шлюз, устройство
+// закрепляется за ближайшим шлюзом (приложение живет на узле шлюза)
+class LoraBatchedSenderHelper
+{
+public:
+    LoraBatchedSenderHelper()
+        : period(Seconds(600)),
+          slot(Seconds(1))
+    {
+    }
+
+    void SetPeriod(Time p) { period = p; }
+    void SetSlot(Time s) { slot = s; }
+    void SetPacketSizeRandomVariable(Ptr<RandomVariableStream> rv) { packetSize = rv; }
+
+    // Задержки первой отправки по индексу в endDevices (например, из снимка)
+    void SetInitialDelays(const std::vector<Time>& delays) { initialDelays = delays; }
+
+    ApplicationContainer Install(NodeContainer endDevices, NodeContainer gateways) const
+    {
+        std::vector<Ptr<LoraBatchedSender>> senders;
+        for (uint32_t g = 0; g < gateways.GetN(); g++) {
+            Ptr<LoraBatchedSender> sender = CreateObject<LoraBatchedSender>();
+            sender->SetInterval(period);
+            sender->SetSlot(slot);
+            sender->SetPacketSizeRandomVariable(packetSize);
+            gateways.Get(g)->AddApplication(sender);
+            senders.push_back(sender);
+        }
+        for (uint32_t i = 0; i < endDevices.GetN(); i++) {
+            Vector position = endDevices.Get(i)->GetObject<MobilityModel>()->GetPosition();
+            uint32_t nearest = 0;
+            double best = HUGE_VAL;
+            for (uint32_t g = 0; g < gateways.GetN(); g++) {
+                double distance =
+                    CalculateDistance(position, gateways.Get(g)->GetObject<MobilityModel>()->GetPosition());
+                if (distance < best) {
+                    best = distance;
+                    nearest = g;
+                }
+            }
+            senders[nearest]->AddEndDevice(endDevices.Get(i), i < initialDelays.size() ? initialDelays[i] : Time(-1));
+        }
+
+        ApplicationContainer apps;
+        for (const Ptr<LoraBatchedSender>& sender : senders) {
+            apps.Add(sender);
+        }
+        return apps;
+    }
+
+private:
+    Time period;
+    Time slot;
+    Ptr<RandomVariableStream> packetSize;
+    std::vector<Time> initialDelays;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_BATCHED_SENDER_H */
@@ -0,0 +1,77 @@
+#ifndef LORA_BENCHMARK_H
+#define LORA_BENCHMARK_H
+
+#include "ns3/core-module.h"
+
+#include <sys/resource.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace ns3 {
+namespace lorawan {
+
+// Показатели производительности одного прогона сценария.
+// Сценарий печатает их строкой "BENCH ...", которую разбирает Benchmark.cc.
+struct BenchmarkSample
+{
+    double wallSeconds = 0;         // Время Simulator::Run(), с
+    double simulatedSeconds = 0;    // Время работы приложений (без хвоста после остановки), с
+    uint64_t events = 0;            // Число выполненных событий
+    uint64_t peakRssKb = 0;         // Пиковый размер резидентной памяти, КБ
+
+    double WallPerSimulatedHour() const
+    {
+        return simulatedSeconds > 0 ? wallSeconds * 3600.0 / simulatedSeconds : 0.0;
+    }
+
+    double EventsPerSecond() const { return wallSeconds > 0 ? events / wallSeconds : 0.0; }
+};
+
+// Снимается сразу после Simulator::Run(), до Simulator::Destroy().
+// Нормировка - на appStopTime: хвост после остановки приложений (досылка
+// последних пакетов) почти пуст и занижал бы время на симулированный час
+inline BenchmarkSample MeasureBenchmark(double wallSeconds, Time appStopTime)
+{
+    BenchmarkSample sample;
+    sample.wallSeconds = wallSeconds;
+    sample.simulatedSeconds = appStopTime.GetSeconds();
+    sample.events = Simulator::GetEventCount();
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        sample.peakRssKb = usage.ru_maxrss; // В Linux - в килобайтах
+    }
+    return sample;
+}
+
+// BENCH wall=<с> simulated=<с> events=<n> peak_rss_kb=<n>
+inline void PrintBenchmark(std::ostream& os, const BenchmarkSample& sample)
+{
+    os << "BENCH wall=" << sample.wallSeconds << " simulated=" << sample.simulatedSeconds
+       << " events=" << sample.events << " peak_rss_kb=" << sample.peakRssKb << "\n";
+    os.flush();
+}
+
+inline bool ParseBenchmark(const std::string& output, BenchmarkSample& sample)
+{
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        unsigned long long events, rss;
+        if (std::sscanf(line.c_str(), "BENCH wall=%lf simulated=%lf events=%llu peak_rss_kb=%llu",
+                        &sample.wallSeconds, &sample.simulatedSeconds, &events, &rss) == 4) {
+            sample.events = events;
+            sample.peakRssKb = rss;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_BENCHMARK_H */
@@ -0,0 +1,361 @@
+#ifndef LORA_BINARY_LOG_H
+#define LORA_BINARY_LOG_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Уровни диагностического журнала. Записи уровня выше LORA_LOG_LEVEL
+// вырезаются при компиляции вместе с вычислением аргументов; по умолчанию
+// собираются INFO и ниже, отладка - с -DLORA_LOG_LEVEL=4.
+#define LORA_LOG_LEVEL_ERROR 1
+#define LORA_LOG_LEVEL_WARN 2
+#define LORA_LOG_LEVEL_INFO 3
+#define LORA_LOG_LEVEL_DEBUG 4
+
+#ifndef LORA_LOG_LEVEL
+#define LORA_LOG_LEVEL LORA_LOG_LEVEL_INFO
+#endif
+
+// Запись события журнала: LORA_BLOG(LORA_LOG_NOISE_RX_POWER, tx, gain, rx, snr)
+#define LORA_BLOG(event, ...)                                                                     \
+    do {                                                                                          \
+        if constexpr (::ns3::lorawan::LORA_LOG_EVENTS[event].level <= LORA_LOG_LEVEL) {           \
+            ::ns3::lorawan::LoraBinaryLog::Write(event, __VA_ARGS__);                            \
+        }                                                                                         \
+    } while (0)
+
+namespace ns3 {
+namespace lorawan {
+
+// Компоненты, пишущие в журнал
+enum LoraLogComponent : uint16_t
+{
+    LORA_LOG_COMPONENT_NOISE,       // Шум и замирания
+    LORA_LOG_COMPONENT_LINK_CACHE,  // Кэш потерь
+    LORA_LOG_COMPONENT_SINR,        // Прием по SINR
+    LORA_LOG_COMPONENT_ADR,         // ADR сетевого сервера
+    LORA_LOG_COMPONENT_DOWNLINK,    // Планировщик ACK
+    LORA_LOG_COMPONENTS
+};
+
+static constexpr const char* LORA_LOG_COMPONENT_NAMES[LORA_LOG_COMPONENTS] = {
+    "LoraNoiseFading", "LoraLinkBudgetCache", "LoraSinrReception", "LoraAdr", "LoraDownlinkScheduler"};
+
+// События журнала; номер события - индекс в LORA_LOG_EVENTS
+enum LoraLogEvent : uint16_t
+{
+    LORA_LOG_NOISE_RX_POWER,
+    LORA_LOG_NOISE_LOST_FLOOR,
+    LORA_LOG_NOISE_LOST_PER,
+    LORA_LOG_LINK_RECOMPUTE,
+    LORA_LOG_SINR_DECISION,
+    LORA_LOG_SINR_NO_PATH,
+    LORA_LOG_ADR_COMMAND,
+    LORA_LOG_DOWNLINK_DROPPED,
+    LORA_LOG_EVENTS_COUNT
+};
+
+// Описание события: сообщение с подстановкой аргументов {0}..{3}
+// собирается только декодером
+struct LoraLogEventInfo
+{
+    LoraLogComponent component;
+    int level;
+    const char* message;
+};
+
+static constexpr LoraLogEventInfo LORA_LOG_EVENTS[LORA_LOG_EVENTS_COUNT] = {
+    {LORA_LOG_COMPONENT_NOISE, LORA_LOG_LEVEL_DEBUG,
+     "Исходная мощность: {0} dBm, замирания: {1} dB, после замираний: {2} dBm, SNR: {3} dB"},
+    {LORA_LOG_COMPONENT_NOISE, LORA_LOG_LEVEL_DEBUG, "Потерян ниже порога: {0} dBm, SNR: {1} dB"},
+    {LORA_LOG_COMPONENT_NOISE, LORA_LOG_LEVEL_DEBUG, "Потерян по таблице PER: SF{0}, SNR: {1} dB"},
+    {LORA_LOG_COMPONENT_LINK_CACHE, LORA_LOG_LEVEL_DEBUG, "Пересчет потерь устройства {0}: сдвиг {1} м"},
+    {LORA_LOG_COMPONENT_SINR, LORA_LOG_LEVEL_DEBUG, "Шлюз {0}, SF{1}: SINR {2} dB, принят: {3}"},
+    {LORA_LOG_COMPONENT_SINR, LORA_LOG_LEVEL_DEBUG, "Шлюз {0}: нет свободного пути, мощность {1} dBm"},
+    {LORA_LOG_COMPONENT_ADR, LORA_LOG_LEVEL_INFO, "Устройство {0}: команда DR {1} -> {2}, мощность {3} dBm"},
+    {LORA_LOG_COMPONENT_DOWNLINK, LORA_LOG_LEVEL_INFO, "ACK устройству {0} отброшен после RX2"},
+};
+
+// Запись фиксированной длины (32 байта)
+struct LoraLogRecord
+{
+    int64_t timeNs;     // Симулированное время
+    uint32_t context;   // Узел ns-3 (контекст события)
+    uint16_t component; // LoraLogComponent
+    uint16_t event;     // LoraLogEvent
+    float args[4];
+};
+
+static_assert(sizeof(LoraLogRecord) == 32, "LoraLogRecord должна занимать 32 байта");
+
+struct LoraLogFileHeader
+{
+    char magic[8];          // "LORABLG1"
+    uint32_t recordSize;    // sizeof(LoraLogRecord)
+    uint32_t nEvents;       // LORA_LOG_EVENTS_COUNT писателя
+};
+
+static constexpr char LORA_LOG_MAGIC[8] = {'L', 'O', 'R', 'A', 'B', 'L', 'G', '1'};
+
+// Кольцо записей одного потока: один писатель (свой поток), один читатель
+// (поток сброса), только атомарные head и tail без блокировок
+struct LoraLogRing
+{
+    explicit LoraLogRing(uint32_t capacity)
+        : records(capacity),
+          mask(capacity - 1),
+          waits(0)
+    {
+    }
+
+    std::vector<LoraLogRecord> records;
+    uint64_t mask;
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+    uint64_t waits;         // Записей, ждавших места в полном кольце
+};
+
+// Двоичный диагностический журнал вместо NS_LOG_DEBUG: на пути события
+// только копия 32 байт в кольцо потока, форматирование и сообщения -
+// в декодере (LogDecoder.cc). Поток сброса забирает записи из колец всех
+// потоков и пишет их в файл пачками. Полное кольцо не теряет записи:
+// писатель ждет, пока поток сброса освободит место.
+class LoraBinaryLog
+{
+public:
+    // capacity - записей в кольце потока (округляется вверх до степени 2)
+    static bool Open(const std::string& filename, uint32_t capacity = 65536)
+    {
+        State& s = GetState();
+        Close();
+        s.file = std::fopen(filename.c_str(), "wb");
+        if (s.file == nullptr) {
+            return false;
+        }
+        LoraLogFileHeader header;
+        std::memcpy(header.magic, LORA_LOG_MAGIC, sizeof(header.magic));
+        header.recordSize = sizeof(LoraLogRecord);
+        header.nEvents = LORA_LOG_EVENTS_COUNT;
+        std::fwrite(&header, sizeof(header), 1, s.file);
+
+        s.capacity = 1024;
+        while (s.capacity < capacity) {
+            s.capacity *= 2;
+        }
+        s.nWritten = 0;
+        s.stop.store(false);
+        s.enabled.store(true, std::memory_order_release);
+        s.flusher = std::thread(&LoraBinaryLog::Flusher);
+        return true;
+    }
+
+    // Останавливает поток сброса и дописывает остаток колец
+    static void Close()
+    {
+        State& s = GetState();
+        if (s.file == nullptr) {
+            return;
+        }
+        s.enabled.store(false, std::memory_order_release);
+        s.stop.store(true);
+        s.flusher.join();
+        Drain();
+        std::fclose(s.file);
+        s.file = nullptr;
+    }
+
+    static bool IsOpen() { return GetState().enabled.load(std::memory_order_relaxed); }
+
+    static void Write(LoraLogEvent event, double a0 = 0, double a1 = 0, double a2 = 0, double a3 = 0)
+    {
+        State& s = GetState();
+        if (!s.enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+        LoraLogRing& ring = Current();
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        if (head - ring.tail.load(std::memory_order_acquire) > ring.mask) {
+            ring.waits++;
+            while (head - ring.tail.load(std::memory_order_acquire) > ring.mask) {
+                std::this_thread::yield();
+            }
+        }
+        ring.records[head & ring.mask] = {Simulator::Now().GetNanoSeconds(), Simulator::GetContext(),
+                                          uint16_t(LORA_LOG_EVENTS[event].component), uint16_t(event),
+                                          {float(a0), float(a1), float(a2), float(a3)}};
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    // Записано в файл за время открытия журнала
+    static uint64_t GetWritten() { return GetState().nWritten; }
+
+    // Ожидания писателей на полных кольцах
+    static uint64_t GetWaits()
+    {
+        State& s = GetState();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        uint64_t waits = 0;
+        for (const LoraLogRing* ring : s.rings) {
+            waits += ring->waits;
+        }
+        return waits;
+    }
+
+private:
+    struct State
+    {
+        FILE* file = nullptr;
+        uint32_t capacity = 65536;
+        std::atomic<bool> enabled{false};
+        std::atomic<bool> stop{false};
+        std::thread flusher;
+        std::mutex mutex;                   // Только для списка колец
+        std::vector<LoraLogRing*> rings;    // Живут до конца процесса
+        uint64_t nWritten = 0;
+    };
+
+    static State& GetState()
+    {
+        static State state;
+        return state;
+    }
+
+    static LoraLogRing& Current()
+    {
+        thread_local LoraLogRing* ring = Register();
+        return *ring;
+    }
+
+    static LoraLogRing* Register()
+    {
+        State& s = GetState();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.rings.push_back(new LoraLogRing(s.capacity));
+        return s.rings.back();
+    }
+
+    static void Flusher()
+    {
+        State& s = GetState();
+        while (!s.stop.load()) {
+            if (Drain() == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    // Переносит накопленные записи всех колец в файл; число записей
+    static uint64_t Drain()
+    {
+        State& s = GetState();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        uint64_t n = 0;
+        for (LoraLogRing* ring : s.rings) {
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            while (tail != head) {
+                // Непрерывный кусок до конца кольца или до head
+                uint64_t begin = tail & ring->mask;
+                uint64_t count = std::min<uint64_t>(head - tail, ring->records.size() - begin);
+                std::fwrite(&ring->records[begin], sizeof(LoraLogRecord), count, s.file);
+                tail += count;
+                n += count;
+            }
+            ring->tail.store(tail, std::memory_order_release);
+        }
+        s.nWritten += n;
+        return n;
+    }
+};
+
+// Сообщение записи на русском с подставленными аргументами
+inline std::string LoraLogFormat(const LoraLogRecord& record)
+{
+    if (record.event >= LORA_LOG_EVENTS_COUNT) {
+        return "неизвестное событие " + std::to_string(record.event);
+    }
+    std::ostringstream out;
+    for (const char* p = LORA_LOG_EVENTS[record.event].message; *p != '\0'; p++) {
+        if (p[0] == '{' && p[1] >= '0' && p[1] <= '3' && p[2] == '}') {
+            out << record.args[p[1] - '0'];
+            p += 2;
+        } else {
+            out << *p;
+        }
+    }
+    return out.str();
+}
+
+// Последовательное чтение журнала пачками записей
+class LoraBinaryLogReader
+{
+public:
+    LoraBinaryLogReader()
+        : file(nullptr),
+          position(0)
+    {
+        std::memset(&header, 0, sizeof(header));
+    }
+
+    ~LoraBinaryLogReader()
+    {
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    }
+
+    LoraBinaryLogReader(const LoraBinaryLogReader&) = delete;
+    LoraBinaryLogReader& operator=(const LoraBinaryLogReader&) = delete;
+
+    // false, если файл не открылся или это не журнал этой версии
+    bool Open(const std::string& filename)
+    {
+        file = std::fopen(filename.c_str(), "rb");
+        if (file == nullptr) {
+            return false;
+        }
+        return std::fread(&header, sizeof(header), 1, file) == 1 &&
+               std::memcmp(header.magic, LORA_LOG_MAGIC, sizeof(header.magic)) == 0 &&
+               header.recordSize == sizeof(LoraLogRecord);
+    }
+
+    const LoraLogFileHeader& GetHeader() const { return header; }
+
+    // Следующая запись; false в конце файла
+    bool Next(LoraLogRecord& record)
+    {
+        if (position == buffer.size()) {
+            buffer.resize(4096);
+            size_t n = std::fread(buffer.data(), sizeof(LoraLogRecord), buffer.size(), file);
+            buffer.resize(n);
+            position = 0;
+            if (n == 0) {
+                return false;
+            }
+        }
+        record = buffer[position++];
+        return true;
+    }
+
+private:
+    FILE* file;
+    LoraLogFileHeader header;
+    std::vector<LoraLogRecord> buffer;
+    size_t position;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_BINARY_LOG_H */
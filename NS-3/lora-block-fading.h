@@ -0,0 +1,251 @@
+#ifndef LORA_BLOCK_FADING_H
+#define LORA_BLOCK_FADING_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Генератор блочных замираний Рэлея.
+// Каждая линия имеет свой детерминированный подпоток, зависящий только от
+// seed/run/stream и ключа линии. Ключ LinkKey строится из номера устройства
+// в сети и номера шлюза, а не из id узлов ns-3, поэтому число устройств,
+// порядок создания узлов и разбиение на ячейки не сдвигают последовательности
+// остальных линий. Коэффициенты |h|^2 ~ Exp(mean)
+// генерируются пачками в буфер линии сразу в dB и повторно используются
+// в пределах интервала когерентности. Без SetStream (AssignStreams модели
+// никто не вызывал) подпотоки берутся из seed/run RngSeedManager при первом
+// обращении, поэтому разные --RngRun дают разные замирания.
+//
+// Состояния линий устройство-шлюз лежат в таблице с открытой адресацией.
+// Reserve задает ее емкость по числу линий, и в пределах этого числа прием
+// пакета ничего не выделяет; линия сверх него удваивает таблицу. Прочие
+// линии (устройство-устройство, шлюз-шлюз) состояния не хранят: их
+// коэффициент - функция ключа и номера блока когерентности.
+class LoraBlockFading
+{
+public:
+    // Число коэффициентов, генерируемых за одно пополнение буфера линии
+    static constexpr int BATCH_SIZE = 16;
+
+    LoraBlockFading()
+        : meanGainDb(0.0),
+          coherenceStep(0),
+          baseSeed(0x9E3779B97F4A7C15ULL),
+          seeded(false),
+          used(0)
+    {
+    }
+
+    // Емкость на nLinks линий устройство-шлюз (восходящая и нисходящая
+    // линии пары считаются отдельно)
+    void Reserve(uint64_t nLinks)
+    {
+        uint64_t capacity = 16;
+        while (capacity * 3 < nLinks * 4) {
+            capacity *= 2;
+        }
+        if (capacity > keys.size()) {
+            Rehash(capacity);
+        }
+    }
+
+    // Средняя мощность |h|^2 (для X, Y ~ N(0, sigma^2) это 2 sigma^2)
+    void SetMeanPowerGain(double mean)
+    {
+        meanGainDb = 10 * log10(mean);
+        ClearLinks();
+    }
+
+    // Нулевой интервал: новый коэффициент на каждый прием
+    void SetCoherenceTime(Time coherenceTime)
+    {
+        coherenceStep = coherenceTime.GetTimeStep();
+        ClearLinks();
+    }
+
+    void SetStream(uint64_t seed, uint64_t run, int64_t stream)
+    {
+        baseSeed = Mix(Mix(seed) ^ Mix(run + 0x632BE59BD9B4E019ULL) ^ Mix(uint64_t(stream) + 1));
+        seeded = true;
+        ClearLinks();
+    }
+
+    // Ключ линии устройство-шлюз; восходящая и нисходящая - разные подпотоки
+    static uint64_t LinkKey(uint32_t device, uint32_t gateway, bool uplink)
+    {
+        return (uplink ? 0 : DOWNLINK_BIT) | (uint64_t(device) << 32) | gateway;
+    }
+
+    // Ключ прочих линий (устройство-устройство, шлюз-шлюз) по id узлов
+    static uint64_t NodeLinkKey(uint32_t txId, uint32_t rxId)
+    {
+        return NODE_BIT ^ ((uint64_t(txId) << 32) | rxId);
+    }
+
+    // Коэффициент усиления линии в dB на момент now
+    double GetGainDb(uint64_t key, Time now)
+    {
+        if (key & NODE_BIT) {
+            int64_t step = now.GetTimeStep();
+            return GetDrawGainDb(key, uint64_t(coherenceStep > 0 ? step / coherenceStep : step));
+        }
+        if (!seeded) {
+            SetStream(RngSeedManager::GetSeed(), RngSeedManager::GetRun(), 0);
+        }
+        LinkState& link = FindLink(key);
+
+        int64_t block = coherenceStep > 0 ? now.GetTimeStep() / coherenceStep : link.block + 1;
+        if (block != link.block) {
+            if (link.next == BATCH_SIZE) {
+                Refill(link);
+            }
+            link.gainDb = link.buffer[link.next++];
+            link.block = block;
+        }
+        return link.gainDb;
+    }
+
+    // Коэффициент draw-й передачи линии без состояния линии: для популяций,
+    // где буфер на каждую линию занял бы больше памяти, чем сами устройства.
+    // Каждая передача - новый коэффициент (интервал когерентности не учитывается)
+    double GetDrawGainDb(uint64_t key, uint64_t draw)
+    {
+        if (!seeded) {
+            SetStream(RngSeedManager::GetSeed(), RngSeedManager::GetRun(), 0);
+        }
+        uint64_t bits = Mix(baseSeed ^ Mix(key) ^ Mix(draw + 0xD1B54A32D192ED03ULL));
+        double u = (double(bits >> 11) + 0.5) * 0x1.0p-53;
+        return meanGainDb + 10 * log10(-log(u));
+    }
+
+    // Финализатор splitmix64; им же хешируются ключи вне генератора
+    // (затенение популяции в LoraLinkBudgetCacheLossModel)
+    static uint64_t Mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+private:
+    static constexpr uint64_t DOWNLINK_BIT = 1ULL << 63;
+    static constexpr uint64_t NODE_BIT = 1ULL << 62;
+
+    static constexpr uint64_t EMPTY_KEY = UINT64_MAX;
+
+    // Состояние подпотока линии: xoshiro256+ и буфер пачки коэффициентов
+    struct LinkState
+    {
+        void Seed(uint64_t seed)
+        {
+            for (uint64_t& word : state) {
+                seed += 0x9E3779B97F4A7C15ULL;
+                word = Mix(seed);
+            }
+            next = BATCH_SIZE;
+            block = INT64_MIN;
+            gainDb = 0.0;
+        }
+
+        uint64_t state[4];
+        int next;
+        int64_t block;
+        double gainDb;
+        double buffer[BATCH_SIZE];
+    };
+
+    static uint64_t Rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    static uint64_t NextRandom(uint64_t* s)
+    {
+        uint64_t result = s[0] + s[3];
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = Rotl(s[3], 45);
+        return result;
+    }
+
+    // Ячейка линии; новая линия засевается из baseSeed и ключа
+    LinkState& FindLink(uint64_t key)
+    {
+        if ((used + 1) * 4 > keys.size() * 3) {
+            Rehash(keys.empty() ? 16 : keys.size() * 2);
+        }
+        size_t mask = keys.size() - 1;
+        size_t k = Mix(key) & mask;
+        while (keys[k] != key) {
+            if (keys[k] == EMPTY_KEY) {
+                keys[k] = key;
+                states[k].Seed(baseSeed ^ Mix(key));
+                used++;
+                break;
+            }
+            k = (k + 1) & mask;
+        }
+        return states[k];
+    }
+
+    void Rehash(size_t capacity)
+    {
+        std::vector<uint64_t> oldKeys;
+        std::vector<LinkState> oldStates;
+        oldKeys.swap(keys);
+        oldStates.swap(states);
+        keys.assign(capacity, EMPTY_KEY);
+        states.assign(capacity, LinkState());
+        size_t mask = capacity - 1;
+        for (size_t j = 0; j < oldKeys.size(); j++) {
+            if (oldKeys[j] != EMPTY_KEY) {
+                size_t k = Mix(oldKeys[j]) & mask;
+                while (keys[k] != EMPTY_KEY) {
+                    k = (k + 1) & mask;
+                }
+                keys[k] = oldKeys[j];
+                states[k] = oldStates[j];
+            }
+        }
+    }
+
+    // Новые seed и параметры: линии засеваются заново, емкость остается
+    void ClearLinks()
+    {
+        std::fill(keys.begin(), keys.end(), EMPTY_KEY);
+        used = 0;
+    }
+
+    void Refill(LinkState& link) const
+    {
+        // U в (0, 1): -ln(U) ~ Exp(1), затем масштаб на среднее в dB
+        double u[BATCH_SIZE];
+        for (int i = 0; i < BATCH_SIZE; i++) {
+            u[i] = (double(NextRandom(link.state) >> 11) + 0.5) * 0x1.0p-53;
+        }
+        for (int i = 0; i < BATCH_SIZE; i++) {
+            link.buffer[i] = meanGainDb + 10 * log10(-log(u[i]));
+        }
+        link.next = 0;
+    }
+
+    double meanGainDb;
+    int64_t coherenceStep;
+    uint64_t baseSeed;
+    bool seeded;            // Задан SetStream или seed/run прогона
+    std::vector<uint64_t> keys;     // Ключ линии ячейки, EMPTY_KEY - свободна
+    std::vector<LinkState> states;  // Состояния линий, параллельно keys
+    size_t used;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_BLOCK_FADING_H */
@@ -0,0 +1,169 @@
+#ifndef LORA_CANDIDATE_CHANNEL_H
+#define LORA_CANDIDATE_CHANNEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/lorawan-module.h"
+
+#include "lora-link-budget-cache.h"
+#include "lora-uplink-tracker.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Канал, который доставляет передачу устройства только шлюзам-кандидатам
+// из строки LoraLinkBudgetCacheLossModel. Базовый канал перебирает все PHY
+// канала (все шлюзы и все устройства) и для каждого считает потери и
+// планирует прием, поэтому цена пакета росла с числом шлюзов, даже когда
+// кэш сразу возвращал потерю. Здесь на пакет приходятся только кандидаты:
+// для каждого - цепочка потерь канала и StartReceive PHY шлюза через
+// задержку, как в LoraDevicePopulation.
+// Передачи устройств другим устройствам не доставляются: устройство класса A
+// слушает только свои окна RX на частоте нисходящего канала. Передачи шлюзов
+// (ACK, ответы сервера) и узлов вне Install идут базовым каналом всем PHY.
+// CheckCandidates считает исходы StartReceive на шлюзах для передач
+// устройств и среди них - на шлюзах вне строки кэша отправителя. Если
+// модуль lorawan не вызовет Send этого класса (другая сигнатура или не
+// виртуальный метод), передачи пойдут базовым каналом всем шлюзам, и
+// счетчик вне кандидатов станет ненулевым, а число отборов - нулевым.
+class LoraCandidateChannel : public WirelessChannel
+{
+public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::LoraCandidateChannel")
+                                .SetParent<WirelessChannel>()
+                                .SetGroupName("Lorawan")
+                                .AddConstructor<LoraCandidateChannel>();
+        return tid;
+    }
+
+    // Вызывать после установки стека LoRaWAN: нужны PHY шлюзов. lossModel и
+    // delayModel - те же, что заданы каналу; cache - кэш потерь в цепочке
+    void Install(NodeContainer endDevices,
+                 NodeContainer gateways,
+                 Ptr<LoraLinkBudgetCacheLossModel> cache,
+                 Ptr<PropagationLossModel> lossModel,
+                 Ptr<PropagationDelayModel> delayModel)
+    {
+        linkCache = cache;
+        loss = lossModel;
+        delay = delayModel;
+        deviceByNode.clear();
+        for (uint32_t i = 0; i < endDevices.GetN(); i++) {
+            uint32_t id = endDevices.Get(i)->GetId();
+            if (id >= deviceByNode.size()) {
+                deviceByNode.resize(id + 1, NO_DEVICE);
+            }
+            deviceByNode[id] = i;
+        }
+        gatewayPhy.clear();
+        gatewayMobility.clear();
+        gatewayNode.clear();
+        for (uint32_t g = 0; g < gateways.GetN(); g++) {
+            Ptr<Node> node = gateways.Get(g);
+            gatewayPhy.push_back(node->GetDevice(0)->GetObject<LoraNetDevice>()->GetPhy());
+            gatewayMobility.push_back(node->GetObject<MobilityModel>());
+            gatewayNode.push_back(node->GetId());
+        }
+    }
+
+    void Send(Ptr<LoraPhy> sender,
+              Ptr<Packet> packet,
+              double txPowerDbm,
+              LoraTxParameters txParams,
+              Time duration,
+              double frequencyMHz) const override
+    {
+        uint32_t id = sender->GetDevice()->GetNode()->GetId();
+        uint32_t device = id < deviceByNode.size() ? deviceByNode[id] : NO_DEVICE;
+        if (device == NO_DEVICE) {
+            WirelessChannel::Send(sender, packet, txPowerDbm, txParams, duration, frequencyMHz);
+            return;
+        }
+        nFiltered++;
+        Ptr<MobilityModel> senderMobility = sender->GetMobility();
+        linkCache->ForEachCandidate(device, [&](uint32_t g) {
+            double rxPowerDbm = loss->CalcRxPower(txPowerDbm, senderMobility, gatewayMobility[g]);
+            if (rxPowerDbm <= LoraLinkBudgetCacheLossModel::LOST_POWER_DBM) {
+                return;
+            }
+            Simulator::ScheduleWithContext(gatewayNode[g], delay->GetDelay(senderMobility, gatewayMobility[g]),
+                                           &LoraPhy::StartReceive, gatewayPhy[g], packet->Copy(), rxPowerDbm,
+                                           txParams.sf, duration, frequencyMHz);
+        });
+    }
+
+    // Проверка отбора: исходы приема PHY шлюзов (прием, потеря по любой
+    // причине, отказ во время передачи) сверяются со строкой кэша отправителя.
+    // Отправитель берется из tracker по uid, поэтому вызывать после его Install
+    void CheckCandidates(LoraUplinkTracker& tracker)
+    {
+        uplinks = &tracker;
+        for (uint32_t g = 0; g < gatewayPhy.size(); g++) {
+            for (const char* trace : {"ReceivedPacket", "LostPacketBecauseInterference",
+                                      "LostPacketBecauseUnderSensitivity", "LostPacketBecauseNoMoreReceivers",
+                                      "NoReceptionBecauseTransmitting"}) {
+                gatewayPhy[g]->TraceConnectWithoutContext(trace,
+                                                          MakeCallback(&LoraCandidateChannel::GatewayOutcome, this));
+            }
+        }
+        for (uint32_t g = 0; g < gatewayNode.size(); g++) {
+            if (gatewayNode[g] >= gatewayByNode.size()) {
+                gatewayByNode.resize(gatewayNode[g] + 1, NO_DEVICE);
+            }
+            gatewayByNode[gatewayNode[g]] = g;
+        }
+    }
+
+    // Передачи устройств, разосланные только кандидатам
+    uint64_t GetFiltered() const { return nFiltered; }
+
+    // Исходы StartReceive на шлюзах для передач устройств и из них - на
+    // шлюзах вне кандидатов отправителя (должно быть 0)
+    uint64_t GetGatewayReceptions() const { return nGatewayReceptions; }
+    uint64_t GetOutsideCandidates() const { return nOutsideCandidates; }
+
+private:
+    static constexpr uint32_t NO_DEVICE = UINT32_MAX;
+
+    void GatewayOutcome(Ptr<const Packet> packet, uint32_t nodeId)
+    {
+        const LoraUplink* uplink = uplinks->Get(packet->GetUid());
+        uint32_t g = nodeId < gatewayByNode.size() ? gatewayByNode[nodeId] : NO_DEVICE;
+        if (uplink == nullptr || g == NO_DEVICE) {
+            return;
+        }
+        nGatewayReceptions++;
+        // Кэш отвечает HUGE_VAL для шлюза не из строки устройства
+        if (linkCache->GetLossDb(uplink->device, g) == HUGE_VAL) {
+            nOutsideCandidates++;
+        }
+    }
+
+    Ptr<LoraLinkBudgetCacheLossModel> linkCache;
+    Ptr<PropagationLossModel> loss;
+    Ptr<PropagationDelayModel> delay;
+    std::vector<uint32_t> deviceByNode;     // id узла -> строка кэша
+    std::vector<Ptr<LoraPhy>> gatewayPhy;
+    std::vector<Ptr<MobilityModel>> gatewayMobility;
+    std::vector<uint32_t> gatewayNode;
+    std::vector<uint32_t> gatewayByNode;    // id узла -> номер шлюза
+    LoraUplinkTracker* uplinks = nullptr;
+    mutable uint64_t nFiltered = 0;
+    uint64_t nGatewayReceptions = 0;
+    uint64_t nOutsideCandidates = 0;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LoraCandidateChannel);
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_CANDIDATE_CHANNEL_H */
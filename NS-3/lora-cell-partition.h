@@ -0,0 +1,338 @@
+#ifndef LORA_CELL_PARTITION_H
+#define LORA_CELL_PARTITION_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Разбиение области на ячейки шлюзов для параллельного запуска (Partitioned.cc).
+// Ячейка - множество устройств, ближайший шлюз которых - шлюз ячейки.
+// Каждая ячейка моделируется отдельным процессом со всеми шлюзами, но только
+// со своими устройствами; передачи соседних ячеек приходят из их трасс
+// занятости эфира (LoraAirtimeRecord) как внешние помехи LoraSinrReception.
+
+// Первый поток ГСЧ позиций устройств (плитка t - поток + t): одинаков во всех
+// процессах ячеек, поэтому при одном RngRun каждый процесс видит ту же
+// расстановку всей сети
+static constexpr int64_t LORA_CELL_POSITION_STREAM = 1000;
+
+// Одна передача устройства ячейки, услышанная шлюзом gateway (32 байта)
+struct LoraAirtimeRecord
+{
+    int64_t startNs;
+    int64_t durationNs;
+    double frequency;   // Частота канала, как в LoraTag
+    float rxPowerDbm;   // Мощность на шлюзе после замираний
+    uint16_t gateway;   // Глобальный индекс шлюза
+    uint8_t sf;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(LoraAirtimeRecord) == 32, "LoraAirtimeRecord должна занимать 32 байта");
+
+// Заголовок файла трассы эфира ячейки
+struct LoraAirtimeFileHeader
+{
+    char magic[8];          // "LORACEL1"
+    uint32_t recordSize;    // sizeof(LoraAirtimeRecord)
+    uint32_t cell;
+    uint32_t nGateways;
+    uint32_t reserved;
+};
+
+static constexpr char LORA_AIRTIME_MAGIC[8] = {'L', 'O', 'R', 'A', 'C', 'E', 'L', '1'};
+
+// Имя файла трассы эфира ячейки: <prefix>.<cell>.air
+inline std::string LoraCellTraceFile(const std::string& prefix, uint32_t cell)
+{
+    return prefix + "." + std::to_string(cell) + ".air";
+}
+
+// Равномерная расстановка устройств в круге по плиткам квадратной сетки.
+// Число устройств плитки - ее доля площади круга (округление наибольшими
+// остатками), позиции внутри плитки разыгрываются из своего потока ГСЧ.
+// Номера устройств идут подряд по плиткам, поэтому процесс ячейки
+// разыгрывает только плитки, пересекающие его ячейку, и получает те же
+// позиции и номера, что и при розыгрыше всей сети.
+class LoraTiledDisc
+{
+public:
+    LoraTiledDisc(uint32_t nDevices, double radius, uint32_t tilesPerSide)
+        : radius(radius),
+          side(std::max(tilesPerSide, 1u)),
+          step(2 * radius / side),
+          firstDevice(size_t(side) * side + 1, 0)
+    {
+        // Доля площади плитки в круге - по сетке SAMPLES x SAMPLES центров
+        uint32_t nTiles = side * side;
+        std::vector<double> weight(nTiles, 0.0);
+        double total = 0;
+        for (uint32_t t = 0; t < nTiles; t++) {
+            uint32_t inside = 0;
+            for (uint32_t a = 0; a < SAMPLES; a++) {
+                for (uint32_t b = 0; b < SAMPLES; b++) {
+                    double x = MinX(t) + step * (a + 0.5) / SAMPLES;
+                    double y = MinY(t) + step * (b + 0.5) / SAMPLES;
+                    inside += x * x + y * y <= radius * radius;
+                }
+            }
+            weight[t] = inside;
+            total += inside;
+        }
+        std::vector<uint32_t> count(nTiles, 0);
+        std::vector<std::pair<double, uint32_t>> remainder;
+        uint32_t assigned = 0;
+        for (uint32_t t = 0; t < nTiles && total > 0; t++) {
+            double quota = nDevices * weight[t] / total;
+            count[t] = uint32_t(quota);
+            assigned += count[t];
+            if (weight[t] > 0) {
+                remainder.push_back({count[t] - quota, t});
+            }
+        }
+        std::sort(remainder.begin(), remainder.end());
+        for (size_t k = 0; assigned < nDevices && k < remainder.size(); k++, assigned++) {
+            count[remainder[k].second]++;
+        }
+        for (uint32_t t = 0; t < nTiles; t++) {
+            firstDevice[t + 1] = firstDevice[t] + count[t];
+        }
+    }
+
+    uint32_t GetNTiles() const { return side * side; }
+    uint32_t GetFirstDevice(uint32_t tile) const { return firstDevice[tile]; }
+    uint32_t GetCount(uint32_t tile) const { return firstDevice[tile + 1] - firstDevice[tile]; }
+
+    // Позиции устройств плитки в порядке их номеров
+    void Generate(uint32_t tile, std::vector<Vector>& positions) const
+    {
+        Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable>();
+        rng->SetStream(LORA_CELL_POSITION_STREAM + tile);
+        positions.clear();
+        while (positions.size() < GetCount(tile)) {
+            double x = rng->GetValue(MinX(tile), MinX(tile) + step);
+            double y = rng->GetValue(MinY(tile), MinY(tile) + step);
+            if (x * x + y * y <= radius * radius) {
+                positions.push_back(Vector(x, y, 0.0));
+            }
+        }
+    }
+
+    // Ближайшая и самая дальняя точки плитки от point
+    double MinDistance(uint32_t tile, const Vector& point) const
+    {
+        double dx = std::max({MinX(tile) - point.x, 0.0, point.x - MinX(tile) - step});
+        double dy = std::max({MinY(tile) - point.y, 0.0, point.y - MinY(tile) - step});
+        return std::sqrt(dx * dx + dy * dy + point.z * point.z);
+    }
+
+    double MaxDistance(uint32_t tile, const Vector& point) const
+    {
+        double dx = std::max(std::fabs(MinX(tile) - point.x), std::fabs(MinX(tile) + step - point.x));
+        double dy = std::max(std::fabs(MinY(tile) - point.y), std::fabs(MinY(tile) + step - point.y));
+        return std::sqrt(dx * dx + dy * dy + point.z * point.z);
+    }
+
+private:
+    static constexpr uint32_t SAMPLES = 16;
+
+    double MinX(uint32_t tile) const { return -radius + step * (tile % side); }
+    double MinY(uint32_t tile) const { return -radius + step * (tile / side); }
+
+    double radius;
+    uint32_t side;
+    double step;
+    std::vector<uint32_t> firstDevice; // Номер первого устройства плитки; последний - nDevices
+};
+
+class LoraCellPartition
+{
+public:
+    explicit LoraCellPartition(const std::vector<Vector>& gatewayPositions)
+        : gateways(gatewayPositions),
+          cellRadius(gatewayPositions.size(), 0.0)
+    {
+    }
+
+    // Ячейка устройства (ближайший шлюз); радиус ячейки растет до самого
+    // удаленного из отнесенных к ней устройств
+    uint32_t Assign(const Vector& position)
+    {
+        uint32_t nearest = 0;
+        double best = HUGE_VAL;
+        for (uint32_t g = 0; g < gateways.size(); g++) {
+            double distance = CalculateDistance(position, gateways[g]);
+            if (distance < best) {
+                best = distance;
+                nearest = g;
+            }
+        }
+        cellRadius[nearest] = std::max(cellRadius[nearest], best);
+        return nearest;
+    }
+
+    // Могут ли в плитке быть устройства ячейки cell: ближняя точка плитки к
+    // шлюзу ячейки не дальше самой дальней точки плитки от какого-то шлюза
+    bool MayContain(const LoraTiledDisc& disc, uint32_t tile, uint32_t cell) const
+    {
+        return disc.MinDistance(tile, gateways[cell]) <= NearestBound(disc, tile);
+    }
+
+    // Радиусы всех ячеек сверху по плиткам: процесс ячейки не разыгрывает
+    // чужие плитки, а IsNeighbour должен давать один ответ во всех процессах
+    void BoundRadii(const LoraTiledDisc& disc)
+    {
+        for (uint32_t t = 0; t < disc.GetNTiles(); t++) {
+            if (disc.GetCount(t) == 0) {
+                continue;
+            }
+            double nearestBound = NearestBound(disc, t);
+            for (uint32_t c = 0; c < gateways.size(); c++) {
+                if (disc.MinDistance(t, gateways[c]) <= nearestBound) {
+                    cellRadius[c] = std::max(cellRadius[c], disc.MaxDistance(t, gateways[c]));
+                }
+            }
+        }
+    }
+
+    uint32_t GetNCells() const { return gateways.size(); }
+    double GetCellRadius(uint32_t cell) const { return cellRadius[cell]; }
+
+    // Может ли передача устройства ячейки other дойти до шлюза, который слышит
+    // устройство ячейки cell: оба устройства не дальше range от этого шлюза.
+    // range <= 0 - дальность не ограничена, соседи все
+    bool IsNeighbour(uint32_t cell, uint32_t other, double range) const
+    {
+        if (range <= 0) {
+            return true;
+        }
+        return CalculateDistance(gateways[cell], gateways[other]) <=
+               cellRadius[cell] + cellRadius[other] + 2 * range;
+    }
+
+private:
+    // Расстояние, дальше которого ни одна точка плитки не уходит от своего шлюза
+    double NearestBound(const LoraTiledDisc& disc, uint32_t tile) const
+    {
+        double bound = HUGE_VAL;
+        for (const Vector& gateway : gateways) {
+            bound = std::min(bound, disc.MaxDistance(tile, gateway));
+        }
+        return bound;
+    }
+
+    std::vector<Vector> gateways;
+    std::vector<double> cellRadius;
+};
+
+// Потоковая запись трассы эфира ячейки, буфер сбрасывается пачками
+class LoraAirtimeTraceWriter
+{
+public:
+    LoraAirtimeTraceWriter()
+        : file(nullptr),
+          nRecords(0)
+    {
+    }
+
+    ~LoraAirtimeTraceWriter() { Close(); }
+
+    LoraAirtimeTraceWriter(const LoraAirtimeTraceWriter&) = delete;
+    LoraAirtimeTraceWriter& operator=(const LoraAirtimeTraceWriter&) = delete;
+
+    bool Open(const std::string& filename, uint32_t cell, uint32_t nGateways)
+    {
+        file = std::fopen(filename.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        LoraAirtimeFileHeader header;
+        std::memcpy(header.magic, LORA_AIRTIME_MAGIC, sizeof(header.magic));
+        header.recordSize = sizeof(LoraAirtimeRecord);
+        header.cell = cell;
+        header.nGateways = nGateways;
+        header.reserved = 0;
+        std::fwrite(&header, sizeof(header), 1, file);
+        buffer.reserve(BUFFER_RECORDS);
+        return true;
+    }
+
+    bool IsOpen() const { return file != nullptr; }
+
+    void Append(const LoraAirtimeRecord& record)
+    {
+        nRecords++;
+        buffer.push_back(record);
+        if (buffer.size() >= BUFFER_RECORDS) {
+            Flush();
+        }
+    }
+
+    uint64_t GetRecords() const { return nRecords; }
+
+    void Close()
+    {
+        if (file != nullptr) {
+            Flush();
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+private:
+    static constexpr size_t BUFFER_RECORDS = 4096;
+
+    void Flush()
+    {
+        if (!buffer.empty()) {
+            std::fwrite(buffer.data(), sizeof(LoraAirtimeRecord), buffer.size(), file);
+            buffer.clear();
+        }
+    }
+
+    FILE* file;
+    std::vector<LoraAirtimeRecord> buffer;
+    uint64_t nRecords;
+};
+
+// Добавляет в records записи трассы для шлюзов с gatewayMask[g] == true.
+// false, если файл не открылся или это не трасса этой версии
+inline bool LoadAirtimeTrace(const std::string& filename,
+                             const std::vector<bool>& gatewayMask,
+                             std::vector<LoraAirtimeRecord>& records)
+{
+    FILE* file = std::fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    LoraAirtimeFileHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+              std::memcmp(header.magic, LORA_AIRTIME_MAGIC, sizeof(header.magic)) == 0 &&
+              header.recordSize == sizeof(LoraAirtimeRecord);
+    std::vector<LoraAirtimeRecord> chunk(4096);
+    size_t n;
+    while (ok && (n = std::fread(chunk.data(), sizeof(LoraAirtimeRecord), chunk.size(), file)) > 0) {
+        for (size_t k = 0; k < n; k++) {
+            if (chunk[k].gateway < gatewayMask.size() && gatewayMask[chunk[k].gateway]) {
+                records.push_back(chunk[k]);
+            }
+        }
+    }
+    std::fclose(file);
+    return ok;
+}
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_CELL_PARTITION_H */
@@ -0,0 +1,214 @@
+#ifndef LORA_CHECKPOINT_H
+#define LORA_CHECKPOINT_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Заголовок файла снимка сети. За ним без выравнивания идут
+// LoraCheckpointDevice[nDevices] и LoraCheckpointGateway[nGateways].
+struct LoraCheckpointHeader
+{
+    char magic[8];          // "LORACKP2"
+    uint32_t headerSize;    // sizeof(LoraCheckpointHeader)
+    uint32_t deviceSize;    // sizeof(LoraCheckpointDevice)
+    uint32_t nDevices;
+    uint32_t nGateways;
+    int64_t timeNs;         // Симулированное время снимка
+    int64_t periodNs;       // Период отправки устройств
+    uint64_t rngSeed;       // RngSeed и RngRun прогона, снявшего снимок
+    uint64_t rngRun;
+};
+
+// Состояние устройства (40 байт)
+struct LoraCheckpointDevice
+{
+    float x;
+    float y;
+    float z;
+    uint8_t sf;
+    int8_t txPowerDbm;
+    uint16_t fCnt;          // Следующий счетчик кадров MAC (FCnt)
+    int64_t nextSendNs;     // Следующая отправка приложения от момента снимка; -1 - неизвестна
+    uint64_t sent;          // Счетчики за прогон до снимка, той же ширины, что у счетчиков устройств
+    uint64_t received;
+};
+
+static_assert(sizeof(LoraCheckpointDevice) == 40, "LoraCheckpointDevice должна занимать 40 байт");
+
+struct LoraCheckpointGateway
+{
+    double x;
+    double y;
+    double z;
+};
+
+static constexpr char LORA_CHECKPOINT_MAGIC[8] = {'L', 'O', 'R', 'A', 'C', 'K', 'P', '2'};
+
+// Снимок установившегося состояния сети для теплого старта: позиции,
+// SF и мощность устройств, счетчики кадров, счетчики пакетов и
+// расписание отправок.
+// Open() отображает файл в память только для чтения, записи устройств
+// читаются на месте без разбора. Позиции генераторов ns-3 наружу не
+// отдает, поэтому продолжение идет на новых подпотоках (--RngRun), а
+// расписание приложений восстанавливается из снимка. Устройства без
+// известной следующей отправки получают задержку U(0, период) - фазу
+// периодического отправителя в установившемся режиме, так что после
+// прогрева дольше периода они не уходят одной пачкой в момент 0.
+// Продолжение должно идти с тем же периодом отправки, что и снимок.
+class LoraCheckpoint
+{
+public:
+    LoraCheckpoint()
+        : mapped(nullptr),
+          mappedSize(0),
+          header(nullptr),
+          devices(nullptr),
+          gateways(nullptr)
+    {
+        std::memset(&pending, 0, sizeof(pending));
+        std::memcpy(pending.magic, LORA_CHECKPOINT_MAGIC, sizeof(pending.magic));
+        pending.headerSize = sizeof(LoraCheckpointHeader);
+        pending.deviceSize = sizeof(LoraCheckpointDevice);
+    }
+
+    ~LoraCheckpoint() { Release(); }
+
+    LoraCheckpoint(const LoraCheckpoint&) = delete;
+    LoraCheckpoint& operator=(const LoraCheckpoint&) = delete;
+
+    // Запись снимка
+    void SetTime(Time time) { pending.timeNs = time.GetNanoSeconds(); }
+    void SetPeriod(Time period) { pending.periodNs = period.GetNanoSeconds(); }
+
+    void AddGateway(const Vector& position) { newGateways.push_back({position.x, position.y, position.z}); }
+
+    // nextSend отсчитывается от момента снимка, отрицательное - неизвестно
+    void AddDevice(const Vector& position, uint8_t sf, double txPowerDbm, Time nextSend,
+                   uint64_t sent, uint64_t received, uint16_t fCnt)
+    {
+        LoraCheckpointDevice d;
+        d.x = position.x;
+        d.y = position.y;
+        d.z = position.z;
+        d.sf = sf;
+        d.txPowerDbm = int8_t(txPowerDbm);
+        d.fCnt = fCnt;
+        d.nextSendNs = nextSend.IsStrictlyNegative() ? -1 : nextSend.GetNanoSeconds();
+        d.sent = sent;
+        d.received = received;
+        newDevices.push_back(d);
+    }
+
+    bool Write(const std::string& filename)
+    {
+        pending.nDevices = newDevices.size();
+        pending.nGateways = newGateways.size();
+        pending.rngSeed = RngSeedManager::GetSeed();
+        pending.rngRun = RngSeedManager::GetRun();
+        std::ofstream out(filename, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(&pending), sizeof(pending));
+        out.write(reinterpret_cast<const char*>(newDevices.data()), newDevices.size() * sizeof(LoraCheckpointDevice));
+        out.write(reinterpret_cast<const char*>(newGateways.data()),
+                  newGateways.size() * sizeof(LoraCheckpointGateway));
+        return bool(out);
+    }
+
+    // Чтение снимка
+    bool Open(const std::string& filename)
+    {
+        Release();
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(LoraCheckpointHeader)) {
+            close(fd);
+            return false;
+        }
+        void* address = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+        mapped = address;
+        mappedSize = st.st_size;
+
+        const char* base = static_cast<const char*>(address);
+        const LoraCheckpointHeader* h = reinterpret_cast<const LoraCheckpointHeader*>(base);
+        if (std::memcmp(h->magic, LORA_CHECKPOINT_MAGIC, sizeof(h->magic)) != 0 ||
+            h->headerSize != sizeof(LoraCheckpointHeader) || h->deviceSize != sizeof(LoraCheckpointDevice) ||
+            mappedSize < h->headerSize + size_t(h->nDevices) * sizeof(LoraCheckpointDevice) +
+                             size_t(h->nGateways) * sizeof(LoraCheckpointGateway)) {
+            Release();
+            return false;
+        }
+        // Последовательный проход по устройствам при восстановлении
+        madvise(mapped, mappedSize, MADV_SEQUENTIAL);
+        header = h;
+        devices = reinterpret_cast<const LoraCheckpointDevice*>(base + h->headerSize);
+        gateways = reinterpret_cast<const LoraCheckpointGateway*>(devices + h->nDevices);
+        return true;
+    }
+
+    bool IsLoaded() const { return header != nullptr; }
+    const LoraCheckpointHeader& GetHeader() const { return *header; }
+    uint32_t GetNDevices() const { return header->nDevices; }
+    uint32_t GetNGateways() const { return header->nGateways; }
+    const LoraCheckpointDevice& GetDevice(uint32_t i) const { return devices[i]; }
+
+    Vector GetDevicePosition(uint32_t i) const { return Vector(devices[i].x, devices[i].y, devices[i].z); }
+    Vector GetGatewayPosition(uint32_t g) const { return Vector(gateways[g].x, gateways[g].y, gateways[g].z); }
+
+    // Задержка первой отправки устройства в продолжении
+    Time GetInitialDelay(uint32_t i, Ptr<UniformRandomVariable> rng) const
+    {
+        if (devices[i].nextSendNs >= 0) {
+            return NanoSeconds(devices[i].nextSendNs);
+        }
+        return NanoSeconds(int64_t(rng->GetValue(0, double(header->periodNs))));
+    }
+
+private:
+    void Release()
+    {
+        if (mapped != nullptr) {
+            munmap(mapped, mappedSize);
+        }
+        mapped = nullptr;
+        mappedSize = 0;
+        header = nullptr;
+        devices = nullptr;
+        gateways = nullptr;
+    }
+
+    void* mapped;
+    size_t mappedSize;
+    const LoraCheckpointHeader* header;
+    const LoraCheckpointDevice* devices;
+    const LoraCheckpointGateway* gateways;
+
+    LoraCheckpointHeader pending;           // Заголовок снимка для Write()
+    std::vector<LoraCheckpointDevice> newDevices;
+    std::vector<LoraCheckpointGateway> newGateways;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_CHECKPOINT_H */
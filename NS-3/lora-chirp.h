@@ -0,0 +1,423 @@
+#ifndef LORA_CHIRP_H
+#define LORA_CHIRP_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Генератор xoshiro256+ для Монте-Карло по символам (как в LoraBlockFading)
+class LoraChirpRng
+{
+public:
+    explicit LoraChirpRng(uint64_t seed)
+    {
+        for (uint64_t& word : s) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t Next()
+    {
+        uint64_t result = s[0] + s[3];
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = (s[3] << 45) | (s[3] >> 19);
+        return result;
+    }
+
+    // Равномерное на (0, 1)
+    double Uniform() { return ((Next() >> 11) + 0.5) * (1.0 / 9007199254740992.0); }
+
+    // Пара независимых N(0, 1) (Бокс-Мюллер)
+    void Normal(double& a, double& b)
+    {
+        double r = std::sqrt(-2.0 * std::log(Uniform()));
+        double phi = 2 * M_PI * Uniform();
+        a = r * std::cos(phi);
+        b = r * std::sin(phi);
+    }
+
+private:
+    uint64_t s[4];
+};
+
+// БПФ по основанию 2 на раздельных массивах re/im, таблицы строятся один раз
+class LoraFft
+{
+public:
+    explicit LoraFft(uint32_t size)
+        : n(size),
+          cosTable(size / 2),
+          sinTable(size / 2),
+          reversed(size)
+    {
+        for (uint32_t k = 0; k < n / 2; k++) {
+            cosTable[k] = std::cos(2 * M_PI * k / n);
+            sinTable[k] = -std::sin(2 * M_PI * k / n);
+        }
+        uint32_t bits = 0;
+        while ((1u << bits) < n) {
+            bits++;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t r = 0;
+            for (uint32_t b = 0; b < bits; b++) {
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            reversed[i] = r;
+        }
+    }
+
+    // Прямое БПФ на месте (знак экспоненты минус, как numpy.fft.fft)
+    void Forward(float* re, float* im) const
+    {
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t j = reversed[i];
+            if (i < j) {
+                std::swap(re[i], re[j]);
+                std::swap(im[i], im[j]);
+            }
+        }
+        for (uint32_t len = 2; len <= n; len <<= 1) {
+            uint32_t half = len / 2;
+            uint32_t step = n / len;
+            for (uint32_t start = 0; start < n; start += len) {
+                for (uint32_t k = 0; k < half; k++) {
+                    float wr = cosTable[k * step];
+                    float wi = sinTable[k * step];
+                    uint32_t a = start + k;
+                    uint32_t b = a + half;
+                    float tr = re[b] * wr - im[b] * wi;
+                    float ti = re[b] * wi + im[b] * wr;
+                    re[b] = re[a] - tr;
+                    im[b] = im[a] - ti;
+                    re[a] += tr;
+                    im[a] += ti;
+                }
+            }
+        }
+    }
+
+private:
+    uint32_t n;
+    std::vector<float> cosTable;
+    std::vector<float> sinTable;
+    std::vector<uint32_t> reversed;
+};
+
+// Модем LoRa на таблице базового чирпа.
+// Сигнал символа x (Python/lora_modulate.py::loramod) - базовый чирп символа 0,
+// циклически сдвинутый на x * os отсчетов и повернутый на постоянную фазу,
+// поэтому на символ приходится одно комплексное умножение на отсчет без
+// cumsum/exp. Демодуляция: умножение на сопряженный базовый чирп, прореживание
+// до 2^SF отсчетов, БПФ и поиск максимума.
+// Все массивы раздельные re/im типа float, циклы без зависимостей
+// между итерациями векторизуются компилятором (SSE/AVX при -O3).
+class LoraChirpModem
+{
+public:
+    LoraChirpModem(uint8_t spreadingFactor, double bandwidth, double fs)
+        : sf(spreadingFactor),
+          m(1u << spreadingFactor),
+          os(uint32_t(std::lround(fs / bandwidth))),
+          ns(m * os),
+          baseRe(ns),
+          baseIm(ns),
+          phaseRe(m),
+          phaseIm(m),
+          wrapRe(m),
+          wrapIm(m),
+          fft(m),
+          workRe(m),
+          workIm(m)
+    {
+        // Фаза базового чирпа - накопленная сумма частот, как cumsum в loramod
+        double ts = m / bandwidth;
+        double beta = bandwidth / ts;
+        std::vector<double> theta(ns);
+        double sum = 0;
+        for (uint32_t n = 0; n < ns; n++) {
+            double freq = std::fmod(beta * (n / fs), bandwidth);
+            if (freq < 0) {
+                freq += bandwidth;
+            }
+            sum += freq - bandwidth / 2;
+            theta[n] = sum * (1 / fs) * 2 * M_PI;
+            baseRe[n] = std::cos(theta[n]);
+            baseIm[n] = std::sin(theta[n]);
+        }
+        // Поворот символа x: exp(-j theta[s - 1]); после переноса через конец
+        // периода добавляется полная фаза theta[ns - 1]. В первом отсчете
+        // после переноса np.mod в loramod может дать BW - eps вместо 0, и
+        // дальше фаза отличается на 2 pi BW / fs - повторяем это округление
+        for (uint32_t x = 0; x < m; x++) {
+            uint32_t shift = x * os;
+            double phase = x == 0 ? 0.0 : -theta[shift - 1];
+            double wrap = phase + theta[ns - 1];
+            if (shift > 0) {
+                double exact = std::fmod(x / ts + beta * ((ns - shift) / fs), bandwidth);
+                wrap += exact * (1 / fs) * 2 * M_PI;
+            }
+            phaseRe[x] = std::cos(phase);
+            phaseIm[x] = std::sin(phase);
+            wrapRe[x] = std::cos(wrap);
+            wrapIm[x] = std::sin(wrap);
+        }
+    }
+
+    uint8_t GetSpreadingFactor() const { return sf; }
+    uint32_t GetSamplesPerSymbol() const { return ns; }
+    uint32_t GetOversampling() const { return os; }
+
+    // Отсчеты символа x в re/im (ns отсчетов)
+    void Modulate(uint32_t x, float* __restrict re, float* __restrict im) const
+    {
+        uint32_t shift = x * os;
+        float cr = phaseRe[x];
+        float ci = phaseIm[x];
+        uint32_t head = ns - shift;
+        RotateCopy(&baseRe[shift], &baseIm[shift], cr, ci, re, im, head);
+        RotateCopy(&baseRe[0], &baseIm[0], wrapRe[x], wrapIm[x], re + head, im + head, shift);
+    }
+
+    // Символ с наибольшим откликом после дечирпа и БПФ
+    uint32_t Demodulate(const float* __restrict re, const float* __restrict im)
+    {
+        float* __restrict dr = workRe.data();
+        float* __restrict di = workIm.data();
+        const float* __restrict br = baseRe.data();
+        const float* __restrict bi = baseIm.data();
+        // Берется последний отсчет каждой группы из os: фаза loramod - cumsum,
+        // включающий текущий отсчет, и только в этих точках скачок частоты
+        // на BW в момент переноса дает поворот, кратный 2 pi
+        for (uint32_t k = 0; k < m; k++) {
+            uint32_t n = k * os + os - 1;
+            // r * conj(base)
+            dr[k] = re[n] * br[n] + im[n] * bi[n];
+            di[k] = im[n] * br[n] - re[n] * bi[n];
+        }
+        fft.Forward(dr, di);
+        uint32_t best = 0;
+        float bestPower = -1;
+        for (uint32_t k = 0; k < m; k++) {
+            float power = dr[k] * dr[k] + di[k] * di[k];
+            if (power > bestPower) {
+                bestPower = power;
+                best = k;
+            }
+        }
+        return best;
+    }
+
+private:
+    static void RotateCopy(const float* __restrict sr, const float* __restrict si, float cr, float ci,
+                           float* __restrict dr, float* __restrict di, uint32_t count)
+    {
+        for (uint32_t n = 0; n < count; n++) {
+            dr[n] = sr[n] * cr - si[n] * ci;
+            di[n] = sr[n] * ci + si[n] * cr;
+        }
+    }
+
+    uint8_t sf;
+    uint32_t m;
+    uint32_t os;
+    uint32_t ns;
+    std::vector<float> baseRe;
+    std::vector<float> baseIm;
+    std::vector<float> phaseRe;
+    std::vector<float> phaseIm;
+    std::vector<float> wrapRe;
+    std::vector<float> wrapIm;
+    LoraFft fft;
+    std::vector<float> workRe;
+    std::vector<float> workIm;
+};
+
+// Итог сверки модема с эталонными отсчетами loramod
+struct LoraChirpValidation
+{
+    // Символ эталона, демодулированный модемом в другой символ
+    struct Mismatch
+    {
+        uint32_t sf;
+        uint32_t symbol;
+        uint32_t decided;
+    };
+
+    uint32_t blocks = 0;        // Сверенных символов
+    uint32_t badBlocks = 0;     // Блоков с числом отсчетов не как у модема
+    double maxError = 0;        // Наибольший модуль разности отсчетов
+    std::vector<Mismatch> mismatches;
+
+    bool Passed() const { return blocks > 0 && badBlocks == 0 && mismatches.empty() && maxError < 1e-3; }
+};
+
+// Сверка с эталоном из Python/export_chirps.py: блоки
+// "CHIRP sf=<> bw=<> fs=<> symbol=<> samples=<n>", затем n строк "re im".
+// Отсчеты модема сравниваются с эталоном, эталон демодулируется модемом
+inline LoraChirpValidation ValidateLoraChirps(std::istream& in)
+{
+    LoraChirpValidation result;
+    std::string line;
+    while (std::getline(in, line)) {
+        unsigned sf, symbol, samples;
+        double bandwidth, fs;
+        if (std::sscanf(line.c_str(), "CHIRP sf=%u bw=%lf fs=%lf symbol=%u samples=%u",
+                        &sf, &bandwidth, &fs, &symbol, &samples) != 5) {
+            continue;
+        }
+        std::vector<float> refRe(samples), refIm(samples);
+        for (uint32_t n = 0; n < samples; n++) {
+            in >> refRe[n] >> refIm[n];
+        }
+        if (sf < 6 || sf > 12 || symbol >= (1u << sf)) {
+            result.badBlocks++;
+            continue;
+        }
+        LoraChirpModem modem(sf, bandwidth, fs);
+        if (samples != modem.GetSamplesPerSymbol()) {
+            result.badBlocks++;
+            continue;
+        }
+        std::vector<float> re(samples), im(samples);
+        modem.Modulate(symbol, re.data(), im.data());
+        for (uint32_t n = 0; n < samples; n++) {
+            result.maxError = std::max(result.maxError, double(std::hypot(re[n] - refRe[n], im[n] - refIm[n])));
+        }
+        uint32_t decided = modem.Demodulate(refRe.data(), refIm.data());
+        if (decided != symbol) {
+            result.mismatches.push_back({sf, symbol, decided});
+        }
+        result.blocks++;
+    }
+    return result;
+}
+
+// Итог Монте-Карло в одной точке (SF, CR, SNR)
+struct LoraErrorRates
+{
+    uint64_t symbols = 0;
+    uint64_t symbolErrors = 0;
+    uint64_t packets = 0;
+    uint64_t packetErrors = 0;
+
+    double GetSer() const { return symbols > 0 ? double(symbolErrors) / symbols : 0.0; }
+    double GetPer() const { return packets > 0 ? double(packetErrors) / packets : 0.0; }
+
+    void Add(const LoraErrorRates& other)
+    {
+        symbols += other.symbols;
+        symbolErrors += other.symbolErrors;
+        packets += other.packets;
+        packetErrors += other.packetErrors;
+    }
+};
+
+// Число символов пакета без преамбулы (та же формула, что в LoraTimeOnAir)
+inline uint32_t LoraPacketSymbols(uint8_t sf, uint8_t cr, uint32_t payloadBytes)
+{
+    int lowDataRateOptimize = sf >= 11 ? 1 : 0;
+    double blocks = std::ceil((8.0 * payloadBytes - 4 * sf + 28 + 16) / (4 * (sf - 2 * lowDataRateOptimize)));
+    return 8 + uint32_t(std::max(blocks, 0.0)) * (4 + cr);
+}
+
+// Монте-Карло SER/PER на критической дискретизации (fs = BW): АБГШ с SNR в
+// полосе сигнала и, при fading, рэлеевский коэффициент на пакет.
+// Пакет разбит на блоки перемежения: заголовок (8 символов, CR 4/8) и блоки
+// по 4 + CR символов. Ошибка символа после кода Грея портит по биту в
+// кодовых словах блока (диагональное перемежение); код Хэмминга при CR 3, 4
+// исправляет одну ошибку в слове, при CR 1, 2 только обнаруживает.
+// В SF11/12 включена оптимизация низкой скорости: символ несет SF - 2 бита.
+inline LoraErrorRates SimulateLoraErrorRates(uint8_t sf, uint8_t cr, double snrDb, uint32_t payloadBytes,
+                                             uint64_t packets, bool fading, uint64_t seed)
+{
+    LoraChirpModem modem(sf, 125000.0, 125000.0);
+    LoraChirpRng rng(seed);
+    uint32_t m = 1u << sf;
+    uint32_t dropBits = sf >= 11 ? 2 : 0;
+    uint32_t bitsPerSymbol = sf - dropBits;
+    uint32_t nSymbols = LoraPacketSymbols(sf, cr, payloadBytes);
+    double noiseSigma = std::sqrt(std::pow(10.0, -snrDb / 10.0) / 2);
+
+    std::vector<float> re(m);
+    std::vector<float> im(m);
+    std::vector<uint32_t> errorMask(nSymbols);
+    LoraErrorRates rates;
+
+    for (uint64_t p = 0; p < packets; p++) {
+        // Коэффициент канала на пакет: |h|^2 ~ Exp(1)
+        float hr = 1;
+        float hi = 0;
+        if (fading) {
+            double a, b;
+            rng.Normal(a, b);
+            hr = a / M_SQRT2;
+            hi = b / M_SQRT2;
+        }
+        for (uint32_t i = 0; i < nSymbols; i++) {
+            uint32_t data = rng.Next() & ((1u << bitsPerSymbol) - 1);
+            uint32_t x = data << dropBits;
+            modem.Modulate(x, re.data(), im.data());
+            for (uint32_t n = 0; n < m; n += 2) {
+                double a, b, c, d;
+                rng.Normal(a, b);
+                rng.Normal(c, d);
+                float r0 = re[n] * hr - im[n] * hi;
+                float i0 = re[n] * hi + im[n] * hr;
+                float r1 = re[n + 1] * hr - im[n + 1] * hi;
+                float i1 = re[n + 1] * hi + im[n + 1] * hr;
+                re[n] = r0 + noiseSigma * a;
+                im[n] = i0 + noiseSigma * b;
+                re[n + 1] = r1 + noiseSigma * c;
+                im[n + 1] = i1 + noiseSigma * d;
+            }
+            uint32_t y = modem.Demodulate(re.data(), im.data());
+            // Решение по ближайшему допустимому символу при SF - 2 битах
+            uint32_t decided = ((y + (dropBits ? 2 : 0)) % m) >> dropBits;
+            errorMask[i] = (data ^ (data >> 1)) ^ (decided ^ (decided >> 1));
+            rates.symbols++;
+            rates.symbolErrors += errorMask[i] != 0;
+        }
+
+        bool packetOk = true;
+        uint32_t start = 0;
+        while (start < nSymbols && packetOk) {
+            bool header = start == 0;
+            uint32_t blockCr = header ? 4 : cr;
+            uint32_t length = header ? 8 : 4 + cr;
+            uint32_t correctable = blockCr >= 3 ? 1 : 0;
+            for (uint32_t j = 0; j < bitsPerSymbol && packetOk; j++) {
+                uint32_t errors = 0;
+                for (uint32_t i = 0; i < length && start + i < nSymbols; i++) {
+                    errors += (errorMask[start + i] >> ((j + i) % bitsPerSymbol)) & 1;
+                }
+                packetOk = errors <= correctable;
+            }
+            start += length;
+        }
+        rates.packets++;
+        rates.packetErrors += !packetOk;
+    }
+    return rates;
+}
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_CHIRP_H */
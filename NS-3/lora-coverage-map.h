@@ -0,0 +1,462 @@
+#ifndef LORA_COVERAGE_MAP_H
+#define LORA_COVERAGE_MAP_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+
+#include "lora-analytic-pdr.h"
+#include "lora-gateway-grid.h"
+#include "lora-reception-thresholds.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// 8 float/int32 в одном векторе: векторные расширения GCC/Clang, компилятор
+// раскладывает их на AVX, SSE или NEON сам. Векторы передаются только по
+// ссылке: передача 32-байтного вектора по значению без -mavx меняет ABI, и
+// GCC предупреждает об этом (-Wpsabi)
+typedef float LoraV8f __attribute__((vector_size(32)));
+typedef int32_t LoraV8i __attribute__((vector_size(32)));
+
+static constexpr uint32_t LORA_V8 = 8;
+static constexpr uint16_t LORA_COVERAGE_NO_GATEWAY = UINT16_MAX;
+
+// x = a в дорожках, где маска сравнения истинна (все биты дорожки 1 или 0)
+inline void LoraBlend(const LoraV8i& mask, const LoraV8f& a, LoraV8f& x)
+{
+    x = (LoraV8f)((mask & (LoraV8i)a) | (~mask & (LoraV8i)x));
+}
+
+// log2 для положительных нормализованных x: порядок из битов, мантисса
+// рядом по t = (m - 1) / (m + 1); ошибка меньше 2e-5
+inline void LoraFastLog2(const LoraV8f& x, LoraV8f& out)
+{
+    LoraV8i bits = (LoraV8i)x;
+    LoraV8f exponent = __builtin_convertvector(((bits >> 23) & 0xff) - 127, LoraV8f);
+    LoraV8f m = (LoraV8f)((bits & 0x7fffff) | 0x3f800000);
+    LoraV8f t = (m - 1.0f) / (m + 1.0f);
+    LoraV8f t2 = t * t;
+    LoraV8f series = t * (1.0f + t2 * (1.0f / 3 + t2 * (1.0f / 5 + t2 * (1.0f / 7 + t2 * (1.0f / 9)))));
+    out = exponent + series * 2.8853900817779268f; // 2 / ln 2
+}
+
+// 2^x: целая часть в порядок, дробная - многочлен Тейлора 6-й степени;
+// относительная ошибка меньше 2e-5, ниже 2^-126 - ноль
+inline void LoraFastExp2(const LoraV8f& power, LoraV8f& out)
+{
+    LoraV8f x = power;
+    LoraBlend(x < -126.0f, LoraV8f{} - 127.0f, x);
+    LoraBlend(x > 126.0f, LoraV8f{} + 126.0f, x);
+    LoraV8i n = __builtin_convertvector(x, LoraV8i);
+    n += (LoraV8i)(x < __builtin_convertvector(n, LoraV8f));   // Округление вниз для x < 0
+    LoraV8f f = (x - __builtin_convertvector(n, LoraV8f)) * 0.69314718f;
+    LoraV8f p = 1.0f + f * (1.0f + f * (0.5f + f * (1.0f / 6 + f * (1.0f / 24 + f * (1.0f / 120 + f * (1.0f / 720))))));
+    LoraV8f scale = (LoraV8f)((n + 127) << 23);
+    out = scale * p;
+    LoraBlend(n < -126, LoraV8f{}, out);
+}
+
+// Заголовок двоичного растра. За ним по строкам (y от yMin вверх):
+// rssi float[width], snr float[width], gateway uint16[width],
+// outage float[6][width] (SF7..SF12). NaN/LORA_COVERAGE_NO_GATEWAY - ни один
+// шлюз не в пределах дальности.
+struct LoraCoverageHeader
+{
+    char magic[8];          // "LORACOV1"
+    uint32_t width;
+    uint32_t height;
+    uint32_t nGateways;
+    uint32_t reserved;
+    double xMin;            // Левый нижний угол области, м
+    double yMin;
+    double cellSize;        // Сторона клетки, м
+    double txPowerDbm;
+    double noiseFloorDbm;
+};
+
+static_assert(sizeof(LoraCoverageHeader) == 64, "LoraCoverageHeader должен занимать 64 байта");
+
+static constexpr char LORA_COVERAGE_MAGIC[8] = {'L', 'O', 'R', 'A', 'C', 'O', 'V', '1'};
+
+// Карта покрытия области: для центра каждой клетки - RSSI и SNR лучшего
+// шлюза, его индекс и вероятность непокрытия на SF7..SF12 с учетом всех
+// шлюзов (пакет потерян, если его не принял ни один). Канал - LogDistance,
+// рэлеевские замирания со средним |h|^2 и тепловой шум. Порог приема, как у
+// PHY сценария: по умолчанию общий шум + snrThresholdDb (так решают PHY
+// шлюза ns-3 и LoraAnalyticPdr), с SetSinrReception - пороги SF приемника
+// SINR (LORA_SINR_FLOOR_DB), с SetSfThresholds - заданные пороги SF (точка
+// PER = 50% таблицы PER). Затенение и коллизии в карту не входят.
+//
+// Клетки считаются строками по 8 в векторе (LoraV8f), для каждого шлюза -
+// только отрезок строки внутри его дальности; log2 и 2^x - векторными
+// приближениями без вызовов libm. Строки разбирают потоки, а результат
+// пишется по порядку через кольцо из нескольких строк на поток, поэтому
+// память не зависит от размера карты.
+// Файл с расширением .csv пишется таблицей, иначе - двоичным растром.
+class LoraCoverageMap
+{
+public:
+    explicit LoraCoverageMap(const AnalyticChannelParams& params)
+        : params(params),
+          xMin(-1000.0),
+          yMin(-1000.0),
+          cellSize(1.0),
+          width(2000),
+          height(2000),
+          txPowerDbm(14.0),
+          deviceHeight(0.0),
+          sinrReception(false),
+          sfThresholds(false),
+          threads(0)
+    {
+        std::fill(nCovered, nCovered + 6, 0);
+        std::fill(outageSum, outageSum + 6, 0.0);
+    }
+
+    // Квадрат со стороной size от (x0, y0), cells клеток на сторону
+    void SetArea(double x0, double y0, double size, uint32_t cells)
+    {
+        xMin = x0;
+        yMin = y0;
+        width = height = std::max(cells, 1u);
+        cellSize = size / width;
+    }
+
+    void SetTxPower(double dbm) { txPowerDbm = dbm; }
+    void SetDeviceHeight(double z) { deviceHeight = z; }
+
+    // Пороги SF приемника SINR вместо общего порога SNR
+    void SetSinrReception(bool enable) { sinrReception = enable; }
+
+    // Свои пороги SNR для SF7..SF12, dB (приоритетнее SetSinrReception)
+    void SetSfThresholds(const double thresholdDb[6])
+    {
+        std::copy(thresholdDb, thresholdDb + 6, sfThresholdDb);
+        sfThresholds = true;
+    }
+
+    // Число потоков (0 - по числу ядер)
+    void SetThreads(uint32_t n) { threads = n; }
+
+    bool Write(const std::string& filename, const std::vector<Vector>& gatewayPositions)
+    {
+        NS_ABORT_MSG_IF(gatewayPositions.size() >= LORA_COVERAGE_NO_GATEWAY,
+                        "Карта покрытия хранит индекс шлюза в 16 битах: не больше "
+                            << LORA_COVERAGE_NO_GATEWAY - 1 << " шлюзов");
+        gateways = gatewayPositions;
+        bool csv = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0;
+        FILE* file = std::fopen(filename.c_str(), csv ? "w" : "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        Prepare();
+
+        if (csv) {
+            std::fprintf(file, "x,y,gateway,rssi_dbm,snr_db,outage_sf7,outage_sf8,outage_sf9,outage_sf10,"
+                               "outage_sf11,outage_sf12\n");
+        } else {
+            LoraCoverageHeader header;
+            std::memset(&header, 0, sizeof(header));
+            std::memcpy(header.magic, LORA_COVERAGE_MAGIC, sizeof(header.magic));
+            header.width = width;
+            header.height = height;
+            header.nGateways = gateways.size();
+            header.xMin = xMin;
+            header.yMin = yMin;
+            header.cellSize = cellSize;
+            header.txPowerDbm = txPowerDbm;
+            header.noiseFloorDbm = params.noiseFloorDbm;
+            std::fwrite(&header, sizeof(header), 1, file);
+        }
+
+        uint32_t nThreads = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        std::fill(nCovered, nCovered + 6, 0);
+        std::fill(outageSum, outageSum + 6, 0.0);
+
+        // Строка r считается в слот r % ringRows и ждет, пока строка
+        // r - ringRows уйдет в файл; этот поток пишет строки по порядку
+        uint32_t ringRows = nThreads * 8;
+        std::vector<Row> ring(ringRows);
+        std::vector<uint32_t> ready(ringRows, UINT32_MAX);
+        uint32_t written = 0;
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::atomic<uint32_t> next(0);
+
+        std::vector<std::thread> pool;
+        for (uint32_t t = 0; t < nThreads; t++) {
+            pool.emplace_back([&]() {
+                Scratch scratch(vectorsPerRow);
+                for (uint32_t r = next++; r < height; r = next++) {
+                    uint32_t slot = r % ringRows;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        changed.wait(lock, [&]() { return r < written + ringRows; });
+                    }
+                    ComputeRow(r, scratch, ring[slot]);
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        ready[slot] = r;
+                    }
+                    changed.notify_all();
+                }
+            });
+        }
+        for (uint32_t r = 0; r < height; r++) {
+            uint32_t slot = r % ringRows;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return ready[slot] == r; });
+            }
+            Accumulate(ring[slot]);
+            if (csv) {
+                WriteCsvRow(file, r, ring[slot]);
+            } else {
+                WriteRasterRow(file, ring[slot]);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                written = r + 1;
+            }
+            changed.notify_all();
+        }
+        for (std::thread& t : pool) {
+            t.join();
+        }
+        bool ok = std::ferror(file) == 0;
+        std::fclose(file);
+        return ok;
+    }
+
+    uint64_t GetCells() const { return uint64_t(width) * height; }
+
+    // Доля клеток, где SF теряет не больше maxOutage пакетов (по умолчанию 10%)
+    double GetCoverage(uint8_t sf) const { return double(nCovered[sf - 7]) / GetCells(); }
+    double GetMeanOutage(uint8_t sf) const { return outageSum[sf - 7] / GetCells(); }
+
+private:
+    static constexpr double COVERED_OUTAGE = 0.1;
+
+    struct Row
+    {
+        std::vector<float> rssi;
+        std::vector<float> snr;
+        std::vector<uint16_t> gateway;
+        std::vector<float> outage[6];
+    };
+
+    // Рабочие векторы строки одного потока
+    struct Scratch
+    {
+        explicit Scratch(uint32_t n)
+            : bestRx(n),
+              bestGateway(n)
+        {
+            for (int s = 0; s < 6; s++) {
+                outage[s].resize(n);
+            }
+        }
+
+        std::vector<LoraV8f> bestRx;
+        std::vector<LoraV8i> bestGateway;
+        std::vector<LoraV8f> outage[6];
+    };
+
+    // Постоянные расчета, общие для всех строк
+    void Prepare()
+    {
+        vectorsPerRow = (width + LORA_V8 - 1) / LORA_V8;
+        columnX.assign(vectorsPerRow, LoraV8f{});
+        for (uint32_t v = 0; v < vectorsPerRow; v++) {
+            for (uint32_t lane = 0; lane < LORA_V8; lane++) {
+                columnX[v][lane] = xMin + (v * LORA_V8 + lane + 0.5) * cellSize;
+            }
+        }
+
+        // Rx = Tx - ReferenceLoss - 5 n log10(2) log2(d^2 / d0^2)
+        rxAtReference = txPowerDbm - params.referenceLossDb;
+        lossPerLog2 = 5 * params.exponent * log10(2.0);
+        referenceDistance2 = params.referenceDistance * params.referenceDistance;
+
+        // Вероятность приема на шлюзе: exp(-10^((шум + порог - Rx)/10) / mean);
+        // 10^(x/10) = 2^(x log2(10) / 10), множитель SF выносится в fadingScale
+        for (int s = 0; s < 6; s++) {
+            double thresholdDb = sinrReception ? LORA_SINR_FLOOR_DB[s] : params.snrThresholdDb;
+            if (sfThresholds) {
+                thresholdDb = sfThresholdDb[s];
+            }
+            minRxDbm[s] = params.noiseFloorDbm + thresholdDb;
+            fadingScale[s] = pow(10.0, thresholdDb / 10.0) / params.meanPowerGain * M_LOG2E;
+        }
+
+        // Дальше этой дистанции шлюз не дает приема ни на одном SF (с замираниями -
+        // вероятность ниже e^-40) и в расчет клетки не входит
+        double minUsefulRxDbm = *std::min_element(minRxDbm, minRxDbm + 6);
+        if (params.enableFading) {
+            minUsefulRxDbm -= 10 * log10(40.0 * params.meanPowerGain);
+        }
+        range = LoraGatewayGrid::RangeForLoss(txPowerDbm - minUsefulRxDbm, params.exponent, params.referenceLossDb,
+                                              params.referenceDistance);
+    }
+
+    void ComputeRow(uint32_t row, Scratch& s, Row& out) const
+    {
+        for (uint32_t v = 0; v < vectorsPerRow; v++) {
+            s.bestRx[v] = LoraV8f{} - HUGE_VALF;
+            s.bestGateway[v] = LoraV8i{} - 1;
+            for (int k = 0; k < 6; k++) {
+                s.outage[k][v] = LoraV8f{} + 1.0f;
+            }
+        }
+
+        double y = yMin + (row + 0.5) * cellSize;
+        const float log2Of10Over10 = M_LN10 / M_LN2 / 10;
+        for (uint32_t g = 0; g < gateways.size(); g++) {
+            double dy = y - gateways[g].y;
+            if (fabs(dy) > range) {
+                continue;
+            }
+            // Отрезок строки внутри дальности шлюза, по целым векторам
+            double half = sqrt(range * range - dy * dy);
+            double first = std::floor((gateways[g].x - half - xMin) / cellSize);
+            double last = std::floor((gateways[g].x + half - xMin) / cellSize);
+            if (last < 0 || first >= width) {
+                continue;
+            }
+            uint32_t v0 = uint32_t(std::max(first, 0.0)) / LORA_V8;
+            uint32_t v1 = std::min(uint32_t(last), width - 1) / LORA_V8;
+
+            double dz = gateways[g].z - deviceHeight;
+            float dyz2 = dy * dy + dz * dz;
+            float rangeDx2 = half * half;
+            float gx = gateways[g].x;
+            float d02 = referenceDistance2;
+            float rxRef = rxAtReference;
+            float lossScale = lossPerLog2;
+            float noise = params.noiseFloorDbm;
+            for (uint32_t v = v0; v <= v1; v++) {
+                LoraV8f dx = columnX[v] - gx;
+                // Крайние векторы отрезка частично лежат вне дальности: эти
+                // точки не получают ни шлюза, ни вклада в прием
+                LoraV8i inRange = dx * dx <= rangeDx2;
+                LoraV8f ratio = (dx * dx + dyz2) / d02;
+                LoraBlend(ratio < 1.0f, LoraV8f{} + 1.0f, ratio);
+                LoraV8f log2Ratio;
+                LoraFastLog2(ratio, log2Ratio);
+                LoraV8f rx = rxRef - lossScale * log2Ratio;
+
+                LoraV8i better = (rx > s.bestRx[v]) & inRange;
+                LoraBlend(better, rx, s.bestRx[v]);
+                s.bestGateway[v] = (better & int32_t(g)) | (~better & s.bestGateway[v]);
+
+                if (params.enableFading) {
+                    // 10^((шум - Rx)/10) один раз, дальше умножение на множитель SF
+                    LoraV8f inverseSnr;
+                    LoraFastExp2((noise - rx) * log2Of10Over10, inverseSnr);
+                    for (int k = 0; k < 6; k++) {
+                        LoraV8f pReceive;
+                        LoraFastExp2(inverseSnr * -float(fadingScale[k]), pReceive);
+                        LoraBlend(~inRange, LoraV8f{}, pReceive);
+                        s.outage[k][v] *= 1.0f - pReceive;
+                    }
+                } else {
+                    for (int k = 0; k < 6; k++) {
+                        LoraBlend((rx > float(minRxDbm[k])) & inRange, LoraV8f{}, s.outage[k][v]);
+                    }
+                }
+            }
+        }
+
+        out.rssi.resize(width);
+        out.snr.resize(width);
+        out.gateway.resize(width);
+        for (int k = 0; k < 6; k++) {
+            out.outage[k].resize(width);
+        }
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t v = x / LORA_V8;
+            uint32_t lane = x % LORA_V8;
+            int32_t best = s.bestGateway[v][lane];
+            out.gateway[x] = best < 0 ? LORA_COVERAGE_NO_GATEWAY : uint16_t(best);
+            out.rssi[x] = best < 0 ? NAN : s.bestRx[v][lane];
+            out.snr[x] = out.rssi[x] - float(params.noiseFloorDbm);
+            for (int k = 0; k < 6; k++) {
+                out.outage[k][x] = s.outage[k][v][lane];
+            }
+        }
+    }
+
+    void Accumulate(const Row& row)
+    {
+        for (int k = 0; k < 6; k++) {
+            for (float outage : row.outage[k]) {
+                outageSum[k] += outage;
+                nCovered[k] += outage <= COVERED_OUTAGE;
+            }
+        }
+    }
+
+    void WriteRasterRow(FILE* file, const Row& row) const
+    {
+        std::fwrite(row.rssi.data(), sizeof(float), width, file);
+        std::fwrite(row.snr.data(), sizeof(float), width, file);
+        std::fwrite(row.gateway.data(), sizeof(uint16_t), width, file);
+        for (int k = 0; k < 6; k++) {
+            std::fwrite(row.outage[k].data(), sizeof(float), width, file);
+        }
+    }
+
+    void WriteCsvRow(FILE* file, uint32_t y, const Row& row) const
+    {
+        double cy = yMin + (y + 0.5) * cellSize;
+        for (uint32_t x = 0; x < width; x++) {
+            std::fprintf(file, "%.1f,%.1f,%d,%.2f,%.2f,%.4g,%.4g,%.4g,%.4g,%.4g,%.4g\n", xMin + (x + 0.5) * cellSize,
+                         cy, row.gateway[x] == LORA_COVERAGE_NO_GATEWAY ? -1 : int(row.gateway[x]), row.rssi[x],
+                         row.snr[x], row.outage[0][x], row.outage[1][x], row.outage[2][x], row.outage[3][x],
+                         row.outage[4][x], row.outage[5][x]);
+        }
+    }
+
+    AnalyticChannelParams params;
+    double xMin;
+    double yMin;
+    double cellSize;
+    uint32_t width;
+    uint32_t height;
+    double txPowerDbm;
+    double deviceHeight;
+    bool sinrReception;
+    bool sfThresholds;
+    double sfThresholdDb[6];
+    uint32_t threads;
+
+    std::vector<Vector> gateways;
+    uint32_t vectorsPerRow = 0;
+    std::vector<LoraV8f> columnX;   // x центров клеток строки
+    double rxAtReference = 0;
+    double lossPerLog2 = 0;
+    double referenceDistance2 = 1;
+    double minRxDbm[6] = {};
+    double fadingScale[6] = {};
+    double range = 0;
+
+    uint64_t nCovered[6];
+    double outageSum[6];
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_COVERAGE_MAP_H */
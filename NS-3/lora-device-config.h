@@ -0,0 +1,61 @@
+#ifndef LORA_DEVICE_CONFIG_H
+#define LORA_DEVICE_CONFIG_H
+
+#include "ns3/core-module.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Радиопараметры одного устройства: DR (EU868: DR5 = SF7 ... DR0 = SF12) и мощность
+struct DeviceRadioConfig
+{
+    uint8_t dataRate;
+    uint8_t txPowerDbm;
+
+    uint8_t GetSpreadingFactor() const { return 12 - dataRate; }
+};
+
+// Строка вида "5:14,3:10,1:6" - DR:мощность для устройств 0, 1, 2, ...
+// Используется для передачи назначений из Pso-Ga.cc в сценарий (--deviceConfig).
+// Неверный элемент (не "DR:мощность" или DR вне 0..5) - ошибка с его текстом.
+inline std::vector<DeviceRadioConfig> ParseDeviceConfig(const std::string& spec)
+{
+    std::vector<DeviceRadioConfig> config;
+    std::istringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        unsigned dataRate, power;
+        int length = 0;
+        bool valid = std::sscanf(item.c_str(), "%u:%u%n", &dataRate, &power, &length) == 2 &&
+                     size_t(length) == item.size() && dataRate <= 5 && power <= UINT8_MAX;
+        NS_ABORT_MSG_IF(!valid, "Неверный элемент --deviceConfig \"" << item << "\" (ожидается DR:мощность)");
+        config.push_back({uint8_t(dataRate), uint8_t(power)});
+    }
+    return config;
+}
+
+inline std::string FormatDeviceConfig(const std::vector<DeviceRadioConfig>& config)
+{
+    std::string spec;
+    spec.reserve(config.size() * 5);
+    for (size_t i = 0; i < config.size(); i++) {
+        if (i > 0) {
+            spec += ',';
+        }
+        spec += std::to_string(config[i].dataRate);
+        spec += ':';
+        spec += std::to_string(config[i].txPowerDbm);
+    }
+    return spec;
+}
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_DEVICE_CONFIG_H */
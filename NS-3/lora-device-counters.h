@@ -0,0 +1,122 @@
+#ifndef LORA_DEVICE_COUNTERS_H
+#define LORA_DEVICE_COUNTERS_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lorawan-module.h"
+
+#include "lora-uplink-tracker.h"
+
+#include <ostream>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Счетчики отправленных и доставленных пакетов по каждому устройству.
+// Отправки и доставки берутся из LoraUplinkTracker и считаются по кадрам:
+// повторные передачи подтверждаемого пакета (тот же FCnt) не считаются
+// новыми отправками, доставка кадра - первый прием любым шлюзом, как в
+// LoraPacketTracker::CountMacPacketsGloballyReceived. Итоги печатаются
+// строками "RESULT ...", которые разбирает Replications.cc.
+class LoraDeviceCounters
+{
+public:
+    // Вызывается после настройки SF устройств: SF запоминается при установке
+    void Install(LoraUplinkTracker& tracker)
+    {
+        uint32_t nDevices = tracker.GetNDevices();
+        sent.assign(nDevices, 0);
+        received.assign(nDevices, 0);
+        lastSentNs.assign(nDevices, -1);
+        spreadingFactor.assign(nDevices, 0);
+        txPowerDbm.assign(nDevices, 0.0);
+
+        for (uint32_t i = 0; i < nDevices; i++) {
+            Ptr<ClassAEndDeviceLorawanMac> edMac = tracker.GetMac(i);
+            spreadingFactor[i] = edMac->GetSfFromDataRate(edMac->GetDataRate());
+            txPowerDbm[i] = edMac->GetTransmissionPower();
+        }
+        tracker.TraceSent(MakeCallback(&LoraDeviceCounters::Sent, this));
+        tracker.TraceReceived(MakeCallback(&LoraDeviceCounters::Received, this));
+    }
+
+    // Счетчики прошлых прогонов (теплый старт из снимка)
+    void AddHistory(uint32_t device, uint64_t sentBefore, uint64_t receivedBefore)
+    {
+        sent[device] += sentBefore;
+        received[device] += receivedBefore;
+    }
+
+    // Номера устройств в строках RESULT, если процесс моделирует часть сети
+    // (ячейку при разбиении); по умолчанию - индекс в endDevices
+    void SetGlobalIndices(const std::vector<uint32_t>& indices) { globalIndex = indices; }
+
+    uint32_t GetNDevices() const { return sent.size(); }
+    uint64_t GetSent(uint32_t device) const { return sent[device]; }
+    uint64_t GetReceived(uint32_t device) const { return received[device]; }
+    uint8_t GetSpreadingFactor(uint32_t device) const { return spreadingFactor[device]; }
+
+    // Итоги по всем устройствам, те же, что в строках RESULT
+    uint64_t GetTotalSent() const { return Sum(sent); }
+    uint64_t GetTotalReceived() const { return Sum(received); }
+
+    // SF и мощность, измененные во время прогона (команды ADR)
+    void SetRadio(uint32_t device, uint8_t sf, double powerDbm)
+    {
+        spreadingFactor[device] = sf;
+        txPowerDbm[device] = powerDbm;
+    }
+
+    // Время последней отправки, нс; -1 - устройство еще не отправляло
+    int64_t GetLastSent(uint32_t device) const { return lastSentNs[device]; }
+    const std::vector<uint8_t>& GetSpreadingFactors() const { return spreadingFactor; }
+    const std::vector<double>& GetTxPowers() const { return txPowerDbm; }
+
+    // Одна строка на устройство: RESULT device=<i> sf=<sf> sent=<n> received=<m>
+    void Print(std::ostream& os) const
+    {
+        for (uint32_t i = 0; i < sent.size(); i++) {
+            os << "RESULT device=" << (globalIndex.empty() ? i : globalIndex[i]) << " sf=" << unsigned(spreadingFactor[i])
+               << " sent=" << sent[i] << " received=" << received[i] << "\n";
+        }
+        os.flush();
+    }
+
+private:
+    static uint64_t Sum(const std::vector<uint64_t>& counts)
+    {
+        uint64_t total = 0;
+        for (uint64_t n : counts) {
+            total += n;
+        }
+        return total;
+    }
+
+    void Sent(const LoraUplink& uplink)
+    {
+        if (uplink.newFrame) {
+            sent[uplink.device]++;
+        }
+        lastSentNs[uplink.device] = uplink.sentNs;
+    }
+
+    void Received(const LoraUplink& uplink, const LoraUplinkReception& reception)
+    {
+        if (reception.delivery) {
+            received[uplink.device]++;
+        }
+    }
+
+    std::vector<uint64_t> sent;
+    std::vector<uint64_t> received;
+    std::vector<int64_t> lastSentNs;
+    std::vector<uint8_t> spreadingFactor;
+    std::vector<double> txPowerDbm;
+    std::vector<uint32_t> globalIndex;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_DEVICE_COUNTERS_H */
@@ -0,0 +1,345 @@
+#ifndef LORA_DEVICE_POPULATION_H
+#define LORA_DEVICE_POPULATION_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/lorawan-module.h"
+#include "ns3/lora-tag.h"
+
+#include "lora-airtime.h"
+#include "lora-batched-sender.h"
+#include "lora-gateway-grid.h"
+#include "lora-link-budget-cache.h"
+#include "lora-noise-fading-loss-model.h"
+#include "lora-profiler.h"
+#include "lora-uplink-tracker.h"
+
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Облегченная популяция периодических устройств класса A без узлов ns-3.
+// Вместо Node + LoraNetDevice + MAC + PHY + мобильности + приложения на
+// устройство хранятся массивы структуры (SoA): координаты, SF, мощность,
+// счетчики, FCnt; моменты отправки - в календарной очереди LoraSendCalendar.
+// Около 30 байт на устройство и еще около 17 в LoraUplinkTracker, миллион
+// устройств - десятки мегабайт.
+//
+// Передача идет в ту же цепочку потерь и задержки канала и в те же PHY
+// шлюзов (StartReceive), что у обычных устройств. Потери считаются от
+// одного служебного узла, который перед отправкой ставится в точку
+// устройства; кэш потерь его не знает и считает исходную модель, поэтому
+// шлюзы-кандидаты отбираются здесь же сеткой LoraGatewayGrid. Перед
+// расчетом моделям цепочки сообщается, чья это передача: кэшу - номер
+// устройства для затенения пары, модели шума - номер устройства и передачи
+// для замираний и SF для таблицы PER. Замирания независимы на каждый пакет:
+// интервал когерентности узла здесь не имеет смысла.
+// Пакет несет заголовки LoRaWAN с адресом, равным индексу устройства,
+// собственным FCnt устройства и LoraTag, как пакеты MAC класса A. Каждая
+// передача после расчета потерь сообщается LoraUplinkTracker (AddSent),
+// так что счетчики кадров, трасса, метрики по окнам и прием по SINR видят
+// популяцию так же, как устройства с узлами. Доставка - первый прием кадра
+// любым шлюзом из того же LoraUplinkTracker.
+// Duty cycle не проверяется: период отправки должен быть не меньше ToA * 100.
+class LoraDevicePopulation
+{
+public:
+    LoraDevicePopulation()
+        : period(Seconds(600)),
+          slot(Seconds(1)),
+          basePacketSize(10),
+          channelsMhz({868.1, 868.3, 868.5}),
+          initialDelay(CreateObject<UniformRandomVariable>()),
+          channelRng(CreateObject<UniformRandomVariable>()),
+          stopNs(INT64_MAX),
+          uplinks(nullptr),
+          nSent(0),
+          nReceived(0),
+          nWakeups(0)
+    {
+    }
+
+    void SetPeriod(Time p) { period = p; }
+    void SetSlot(Time s) { slot = s; }
+    void SetBasePacketSize(uint8_t size) { basePacketSize = size; }
+    void SetPacketSizeRandomVariable(Ptr<RandomVariableStream> rv) { packetSize = rv; }
+
+    // Каналы восходящей связи, МГц (по умолчанию - три обязательных EU868)
+    void SetChannels(const std::vector<double>& frequenciesMhz) { channelsMhz = frequenciesMhz; }
+
+    // n устройств с позициями из allocator, SF12 и 14 dBm, как у MAC по умолчанию
+    void CreateDevices(uint32_t n, Ptr<PositionAllocator> allocator)
+    {
+        x.resize(n);
+        y.resize(n);
+        sf.assign(n, 12);
+        txPowerDbm.assign(n, 14);
+        sent.assign(n, 0);
+        received.assign(n, 0);
+        fCnt.assign(n, 0);
+        for (uint32_t d = 0; d < n; d++) {
+            Vector pos = allocator->GetNext();
+            x[d] = pos.x;
+            y[d] = pos.y;
+        }
+    }
+
+    void SetRadio(uint32_t device, uint8_t spreadingFactor, int8_t powerDbm)
+    {
+        sf[device] = spreadingFactor;
+        txPowerDbm[device] = powerDbm;
+    }
+
+    // Задержка первой отправки (например, из снимка); без нее - U(0, период)
+    void SetFirstSend(uint32_t device, Time delay)
+    {
+        if (firstSendNs.empty()) {
+            firstSendNs.assign(sf.size(), -1);
+        }
+        firstSendNs[device] = delay.GetNanoSeconds();
+    }
+
+    // Счетчики и FCnt прошлых прогонов (теплый старт из снимка). Счетчики
+    // популяции 32-битные ради памяти: больший снимок отвергается
+    void AddHistory(uint32_t device, uint64_t sentBefore, uint64_t receivedBefore, uint16_t nextFrame)
+    {
+        NS_ABORT_MSG_IF(sent[device] + sentBefore > UINT32_MAX || received[device] + receivedBefore > UINT32_MAX,
+                        "Счетчики устройства " << device << " популяции не помещаются в 32 бита");
+        sent[device] += sentBefore;
+        received[device] += receivedBefore;
+        fCnt[device] = nextFrame;
+    }
+
+    // Модель шума и замираний из цепочки потерь: ей сообщается, чья
+    // передача считается (замирания, SF для таблицы PER)
+    void SetFadingModel(Ptr<LoraNoiseFadingLossModel> model) { fadingModel = model; }
+
+    // Кэш потерь из цепочки: затенение пары устройство-шлюз
+    void SetLinkBudgetCache(Ptr<LoraLinkBudgetCacheLossModel> cache) { linkCache = cache; }
+
+    // Цепочка потерь и модель задержки канала; maxRange <= 0 - все шлюзы.
+    // tracker ставится на GetN() устройств без узлов до Install
+    void Install(LoraUplinkTracker& tracker,
+                 NodeContainer gateways,
+                 Ptr<PropagationLossModel> lossModel,
+                 Ptr<PropagationDelayModel> delayModel,
+                 double maxRange)
+    {
+        uplinks = &tracker;
+        loss = lossModel;
+        delay = delayModel;
+        tracker.TraceReceived(MakeCallback(&LoraDevicePopulation::Received, this));
+
+        // Служебный узел: модели потерь берут id узла из мобильности передатчика
+        Ptr<Node> proxy = CreateObject<Node>();
+        proxyMobility = CreateObject<ConstantPositionMobilityModel>();
+        proxy->AggregateObject(proxyMobility);
+        proxyNode = proxy->GetId();
+        if (fadingModel) {
+            fadingModel->SetProxyNode(proxyNode);
+        }
+        if (linkCache) {
+            linkCache->SetProxyNode(proxyNode);
+        }
+
+        std::vector<Vector> positions;
+        for (uint32_t g = 0; g < gateways.GetN(); g++) {
+            Ptr<Node> node = gateways.Get(g);
+            Ptr<LoraNetDevice> loraNetDev = node->GetDevice(0)->GetObject<LoraNetDevice>();
+            gatewayPhy.push_back(loraNetDev->GetPhy());
+            gatewayMobility.push_back(node->GetObject<MobilityModel>());
+            gatewayNode.push_back(node->GetId());
+            positions.push_back(gatewayMobility.back()->GetPosition());
+        }
+        grid.Build(positions, maxRange > 0 ? maxRange : HUGE_VAL);
+    }
+
+    // Первая отправка каждого устройства через U(0, период) после start
+    void Start(Time start, Time stop)
+    {
+        stopNs = stop.GetNanoSeconds();
+        Simulator::Schedule(start, &LoraDevicePopulation::DoStart, this);
+    }
+
+    uint32_t GetN() const { return sf.size(); }
+    uint64_t GetSent() const { return nSent; }
+    uint64_t GetReceived() const { return nReceived; }
+    uint64_t GetWakeups() const { return nWakeups; }
+    uint64_t GetSent(uint32_t device) const { return sent[device]; }
+    uint64_t GetReceived(uint32_t device) const { return received[device]; }
+    uint8_t GetSpreadingFactor(uint32_t device) const { return sf[device]; }
+    // FCnt следующего кадра устройства
+    uint16_t GetFrameCounter(uint32_t device) const { return fCnt[device]; }
+    int8_t GetTxPower(uint32_t device) const { return txPowerDbm[device]; }
+    Vector GetPosition(uint32_t device) const { return Vector(x[device], y[device], 0.0); }
+
+    // Следующая отправка устройства, нс. Устройства слота, в который попал
+    // конец работы, уже сдвинуты на период вперед - возвращаем их обратно
+    int64_t GetNextSendNs(uint32_t device) const
+    {
+        int64_t next = calendar.GetNextSend(device);
+        return next - period.GetNanoSeconds() >= stopNs ? next - period.GetNanoSeconds() : next;
+    }
+
+    // Память популяции без пакетов в эфире, байт
+    size_t GetMemoryBytes() const
+    {
+        return x.capacity() * sizeof(float) + y.capacity() * sizeof(float) + sf.capacity() +
+               txPowerDbm.capacity() + sent.capacity() * sizeof(uint32_t) +
+               received.capacity() * sizeof(uint32_t) + fCnt.capacity() * sizeof(uint16_t) +
+               calendar.GetMemoryBytes();
+    }
+
+    // Строки RESULT в формате LoraDeviceCounters::Print
+    void Print(std::ostream& os) const
+    {
+        for (uint32_t d = 0; d < sf.size(); d++) {
+            os << "RESULT device=" << d << " sf=" << unsigned(sf[d]) << " sent=" << sent[d]
+               << " received=" << received[d] << "\n";
+        }
+        os.flush();
+    }
+
+private:
+    static constexpr double LOST_POWER_DBM = -1000.0;
+
+    void DoStart()
+    {
+        int64_t now = Simulator::Now().GetNanoSeconds();
+        calendar.Reset(period.GetNanoSeconds(), slot.GetNanoSeconds(), sf.size(), now);
+        for (uint32_t d = 0; d < sf.size(); d++) {
+            int64_t delay = !firstSendNs.empty() && firstSendNs[d] >= 0
+                                ? firstSendNs[d]
+                                : Seconds(initialDelay->GetValue(0, period.GetSeconds())).GetNanoSeconds();
+            calendar.Add(d, now + delay);
+        }
+        firstSendNs.clear();
+        firstSendNs.shrink_to_fit();
+        ScheduleWake();
+    }
+
+    void ScheduleWake()
+    {
+        int64_t slotStart;
+        if (calendar.NextSlot(slotStart) && slotStart < stopNs) {
+            int64_t wait = std::max<int64_t>(slotStart - Simulator::Now().GetNanoSeconds(), 0);
+            Simulator::Schedule(NanoSeconds(wait), &LoraDevicePopulation::Wake, this);
+        }
+    }
+
+    void Wake()
+    {
+        nWakeups++;
+        int64_t now = Simulator::Now().GetNanoSeconds();
+        calendar.PopSlot([this, now](uint32_t d, int64_t timeNs) {
+            if (timeNs < stopNs) {
+                Simulator::Schedule(NanoSeconds(std::max<int64_t>(timeNs - now, 0)),
+                                    &LoraDevicePopulation::Send, this, d);
+            }
+        });
+        ScheduleWake();
+    }
+
+    void Send(uint32_t device)
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_MAC_SEND);
+        uint32_t size = basePacketSize + (packetSize ? packetSize->GetInteger() : 0);
+        Ptr<Packet> packet = Create<Packet>(size);
+
+        LoraFrameHeader frameHdr;
+        frameHdr.SetAsUplink();
+        frameHdr.SetAddress(LoraDeviceAddress(device));
+        frameHdr.SetFCnt(fCnt[device]++);
+        packet->AddHeader(frameHdr);
+        LorawanMacHeader macHdr;
+        macHdr.SetMType(LorawanMacHeader::UNCONFIRMED_DATA_UP);
+        packet->AddHeader(macHdr);
+
+        double frequency = channelsMhz[channelRng->GetInteger(0, channelsMhz.size() - 1)];
+        uint8_t spreadingFactor = sf[device];
+        LoraTag tag;
+        tag.SetSpreadingFactor(spreadingFactor);
+        tag.SetFrequency(frequency);
+        packet->AddPacketTag(tag);
+        Time duration = LoraAirtime(spreadingFactor, packet->GetSize());
+
+        Vector position(x[device], y[device], 0.0);
+        proxyMobility->SetPosition(position);
+        double txPower = txPowerDbm[device];
+        if (fadingModel) {
+            fadingModel->SetProxyTransmission(device, sent[device], spreadingFactor);
+        }
+        if (linkCache) {
+            linkCache->SetProxyDevice(device);
+        }
+        grid.ForEachCandidate(position, [&](uint32_t g, double) {
+            double rxPowerDbm = loss->CalcRxPower(txPower, proxyMobility, gatewayMobility[g]);
+            if (rxPowerDbm <= LOST_POWER_DBM) {
+                return;
+            }
+            Simulator::ScheduleWithContext(gatewayNode[g], delay->GetDelay(proxyMobility, gatewayMobility[g]),
+                                           &LoraPhy::StartReceive, gatewayPhy[g], packet->Copy(),
+                                           rxPowerDbm, spreadingFactor, duration, frequency);
+        });
+
+        sent[device]++;
+        nSent++;
+        uplinks->AddSent(device, packet, proxyNode, txPower, spreadingFactor);
+    }
+
+    void Received(const LoraUplink& uplink, const LoraUplinkReception& reception)
+    {
+        if (uplink.proxy && reception.delivery) {
+            received[uplink.device]++;
+            nReceived++;
+        }
+    }
+
+    Time period;
+    Time slot;
+    uint8_t basePacketSize;
+    Ptr<RandomVariableStream> packetSize;
+    std::vector<double> channelsMhz;
+    Ptr<UniformRandomVariable> initialDelay;
+    Ptr<UniformRandomVariable> channelRng;
+    int64_t stopNs;
+
+    // Состояние устройств (SoA)
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<uint8_t> sf;
+    std::vector<int8_t> txPowerDbm;
+    std::vector<uint32_t> sent;
+    std::vector<uint32_t> received;
+    std::vector<uint16_t> fCnt;         // FCnt следующего кадра
+    std::vector<int64_t> firstSendNs;   // Только при восстановлении, до старта
+    LoraSendCalendar calendar;
+
+    Ptr<PropagationLossModel> loss;
+    Ptr<PropagationDelayModel> delay;
+    Ptr<MobilityModel> proxyMobility;
+    uint32_t proxyNode = 0;
+    Ptr<LoraNoiseFadingLossModel> fadingModel;
+    Ptr<LoraLinkBudgetCacheLossModel> linkCache;
+    std::vector<Ptr<LoraPhy>> gatewayPhy;
+    std::vector<Ptr<MobilityModel>> gatewayMobility;
+    std::vector<uint32_t> gatewayNode;
+    LoraGatewayGrid grid;
+
+    LoraUplinkTracker* uplinks;
+    uint64_t nSent;
+    uint64_t nReceived;
+    uint64_t nWakeups;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_DEVICE_POPULATION_H */
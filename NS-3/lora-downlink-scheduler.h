@@ -0,0 +1,459 @@
+#ifndef LORA_DOWNLINK_SCHEDULER_H
+#define LORA_DOWNLINK_SCHEDULER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lorawan-module.h"
+#include "ns3/lora-tag.h"
+
+#include "lora-airtime.h"
+#include "lora-binary-log.h"
+#include "lora-uplink-tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Частота и SF окна RX2 EU868 (869.525 МГц, DR0)
+static constexpr double LORA_RX2_FREQUENCY_MHZ = 869.525;
+static constexpr uint8_t LORA_RX2_SF = 12;
+
+class LoraDownlinkScheduler;
+
+// Компонент контроллера сетевого сервера для устройств, чьи ACK отправляет
+// LoraDownlinkScheduler: ответ сервера им сбрасывается перед окном приема,
+// иначе ACK ушел бы дважды. Команды MAC этим устройствам (LinkADRReq)
+// добавляются в ACK планировщика (LoraDownlinkScheduler::AddLinkAdrReq)
+class LoraDownlinkComponent : public NetworkControllerComponent
+{
+public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::LoraDownlinkComponent")
+                                .SetParent<NetworkControllerComponent>()
+                                .SetGroupName("Lorawan")
+                                .AddConstructor<LoraDownlinkComponent>();
+        return tid;
+    }
+
+    LoraDownlinkComponent()
+        : scheduler(nullptr)
+    {
+    }
+
+    void SetScheduler(const LoraDownlinkScheduler* downlinkScheduler) { scheduler = downlinkScheduler; }
+
+    void OnReceivedPacket(Ptr<const Packet> packet,
+                          Ptr<EndDeviceStatus> status,
+                          Ptr<NetworkStatus> networkStatus) override {}
+
+    void BeforeSendingReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override;
+
+    void OnFailedReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus) override {}
+
+private:
+    const LoraDownlinkScheduler* scheduler;
+};
+
+// Планировщик подтверждений (ACK) подтверждаемых восходящих пакетов на
+// шлюзах вместо сетевого сервера. Каждый принятый подтверждаемый пакет
+// дает ожидающий ACK с моментом окна RX1 (конец передачи + 1 с); ACK лежат
+// в двоичной куче по моменту окна, так что постановка и выбор - O(log n).
+// В момент окна выбирается шлюз из принявших пакет, по убыванию мощности
+// приема: шлюз не должен уже передавать, а в его корзине duty cycle
+// подполосы (LoraDutyCycle по шлюзам) должен быть запас на ACK. Если в RX1
+// такого шлюза нет, ACK переносится в RX2 (869.525 МГц, SF12, полоса 10%),
+// после RX2 - отбрасывается.
+//
+// ACK уходит через PHY шлюза, поэтому полудуплекс моделирует сам PHY: пока
+// шлюз передает, восходящие пакеты на нем теряются (трасса
+// NoReceptionBecauseTransmitting), и эти потери считаются по шлюзам.
+// Передачи устройств и их приемы шлюзами приходят из LoraUplinkTracker.
+// Сетевой сервер этим устройствам не отвечает (LoraDownlinkComponent), а
+// его команды ADR уходят в ACK планировщика. Каждая передача шлюза
+// сообщается подписчикам TraceTransmit (полудуплекс в модели SINR).
+// Ожидающие ACK хранятся в пуле со списком свободных записей, а ссылка
+// передачи на свой ACK - в массиве по slot передачи в трекере: после
+// прогрева ACK не выделяют память.
+class LoraDownlinkScheduler
+{
+public:
+    LoraDownlinkScheduler()
+        : txPowerDbm(14.0),
+          rx1DelayNs(Seconds(1).GetNanoSeconds()),
+          dispatchNs(INT64_MAX),
+          nRequested(0),
+          nSentRx1(0),
+          nSentRx2(0),
+          nDropped(0),
+          nBlockedBusy(0),
+          nBlockedDutyCycle(0),
+          nDeviceReceived(0),
+          nLostTransmitting(0)
+    {
+    }
+
+    // Мощность передачи ACK, dBm
+    void SetTxPower(double dbm) { txPowerDbm = dbm; }
+
+    // confirmedDevices[i] - устройство i шлет подтверждаемые пакеты; MType и число
+    // передач MAC устройства настраиваются снаружи. Узлы нужны для трасс
+    // приема ACK устройствами и передачи шлюзов; индексы берутся из tracker
+    void Install(LoraUplinkTracker& tracker,
+                 NodeContainer endDevices,
+                 NodeContainer gateways,
+                 const std::vector<bool>& confirmedDevices)
+    {
+        uplinks = &tracker;
+        for (uint32_t i = 0; i < tracker.GetNDevices(); i++) {
+            confirmed.push_back(i < confirmedDevices.size() && confirmedDevices[i]);
+            if (confirmed[i]) {
+                confirmedMacs.insert(PeekPointer(tracker.GetMac(i)));
+            }
+        }
+        slots.assign(tracker.GetSlots(), SlotState());
+        tracker.TraceSent(MakeCallback(&LoraDownlinkScheduler::Sent, this));
+        tracker.TraceReceived(MakeCallback(&LoraDownlinkScheduler::Received, this));
+
+        for (uint32_t i = 0; i < endDevices.GetN(); i++) {
+            endDevices.Get(i)->GetDevice(0)->GetObject<LoraNetDevice>()->GetPhy()->TraceConnectWithoutContext(
+                "ReceivedPacket", MakeCallback(&LoraDownlinkScheduler::DeviceReceived, this));
+        }
+
+        for (uint32_t g = 0; g < gateways.GetN(); g++) {
+            Ptr<LoraPhy> phy = gateways.Get(g)->GetDevice(0)->GetObject<LoraNetDevice>()->GetPhy();
+            gatewayPhy.push_back(phy);
+            phy->TraceConnectWithoutContext(
+                "NoReceptionBecauseTransmitting",
+                MakeCallback(&LoraDownlinkScheduler::GatewayTransmitting, this));
+        }
+        busyUntilNs.assign(gateways.GetN(), 0);
+        lostTransmitting.assign(gateways.GetN(), 0);
+        dutyCycle.Resize(gateways.GetN());
+    }
+
+    // Компонент для NetworkServer::AddComponent
+    Ptr<LoraDownlinkComponent> CreateComponent() const
+    {
+        Ptr<LoraDownlinkComponent> component = CreateObject<LoraDownlinkComponent>();
+        component->SetScheduler(this);
+        return component;
+    }
+
+    // ACK этому устройству отправляет планировщик, а не сервер
+    bool ServesDevice(Ptr<ClassAEndDeviceLorawanMac> mac) const
+    {
+        return confirmedMacs.count(PeekPointer(mac)) > 0;
+    }
+
+    // LinkADRReq в ожидающий ACK пакета uid; false - ACK для него не ждет.
+    // channels должен жить до отправки ACK
+    bool AddLinkAdrReq(uint64_t uid, uint8_t dataRate, uint8_t txPowerIndex, const std::list<int>* channels)
+    {
+        const LoraUplink* uplink = uplinks->Get(uid);
+        if (uplink == nullptr || slots[uplink->slot].done || slots[uplink->slot].ack == NO_INDEX) {
+            return false;
+        }
+        PendingAck& ack = pool[slots[uplink->slot].ack];
+        ack.adrDataRate = int8_t(dataRate);
+        ack.adrTxPowerIndex = txPowerIndex;
+        ack.adrChannels = channels;
+        return true;
+    }
+
+    // Подписчик получает индекс шлюза и момент конца его передачи, нс
+    void TraceTransmit(Callback<void, uint32_t, int64_t> callback) { transmitTrace.ConnectWithoutContext(callback); }
+
+    uint64_t GetRequested() const { return nRequested; }
+    uint64_t GetSentRx1() const { return nSentRx1; }
+    uint64_t GetSentRx2() const { return nSentRx2; }
+    uint64_t GetDropped() const { return nDropped; }
+
+    // Отказы шлюзу-кандидату: уже передает / нет запаса duty cycle
+    uint64_t GetBlockedBusy() const { return nBlockedBusy; }
+    uint64_t GetBlockedDutyCycle() const { return nBlockedDutyCycle; }
+
+    // ACK, принятые устройствами-адресатами
+    uint64_t GetDeviceReceived() const { return nDeviceReceived; }
+
+    // Восходящие пакеты, потерянные шлюзом во время передачи
+    uint64_t GetLostTransmitting() const { return nLostTransmitting; }
+    uint64_t GetLostTransmitting(uint32_t gateway) const { return lostTransmitting[gateway]; }
+
+    // Доля времени в эфире шлюзов на передачу ACK, наибольшая по шлюзам
+    double GetMaxGatewayDutyCycle(Time elapsed) const { return dutyCycle.GetMaxDeviceDutyCycle(elapsed); }
+
+private:
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+    static constexpr uint32_t MAX_CANDIDATES = 4;
+
+    // Состояние передачи по ее slot в трекере
+    struct SlotState
+    {
+        uint32_t ack = NO_INDEX;        // Ожидающий ACK; NO_INDEX - пакет еще не принят
+        int64_t rx1Ns = 0;              // Открытие окна RX1 устройства
+        bool done = true;               // ACK не нужен, уже отправлен или отброшен
+    };
+
+    // Ожидающий ACK (запись пула)
+    struct PendingAck
+    {
+        uint64_t uid;                   // Пакет и его slot в трекере
+        uint32_t slot;
+        uint32_t device;
+        double frequency;
+        uint8_t sf;
+        uint8_t window;                 // 1 - RX1, 2 - RX2
+        uint8_t nCandidates;
+        uint32_t gateway[MAX_CANDIDATES];
+        float rxPowerDbm[MAX_CANDIDATES];
+        int8_t adrDataRate;             // LinkADRReq сервера; -1 - нет
+        uint8_t adrTxPowerIndex;
+        const std::list<int>* adrChannels;
+    };
+
+    struct HeapEntry
+    {
+        int64_t timeNs;
+        uint32_t ack;
+
+        bool operator>(const HeapEntry& other) const { return timeNs > other.timeNs; }
+    };
+
+    // Состояние slot сбрасывается при каждой передаче: он мог принадлежать прежнему пакету
+    void Sent(const LoraUplink& uplink)
+    {
+        SlotState& slot = slots[uplink.slot];
+        slot.ack = NO_INDEX;
+        slot.done = !confirmed[uplink.device];
+        slot.rx1Ns = uplink.sentNs + LoraAirtimeNs(uplink.sf, uplink.size) + rx1DelayNs;
+    }
+
+    void Received(const LoraUplink& uplink, const LoraUplinkReception& reception)
+    {
+        SlotState& slot = slots[uplink.slot];
+        if (slot.done) {
+            return;
+        }
+        float rxPower = std::isnan(reception.rssiDbm) ? -HUGE_VALF : float(reception.rssiDbm);
+        if (slot.ack == NO_INDEX) {
+            slot.ack = Allocate();
+            PendingAck& ack = pool[slot.ack];
+            ack.uid = uplink.uid;
+            ack.slot = uplink.slot;
+            ack.device = uplink.device;
+            ack.frequency = uplink.frequency > 0.0 ? uplink.frequency : 868.1;
+            ack.sf = uplink.sf;
+            ack.window = 1;
+            ack.nCandidates = 0;
+            ack.adrDataRate = -1;
+            nRequested++;
+            Push(slot.rx1Ns, slot.ack);
+        }
+        AddCandidate(pool[slot.ack], reception.gateway, rxPower);
+    }
+
+    // Кандидаты по убыванию мощности; при переполнении вытесняется слабейший
+    static void AddCandidate(PendingAck& ack, uint32_t gateway, float rxPowerDbm)
+    {
+        uint32_t k = ack.nCandidates;
+        if (k == MAX_CANDIDATES) {
+            if (rxPowerDbm <= ack.rxPowerDbm[k - 1]) {
+                return;
+            }
+            k--;
+        } else {
+            ack.nCandidates++;
+        }
+        for (; k > 0 && ack.rxPowerDbm[k - 1] < rxPowerDbm; k--) {
+            ack.gateway[k] = ack.gateway[k - 1];
+            ack.rxPowerDbm[k] = ack.rxPowerDbm[k - 1];
+        }
+        ack.gateway[k] = gateway;
+        ack.rxPowerDbm[k] = rxPowerDbm;
+    }
+
+    uint32_t Allocate()
+    {
+        if (freeAcks.empty()) {
+            pool.push_back(PendingAck());
+            return pool.size() - 1;
+        }
+        uint32_t index = freeAcks.back();
+        freeAcks.pop_back();
+        return index;
+    }
+
+    void Release(uint32_t index)
+    {
+        if (uplinks->Get(pool[index].uid) != nullptr) {
+            slots[pool[index].slot].done = true;
+        }
+        freeAcks.push_back(index);
+    }
+
+    // Одно событие на ближайшее окно; переносится, если пришло окно раньше
+    void Push(int64_t timeNs, uint32_t ack)
+    {
+        heap.push({timeNs, ack});
+        if (timeNs < dispatchNs) {
+            dispatchEvent.Cancel();
+            dispatchNs = timeNs;
+            dispatchEvent = Simulator::Schedule(NanoSeconds(timeNs - Simulator::Now().GetNanoSeconds()),
+                                                &LoraDownlinkScheduler::Dispatch, this);
+        }
+    }
+
+    void Dispatch()
+    {
+        int64_t now = Simulator::Now().GetNanoSeconds();
+        dispatchNs = INT64_MAX;
+        while (!heap.empty() && heap.top().timeNs <= now) {
+            uint32_t index = heap.top().ack;
+            heap.pop();
+            PendingAck& ack = pool[index];
+            if (Transmit(ack, now)) {
+                (ack.window == 1 ? nSentRx1 : nSentRx2)++;
+                Release(index);
+            } else if (ack.window == 1) {
+                ack.window = 2;
+                heap.push({now + rx1DelayNs, index});
+            } else {
+                LORA_BLOG(LORA_LOG_DOWNLINK_DROPPED, ack.device);
+                nDropped++;
+                Release(index);
+            }
+        }
+        if (!heap.empty()) {
+            dispatchNs = heap.top().timeNs;
+            dispatchEvent = Simulator::Schedule(NanoSeconds(dispatchNs - now), &LoraDownlinkScheduler::Dispatch, this);
+        }
+    }
+
+    // Передает ACK в текущем окне через первый подходящий шлюз
+    bool Transmit(const PendingAck& ack, int64_t now)
+    {
+        double frequency = ack.window == 1 ? ack.frequency : LORA_RX2_FREQUENCY_MHZ;
+        uint8_t sf = ack.window == 1 ? ack.sf : LORA_RX2_SF;
+        uint32_t band = LoraSubBandIndex(frequency);
+
+        Ptr<Packet> packet = Create<Packet>(0);
+        LoraFrameHeader frameHdr;
+        frameHdr.SetAsDownlink();
+        frameHdr.SetAddress(uplinks->GetMac(ack.device)->GetDeviceAddress());
+        frameHdr.SetAck(true);
+        if (ack.adrDataRate >= 0) {
+            frameHdr.AddLinkAdrReq(ack.adrDataRate, ack.adrTxPowerIndex, *ack.adrChannels, 1);
+        }
+        packet->AddHeader(frameHdr);
+        LorawanMacHeader macHdr;
+        macHdr.SetMType(LorawanMacHeader::UNCONFIRMED_DATA_DOWN);
+        packet->AddHeader(macHdr);
+        int64_t airtimeNs = LoraAirtimeNs(sf, packet->GetSize());
+
+        for (uint32_t k = 0; k < ack.nCandidates; k++) {
+            uint32_t g = ack.gateway[k];
+            if (busyUntilNs[g] > now) {
+                nBlockedBusy++;
+                continue;
+            }
+            if (band == LORA_EU868_N_SUB_BANDS || !dutyCycle.CanTransmit(g, band, airtimeNs, now)) {
+                nBlockedDutyCycle++;
+                continue;
+            }
+            dutyCycle.Consume(g, band, airtimeNs, now);
+            busyUntilNs[g] = now + airtimeNs;
+
+            LoraTag tag;
+            tag.SetSpreadingFactor(sf);
+            tag.SetFrequency(frequency);
+            packet->AddPacketTag(tag);
+            LoraTxParameters params;
+            params.sf = sf;
+            gatewayPhy[g]->Send(packet, params, frequency, txPowerDbm);
+            transmitTrace(g, busyUntilNs[g]);
+            return true;
+        }
+        return false;
+    }
+
+    // PHY устройства принимает и чужие нисходящие пакеты на том же SF и
+    // частоте: считаем только ACK, адресованные самому устройству
+    void DeviceReceived(Ptr<const Packet> packet, uint32_t nodeId)
+    {
+        uint32_t device = uplinks->GetDevice(nodeId);
+        if (device == NO_INDEX) {
+            return;
+        }
+        Ptr<Packet> copy = packet->Copy();
+        LorawanMacHeader macHdr;
+        copy->RemoveHeader(macHdr);
+        if (macHdr.IsUplink()) {
+            return;
+        }
+        LoraFrameHeader frameHdr;
+        frameHdr.SetAsDownlink();
+        copy->RemoveHeader(frameHdr);
+        if (frameHdr.GetAck() && frameHdr.GetAddress() == uplinks->GetMac(device)->GetDeviceAddress()) {
+            nDeviceReceived++;
+        }
+    }
+
+    void GatewayTransmitting(Ptr<const Packet>, uint32_t nodeId)
+    {
+        uint32_t gateway = uplinks->GetGateway(nodeId);
+        if (gateway != NO_INDEX) {
+            lostTransmitting[gateway]++;
+            nLostTransmitting++;
+        }
+    }
+
+    double txPowerDbm;
+    int64_t rx1DelayNs;
+
+    LoraUplinkTracker* uplinks = nullptr;
+    std::vector<bool> confirmed;
+    std::unordered_set<const ClassAEndDeviceLorawanMac*> confirmedMacs;
+    std::vector<Ptr<LoraPhy>> gatewayPhy;
+    std::vector<int64_t> busyUntilNs;        // Конец текущей передачи шлюза
+    std::vector<uint64_t> lostTransmitting;
+    LoraDutyCycle dutyCycle;                 // Корзины [шлюз][подполоса]
+
+    std::vector<SlotState> slots;            // По slot передачи в трекере
+    std::vector<PendingAck> pool;
+    std::vector<uint32_t> freeAcks;
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+    EventId dispatchEvent;
+    int64_t dispatchNs;
+    TracedCallback<uint32_t, int64_t> transmitTrace;
+
+    uint64_t nRequested;
+    uint64_t nSentRx1;
+    uint64_t nSentRx2;
+    uint64_t nDropped;
+    uint64_t nBlockedBusy;
+    uint64_t nBlockedDutyCycle;
+    uint64_t nDeviceReceived;
+    uint64_t nLostTransmitting;
+};
+
+inline void
+LoraDownlinkComponent::BeforeSendingReply(Ptr<EndDeviceStatus> status, Ptr<NetworkStatus> networkStatus)
+{
+    if (scheduler != nullptr && scheduler->ServesDevice(status->GetMac())) {
+        status->InitializeReply();
+    }
+}
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_DOWNLINK_SCHEDULER_H */
@@ -0,0 +1,139 @@
+#ifndef LORA_GATEWAY_GRID_H
+#define LORA_GATEWAY_GRID_H
+
+#include "ns3/core-module.h"
+#include "ns3/mobility-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Равномерная сетка шлюзов для отбора кандидатов на прием.
+// Размер ячейки равен максимальной дальности связи, поэтому все шлюзы в
+// пределах дальности лежат в 3x3 соседних ячейках. Ячейки хранятся в
+// формате CSR: cellStart[c]..cellStart[c+1] - индексы шлюзов ячейки c.
+class LoraGatewayGrid
+{
+public:
+    LoraGatewayGrid()
+        : range(0.0),
+          cellSize(1.0),
+          minX(0.0),
+          minY(0.0),
+          nx(0),
+          ny(0)
+    {
+    }
+
+    // Дальность, на которой потери LogDistance достигают maxLossDb
+    static double RangeForLoss(double maxLossDb, double exponent, double referenceLossDb,
+                               double referenceDistance = 1.0)
+    {
+        return referenceDistance * pow(10.0, (maxLossDb - referenceLossDb) / (10 * exponent));
+    }
+
+    void Build(const std::vector<Vector>& gatewayPositions, double maxRange)
+    {
+        positions = gatewayPositions;
+        range = maxRange;
+        cellSize = std::max(maxRange, 1.0);
+
+        double maxX = -HUGE_VAL;
+        double maxY = -HUGE_VAL;
+        minX = minY = HUGE_VAL;
+        for (const Vector& p : positions) {
+            minX = std::min(minX, p.x);
+            minY = std::min(minY, p.y);
+            maxX = std::max(maxX, p.x);
+            maxY = std::max(maxY, p.y);
+        }
+        if (positions.empty()) {
+            minX = minY = maxX = maxY = 0;
+        }
+        nx = uint32_t((maxX - minX) / cellSize) + 1;
+        ny = uint32_t((maxY - minY) / cellSize) + 1;
+
+        // Подсчет, префиксная сумма, раскладка по ячейкам
+        cellStart.assign(size_t(nx) * ny + 1, 0);
+        for (const Vector& p : positions) {
+            cellStart[CellOf(p) + 1]++;
+        }
+        for (size_t c = 1; c < cellStart.size(); c++) {
+            cellStart[c] += cellStart[c - 1];
+        }
+        cellGateways.resize(positions.size());
+        std::vector<uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+        for (uint32_t g = 0; g < positions.size(); g++) {
+            cellGateways[fill[CellOf(positions[g])]++] = g;
+        }
+    }
+
+    // Вызывает f(gateway, distance) для каждого шлюза не дальше range
+    template <typename F>
+    void ForEachCandidate(const Vector& pos, F f) const
+    {
+        int64_t cx = int64_t(floor((pos.x - minX) / cellSize));
+        int64_t cy = int64_t(floor((pos.y - minY) / cellSize));
+        for (int64_t y = std::max<int64_t>(cy - 1, 0); y <= std::min<int64_t>(cy + 1, ny - 1); y++) {
+            for (int64_t x = std::max<int64_t>(cx - 1, 0); x <= std::min<int64_t>(cx + 1, nx - 1); x++) {
+                size_t cell = size_t(y) * nx + x;
+                for (uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; k++) {
+                    uint32_t g = cellGateways[k];
+                    double distance = CalculateDistance(pos, positions[g]);
+                    if (distance <= range) {
+                        f(g, distance);
+                    }
+                }
+            }
+        }
+    }
+
+    uint32_t GetNGateways() const { return positions.size(); }
+    double GetRange() const { return range; }
+
+private:
+    size_t CellOf(const Vector& p) const
+    {
+        uint32_t x = std::min(uint32_t((p.x - minX) / cellSize), nx - 1);
+        uint32_t y = std::min(uint32_t((p.y - minY) / cellSize), ny - 1);
+        return size_t(y) * nx + x;
+    }
+
+    std::vector<Vector> positions;
+    double range;
+    double cellSize;
+    double minX;
+    double minY;
+    uint32_t nx;
+    uint32_t ny;
+    std::vector<uint32_t> cellStart;
+    std::vector<uint32_t> cellGateways;
+};
+
+// Расстановка шлюзов квадратной решеткой по квадрату со стороной 2 * radius
+// вокруг начала координат; один шлюз ставится в центр, как в исходных сценариях
+inline std::vector<Vector> GatewayLatticePositions(uint32_t nGateways, double radius, double height)
+{
+    std::vector<Vector> positions;
+    if (nGateways == 1) {
+        positions.push_back(Vector(0.0, 0.0, height));
+        return positions;
+    }
+    uint32_t side = uint32_t(ceil(sqrt(double(nGateways))));
+    double step = 2 * radius / side;
+    for (uint32_t k = 0; k < nGateways; k++) {
+        double x = -radius + step * (k % side + 0.5);
+        double y = -radius + step * (k / side + 0.5);
+        positions.push_back(Vector(x, y, height));
+    }
+    return positions;
+}
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_GATEWAY_GRID_H */
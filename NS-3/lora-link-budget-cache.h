@@ -0,0 +1,439 @@
+#ifndef LORA_LINK_BUDGET_CACHE_H
+#define LORA_LINK_BUDGET_CACHE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/propagation-loss-model.h"
+
+#include "lora-binary-log.h"
+#include "lora-block-fading.h"
+#include "lora-gateway-grid.h"
+#include "lora-profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Кэш детерминированных потерь (LogDistance и т.п.) для пар устройство-шлюз.
+// Потери считаются один раз при Install и хранятся в плоской таблице
+// [устройство][слот]; на пакет остается поиск индексов и вычитание. Номера
+// устройства и шлюза берутся по id узла из плоских массивов; без дальности
+// слот равен номеру шлюза, с дальностью кандидаты строки перебираются.
+// Случайные составляющие (замирания, шум) должны стоять в цепочке после кэша.
+// Без SetMaxRange слоты устройства - все шлюзы. С дальностью кандидаты
+// отбираются сеткой LoraGatewayGrid, остальные шлюзы получают LOST_POWER_DBM
+// без расчета потерь, а число слотов равно наибольшему числу кандидатов;
+// если после сдвига кандидатов стало больше, таблица расширяется, так что
+// шлюзы в пределах дальности не отбрасываются.
+// Если модель мобильности неподвижного устройства сообщает CourseChange,
+// его строка помечается устаревшей и пересчитывается при следующем
+// обращении; сдвиг шлюза помечает устаревшей всю таблицу.
+// Подвижные устройства (модель мобильности не ConstantPosition) проверяются
+// лениво: позиция читается один раз за передачу, строка пересчитывается,
+// только если устройство ушло от точки последнего расчета дальше
+// SetUpdateDistance. До этого используются кэшированные потери.
+// SetShadowing добавляет логнормальное затенение на пару: значение хранится
+// в строке и обновляется по модели Гудмундсона (корреляция exp(-d/dcorr)),
+// когда устройство прошло расстояние декорреляции.
+// Пары, не входящие в таблицу (например, устройство-устройство), считаются
+// исходной моделью без кэширования. Так же считаются линии служебного узла
+// популяции без узлов (SetProxyNode); затенение его пары берется по номеру
+// устройства из SetProxyDevice. Устройства популяции неподвижны, поэтому
+// значение пары постоянно и не хранится, а выводится из хеша номеров
+// устройства и шлюза, как коэффициенты GetDrawGainDb в LoraBlockFading.
+class LoraLinkBudgetCacheLossModel : public PropagationLossModel
+{
+public:
+    // Мощность для шлюза вне дальности (та же, что у LoraNoiseFadingLossModel)
+    static constexpr double LOST_POWER_DBM = -1000.0;
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::LoraLinkBudgetCacheLossModel")
+                                .SetParent<PropagationLossModel>()
+                                .SetGroupName("Lorawan")
+                                .AddConstructor<LoraLinkBudgetCacheLossModel>();
+        return tid;
+    }
+
+    LoraLinkBudgetCacheLossModel()
+        : maxRange(0.0),
+          updateDistance(0.0),
+          shadowingSigma(0.0),
+          decorrelationDistance(0.0),
+          shadowRng(CreateObject<NormalRandomVariable>()),
+          shadowStream(0),
+          proxyNode(NO_INDEX),
+          proxyDevice(0),
+          slots(0),
+          gatewaysDirty(false),
+          nRecomputes(0)
+    {
+    }
+
+    // Детерминированная модель, результаты которой кэшируются
+    void SetLossModel(Ptr<PropagationLossModel> model) { lossModel = model; }
+
+    // Дальность отбора шлюзов, м (0 - все шлюзы); задается до Install
+    void SetMaxRange(double range) { maxRange = range; }
+
+    // Сдвиг подвижного устройства, после которого строка пересчитывается, м
+    // (0 - при любом сдвиге)
+    void SetUpdateDistance(double distance) { updateDistance = distance; }
+
+    // Затенение с СКО sigmaDb и расстоянием декорреляции, м (sigma 0 - выключено)
+    void SetShadowing(double sigmaDb, double decorrelation)
+    {
+        shadowingSigma = sigmaDb;
+        decorrelationDistance = std::max(decorrelation, 1e-3);
+    }
+
+    // Служебный узел популяции без узлов и устройство его текущей передачи
+    void SetProxyNode(uint32_t nodeId) { proxyNode = nodeId; }
+    void SetProxyDevice(uint32_t device) { proxyDevice = device; }
+
+    // Заполняет таблицу потерь; узлы уже должны иметь модели мобильности
+    void Install(NodeContainer endDevices, NodeContainer gateways)
+    {
+        deviceMobility.clear();
+        gatewayMobility.clear();
+        deviceByNode.clear();
+        gatewayByNode.clear();
+        mobile.clear();
+        for (uint32_t i = 0; i < endDevices.GetN(); i++) {
+            Ptr<MobilityModel> mobility = endDevices.Get(i)->GetObject<MobilityModel>();
+            SetIndex(deviceByNode, endDevices.Get(i)->GetId(), i);
+            deviceMobility.push_back(mobility);
+            mobile.push_back(DynamicCast<ConstantPositionMobilityModel>(mobility) ? 0 : 1);
+            mobility->TraceConnectWithoutContext(
+                "CourseChange", MakeCallback(&LoraLinkBudgetCacheLossModel::CourseChanged, this));
+        }
+        for (uint32_t g = 0; g < gateways.GetN(); g++) {
+            Ptr<MobilityModel> mobility = gateways.Get(g)->GetObject<MobilityModel>();
+            SetIndex(gatewayByNode, gateways.Get(g)->GetId(), g);
+            gatewayMobility.push_back(mobility);
+            mobility->TraceConnectWithoutContext(
+                "CourseChange", MakeCallback(&LoraLinkBudgetCacheLossModel::CourseChanged, this));
+        }
+
+        RebuildGrid();
+        slots = gatewayMobility.size();
+        if (maxRange > 0) {
+            slots = 1;
+            for (uint32_t i = 0; i < deviceMobility.size(); i++) {
+                uint32_t n = 0;
+                grid.ForEachCandidate(deviceMobility[i]->GetPosition(), [&n](uint32_t, double) { n++; });
+                slots = std::max(slots, n);
+            }
+        }
+        table.assign(deviceMobility.size() * slots, Candidate());
+        count.assign(deviceMobility.size(), 0);
+        deviceDirty.assign(deviceMobility.size(), 0);
+        anchor.assign(deviceMobility.size(), Vector());
+        shadowAnchor.assign(deviceMobility.size(), Vector());
+        checkedNs.assign(deviceMobility.size(), -1);
+        for (uint32_t i = 0; i < deviceMobility.size(); i++) {
+            RecomputeDevice(i, true);
+        }
+        nRecomputes = 0;
+    }
+
+    // Текущие потери пары, dB; HUGE_VAL, если шлюз вне дальности
+    double GetLossDb(uint32_t device, uint32_t gateway) const
+    {
+        Refresh(device);
+        const Candidate* c = Find(device, gateway);
+        return c != nullptr ? c->lossDb : HUGE_VAL;
+    }
+
+    // Вызывает f(gateway) для каждого шлюза строки устройства: с дальностью -
+    // кандидаты в ее пределах, без нее - все шлюзы
+    template <typename F>
+    void ForEachCandidate(uint32_t device, F f) const
+    {
+        Refresh(device);
+        const Candidate* row = &table[size_t(device) * slots];
+        for (uint32_t k = 0; k < count[device]; k++) {
+            f(row[k].gateway);
+        }
+    }
+
+    // Слотов в строке устройства: наибольшее число кандидатов одного устройства
+    uint32_t GetSlots() const { return slots; }
+
+    // Среднее число шлюзов-кандидатов на устройство
+    double GetMeanCandidates() const
+    {
+        double total = 0;
+        for (uint32_t n : count) {
+            total += n;
+        }
+        return count.empty() ? 0.0 : total / count.size();
+    }
+
+    // Число подвижных устройств
+    uint32_t GetNMobile() const { return std::count(mobile.begin(), mobile.end(), 1); }
+
+    // Пересчеты строк после Install (сдвиги устройств и шлюзов)
+    uint64_t GetRecomputes() const { return nRecomputes; }
+
+private:
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+    struct Candidate
+    {
+        uint32_t gateway = 0;
+        float shadowDb = 0.0f;  // Составляющая затенения, уже входит в lossDb
+        double lossDb = 0.0;
+    };
+
+    double DoCalcRxPower(double txPowerDbm,
+                         Ptr<MobilityModel> a,
+                         Ptr<MobilityModel> b) const override
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_LINK_CACHE);
+        uint32_t idA = NodeId(a);
+        uint32_t idB = NodeId(b);
+        // Потери симметричны: uplink и downlink берутся из одной ячейки
+        uint32_t device = IndexOf(deviceByNode, idA);
+        uint32_t gateway = IndexOf(gatewayByNode, idB);
+        if (device == NO_INDEX || gateway == NO_INDEX) {
+            device = IndexOf(deviceByNode, idB);
+            gateway = IndexOf(gatewayByNode, idA);
+        }
+        if (device != NO_INDEX && gateway != NO_INDEX) {
+            Refresh(device);
+            const Candidate* c = Find(device, gateway);
+            return c != nullptr ? txPowerDbm - c->lossDb : LOST_POWER_DBM;
+        }
+        double rxPowerDbm = lossModel->CalcRxPower(txPowerDbm, a, b);
+        gateway = IndexOf(gatewayByNode, idB);
+        if (shadowingSigma > 0 && idA == proxyNode && gateway != NO_INDEX) {
+            rxPowerDbm -= ProxyShadowDb(proxyDevice, gateway);
+        }
+        return rxPowerDbm;
+    }
+
+    int64_t DoAssignStreams(int64_t stream) override
+    {
+        int64_t n = lossModel->AssignStreams(stream);
+        shadowRng->SetStream(stream + n);
+        shadowStream = stream + n;
+        return n + 1;
+    }
+
+    // Затенение пары устройство популяции - шлюз, N(0, sigma) по Боксу-Мюллеру
+    // из двух равномерных величин хеша seed/run/потока и номеров пары
+    double ProxyShadowDb(uint32_t device, uint32_t gateway) const
+    {
+        uint64_t seed = LoraBlockFading::Mix(RngSeedManager::GetSeed()) ^
+                        LoraBlockFading::Mix(RngSeedManager::GetRun() + 0x632BE59BD9B4E019ULL) ^
+                        LoraBlockFading::Mix(uint64_t(shadowStream) + 1);
+        uint64_t key = LoraBlockFading::LinkKey(device, gateway, true);
+        uint64_t first = LoraBlockFading::Mix(seed ^ LoraBlockFading::Mix(key));
+        uint64_t second = LoraBlockFading::Mix(first + 0x9E3779B97F4A7C15ULL);
+        double u1 = (double(first >> 11) + 0.5) * 0x1.0p-53;
+        double u2 = double(second >> 11) * 0x1.0p-53;
+        return shadowingSigma * std::sqrt(-2 * std::log(u1)) * std::cos(2 * M_PI * u2);
+    }
+
+    static uint32_t NodeId(const Ptr<const MobilityModel>& mobility)
+    {
+        Ptr<Node> node = mobility->GetObject<Node>();
+        return node ? node->GetId() : NO_INDEX;
+    }
+
+    static void SetIndex(std::vector<uint32_t>& byNode, uint32_t nodeId, uint32_t index)
+    {
+        if (nodeId >= byNode.size()) {
+            byNode.resize(nodeId + 1, NO_INDEX);
+        }
+        byNode[nodeId] = index;
+    }
+
+    static uint32_t IndexOf(const std::vector<uint32_t>& byNode, uint32_t nodeId)
+    {
+        return nodeId < byNode.size() ? byNode[nodeId] : NO_INDEX;
+    }
+
+    void CourseChanged(Ptr<const MobilityModel> mobility)
+    {
+        uint32_t id = NodeId(mobility);
+        uint32_t device = IndexOf(deviceByNode, id);
+        if (device != NO_INDEX) {
+            // Подвижные устройства сообщают каждый поворот; их сдвиг
+            // проверяется при обращении
+            if (!mobile[device]) {
+                deviceDirty[device] = 1;
+            }
+        } else if (IndexOf(gatewayByNode, id) != NO_INDEX) {
+            // Сдвиг шлюза затрагивает все устройства
+            gatewaysDirty = true;
+            std::fill(deviceDirty.begin(), deviceDirty.end(), 1);
+        }
+    }
+
+    const Candidate* Find(uint32_t device, uint32_t gateway) const
+    {
+        const Candidate* row = &table[size_t(device) * slots];
+        if (maxRange <= 0) {
+            // Строка без отбора заполнена всеми шлюзами по порядку
+            return gateway < count[device] ? &row[gateway] : nullptr;
+        }
+        for (uint32_t k = 0; k < count[device]; k++) {
+            if (row[k].gateway == gateway) {
+                return &row[k];
+            }
+        }
+        return nullptr;
+    }
+
+    void Refresh(uint32_t device) const
+    {
+        if (mobile[device] && !deviceDirty[device]) {
+            CheckMoved(device);
+        }
+        if (deviceDirty[device]) {
+            if (gatewaysDirty) {
+                RebuildGrid();
+            }
+            LORA_BLOG(LORA_LOG_LINK_RECOMPUTE, device,
+                      CalculateDistance(deviceMobility[device]->GetPosition(), anchor[device]));
+            RecomputeDevice(device, false);
+            nRecomputes++;
+        }
+    }
+
+    // Позиция подвижного устройства читается один раз за момент времени:
+    // остальные шлюзы той же передачи берут результат проверки
+    void CheckMoved(uint32_t device) const
+    {
+        int64_t now = Simulator::Now().GetNanoSeconds();
+        if (checkedNs[device] == now) {
+            return;
+        }
+        checkedNs[device] = now;
+        Vector position = deviceMobility[device]->GetPosition();
+        if (CalculateDistance(position, anchor[device]) > updateDistance ||
+            (shadowingSigma > 0 && CalculateDistance(position, shadowAnchor[device]) >= decorrelationDistance)) {
+            deviceDirty[device] = 1;
+        }
+    }
+
+    void RebuildGrid() const
+    {
+        if (maxRange > 0) {
+            std::vector<Vector> positions;
+            for (const Ptr<MobilityModel>& mobility : gatewayMobility) {
+                positions.push_back(mobility->GetPosition());
+            }
+            grid.Build(positions, maxRange);
+        }
+        gatewaysDirty = false;
+    }
+
+    void RecomputeDevice(uint32_t device, bool first) const
+    {
+        Vector position = deviceMobility[device]->GetPosition();
+        std::vector<Candidate>& found = scratch;
+        found.clear();
+        if (maxRange > 0) {
+            grid.ForEachCandidate(position, [&](uint32_t g, double) {
+                found.push_back({g, 0.0f, -lossModel->CalcRxPower(0.0, deviceMobility[device], gatewayMobility[g])});
+            });
+            AddShadowing(device, position, first, found);
+            // После перемещения кандидатов может стать больше слотов
+            if (found.size() > slots) {
+                GrowSlots(found.size());
+            }
+        } else {
+            for (uint32_t g = 0; g < gatewayMobility.size(); g++) {
+                found.push_back({g, 0.0f, -lossModel->CalcRxPower(0.0, deviceMobility[device], gatewayMobility[g])});
+            }
+            AddShadowing(device, position, first, found);
+        }
+        std::copy(found.begin(), found.end(), &table[size_t(device) * slots]);
+        count[device] = found.size();
+        deviceDirty[device] = 0;
+        anchor[device] = position;
+    }
+
+    // Переносит строки в таблицу с большим числом слотов
+    void GrowSlots(uint32_t newSlots) const
+    {
+        std::vector<Candidate> grown(deviceMobility.size() * size_t(newSlots), Candidate());
+        for (uint32_t i = 0; i < deviceMobility.size(); i++) {
+            std::copy_n(&table[size_t(i) * slots], count[i], &grown[size_t(i) * newSlots]);
+        }
+        table.swap(grown);
+        slots = newSlots;
+    }
+
+    // Затенение пар строки: шлюз, уже бывший в строке, сохраняет значение,
+    // пока устройство не пройдет расстояние декорреляции, затем
+    // s' = rho * s + sqrt(1 - rho^2) * N(0, sigma); новый шлюз - N(0, sigma)
+    void AddShadowing(uint32_t device, const Vector& position, bool first, std::vector<Candidate>& found) const
+    {
+        if (shadowingSigma <= 0) {
+            return;
+        }
+        double moved = first ? 0.0 : CalculateDistance(position, shadowAnchor[device]);
+        bool decorrelated = first || moved >= decorrelationDistance;
+        double rho = std::exp(-moved / decorrelationDistance);
+        for (Candidate& c : found) {
+            // Генератор тянется только за новым значением: сохраненное
+            // затенение не сдвигает поток остальных пар
+            const Candidate* previous = first ? nullptr : Find(device, c.gateway);
+            double shadow;
+            if (previous == nullptr) {
+                shadow = shadowingSigma * shadowRng->GetValue();
+            } else if (decorrelated) {
+                shadow = rho * previous->shadowDb + std::sqrt(1 - rho * rho) * shadowingSigma * shadowRng->GetValue();
+            } else {
+                shadow = previous->shadowDb;
+            }
+            c.shadowDb = shadow;
+            c.lossDb += shadow;
+        }
+        if (decorrelated) {
+            shadowAnchor[device] = position;
+        }
+    }
+
+    Ptr<PropagationLossModel> lossModel;
+    double maxRange;
+    double updateDistance;
+    double shadowingSigma;
+    double decorrelationDistance;
+    Ptr<NormalRandomVariable> shadowRng;
+    int64_t shadowStream;                        // Поток затенения из AssignStreams (0 - не назначен)
+    uint32_t proxyNode;
+    uint32_t proxyDevice;
+    std::vector<uint32_t> deviceByNode;          // id узла -> номер устройства
+    std::vector<uint32_t> gatewayByNode;         // id узла -> номер шлюза
+    std::vector<Ptr<MobilityModel>> deviceMobility;
+    std::vector<Ptr<MobilityModel>> gatewayMobility;
+    mutable LoraGatewayGrid grid;
+    mutable uint32_t slots;
+    mutable std::vector<Candidate> table;        // [устройство][слот]
+    mutable std::vector<uint32_t> count;         // Занятые слоты устройства
+    mutable std::vector<Candidate> scratch;      // Кандидаты пересчитываемой строки, без выделений
+    mutable std::vector<uint8_t> deviceDirty;
+    std::vector<uint8_t> mobile;                 // Модель мобильности не ConstantPosition
+    mutable std::vector<Vector> anchor;          // Позиция последнего пересчета строки
+    mutable std::vector<Vector> shadowAnchor;    // Позиция последнего обновления затенения
+    mutable std::vector<int64_t> checkedNs;      // Момент последней проверки сдвига
+    mutable bool gatewaysDirty;
+    mutable uint64_t nRecomputes;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LoraLinkBudgetCacheLossModel);
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_LINK_BUDGET_CACHE_H */
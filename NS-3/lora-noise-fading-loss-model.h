@@ -0,0 +1,463 @@
+#ifndef LORA_NOISE_FADING_LOSS_MODEL_H
+#define LORA_NOISE_FADING_LOSS_MODEL_H
+
+#include "ns3/core-module.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/mobility-model.h"
+#include "ns3/node.h"
+#include "ns3/lorawan-module.h"
+
+#include "lora-binary-log.h"
+#include "lora-block-fading.h"
+#include "lora-per-table.h"
+#include "lora-profiler.h"
+
+#include <cmath>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Модель шума и замираний Рэлея в цепочке CompositePropagationLossModel.
+// Объединяет AWGNModel, ThermalNoiseModel и RayleighFadingModel из сценариев:
+// каждый принятый пакет проходит через замирания и порог SNR.
+// Уровень шума пересчитывается только при изменении атрибутов, поэтому
+// на пакет приходится одно сравнение в dB без pow/log10. Замирания берутся
+// из LoraBlockFading: по подпотоку на линию, с интервалом когерентности.
+// С таблицей PER (SetPerTable) линия выше порога дополнительно теряется с
+// вероятностью PER(SNR, SF передатчика, CR, длина) из таблицы.
+class LoraNoiseFadingLossModel : public PropagationLossModel
+{
+public:
+    // Мощность, которую возвращает модель для потерянного пакета
+    static constexpr double LOST_POWER_DBM = -1000.0;
+
+    // Сигнатура трассы RxPower: узел-передатчик, узел-приемник, мощность, dBm
+    typedef void (*RxPowerTracedCallback)(uint32_t txNodeId, uint32_t rxNodeId, double rxPowerDbm);
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::LoraNoiseFadingLossModel")
+                .SetParent<PropagationLossModel>()
+                .SetGroupName("Lorawan")
+                .AddConstructor<LoraNoiseFadingLossModel>()
+                .AddAttribute("EnableNoise",
+                              "Отбрасывать пакеты с SNR ниже порога",
+                              BooleanValue(true),
+                              MakeBooleanAccessor(&LoraNoiseFadingLossModel::SetNoiseEnabled,
+                                                  &LoraNoiseFadingLossModel::IsNoiseEnabled),
+                              MakeBooleanChecker())
+                .AddAttribute("ThermalNoise",
+                              "Шум считается как kTB + NF, иначе берется NoisePower",
+                              BooleanValue(false),
+                              MakeBooleanAccessor(&LoraNoiseFadingLossModel::SetThermalNoise,
+                                                  &LoraNoiseFadingLossModel::IsThermalNoise),
+                              MakeBooleanChecker())
+                .AddAttribute("NoisePower",
+                              "Мощность АБГШ, dBm",
+                              DoubleValue(-100.0),
+                              MakeDoubleAccessor(&LoraNoiseFadingLossModel::SetNoisePower,
+                                                 &LoraNoiseFadingLossModel::GetNoisePower),
+                              MakeDoubleChecker<double>())
+                .AddAttribute("Temperature",
+                              "Температура приемника, °C",
+                              DoubleValue(25.0),
+                              MakeDoubleAccessor(&LoraNoiseFadingLossModel::SetTemperatureCelsius,
+                                                 &LoraNoiseFadingLossModel::GetTemperatureCelsius),
+                              MakeDoubleChecker<double>(-273.15))
+                .AddAttribute("Bandwidth",
+                              "Полоса пропускания, Hz",
+                              DoubleValue(125000.0),
+                              MakeDoubleAccessor(&LoraNoiseFadingLossModel::SetBandwidth,
+                                                 &LoraNoiseFadingLossModel::GetBandwidth),
+                              MakeDoubleChecker<double>(0.0))
+                .AddAttribute("NoiseFigure",
+                              "Шумовая фигура приемника, dB",
+                              DoubleValue(3.0),
+                              MakeDoubleAccessor(&LoraNoiseFadingLossModel::SetNoiseFigure,
+                                                 &LoraNoiseFadingLossModel::GetNoiseFigure),
+                              MakeDoubleChecker<double>())
+                .AddAttribute("SnrThreshold",
+                              "Минимальный SNR для приема пакета, dB",
+                              DoubleValue(0.0),
+                              MakeDoubleAccessor(&LoraNoiseFadingLossModel::SetSnrThreshold,
+                                                 &LoraNoiseFadingLossModel::GetSnrThreshold),
+                              MakeDoubleChecker<double>())
+                .AddAttribute("EnableFading",
+                              "Включить замирания Рэлея",
+                              BooleanValue(false),
+                              MakeBooleanAccessor(&LoraNoiseFadingLossModel::enableFading),
+                              MakeBooleanChecker())
+                .AddAttribute("Sigma",
+                              "Параметр sigma распределения Рэлея",
+                              DoubleValue(1.0),
+                              MakeDoubleAccessor(&LoraNoiseFadingLossModel::SetSigma,
+                                                 &LoraNoiseFadingLossModel::GetSigma),
+                              MakeDoubleChecker<double>(0.0))
+                .AddAttribute("CoherenceTime",
+                              "Интервал когерентности замираний, 0 - новый коэффициент на каждый пакет",
+                              TimeValue(Seconds(0)),
+                              MakeTimeAccessor(&LoraNoiseFadingLossModel::SetCoherenceTime,
+                                               &LoraNoiseFadingLossModel::GetCoherenceTime),
+                              MakeTimeChecker())
+                .AddTraceSource("RxPower",
+                                "Мощность приема по линии после замираний (для пакетов выше порога)",
+                                MakeTraceSourceAccessor(&LoraNoiseFadingLossModel::rxPowerTrace),
+                                "ns3::LoraNoiseFadingLossModel::RxPowerTracedCallback")
+                .AddTraceSource("LostRxPower",
+                                "Мощность приема по линии, отброшенной по порогу SNR или по PER",
+                                MakeTraceSourceAccessor(&LoraNoiseFadingLossModel::lostRxPowerTrace),
+                                "ns3::LoraNoiseFadingLossModel::RxPowerTracedCallback");
+        return tid;
+    }
+
+    LoraNoiseFadingLossModel()
+        : enableNoise(true),
+          thermalNoise(false),
+          noisePowerDbm(-100.0),
+          temperatureC(25.0),
+          bandwidth(125000.0),
+          noiseFigure(3.0),
+          snrThresholdDb(0.0),
+          enableFading(false),
+          sigma(1.0),
+          perTable(nullptr),
+          perPayloadBytes(0),
+          perCodingRate(1),
+          perRng(CreateObject<UniformRandomVariable>()),
+          proxyNode(NO_INDEX),
+          proxyDevice(0),
+          proxyDraw(0),
+          proxySf(12)
+    {
+        SetSigma(sigma);
+        UpdateNoiseFloor();
+    }
+
+    void SetNoiseEnabled(bool enable) { enableNoise = enable; UpdateNoiseFloor(); }
+    bool IsNoiseEnabled() const { return enableNoise; }
+
+    void SetThermalNoise(bool thermal) { thermalNoise = thermal; UpdateNoiseFloor(); }
+    bool IsThermalNoise() const { return thermalNoise; }
+
+    void SetNoisePower(double powerDbm) { noisePowerDbm = powerDbm; UpdateNoiseFloor(); }
+    double GetNoisePower() const { return noisePowerDbm; }
+
+    void SetTemperatureCelsius(double temp) { temperatureC = temp; UpdateNoiseFloor(); }
+    double GetTemperatureCelsius() const { return temperatureC; }
+
+    void SetBandwidth(double bw) { bandwidth = bw; UpdateNoiseFloor(); }
+    double GetBandwidth() const { return bandwidth; }
+
+    void SetNoiseFigure(double nf) { noiseFigure = nf; UpdateNoiseFloor(); }
+    double GetNoiseFigure() const { return noiseFigure; }
+
+    void SetSnrThreshold(double thresholdDb) { snrThresholdDb = thresholdDb; UpdateNoiseFloor(); }
+    double GetSnrThreshold() const { return snrThresholdDb; }
+
+    // Генераторы компонентов поверх модели (прием по SINR): получают потоки
+    // в AssignStreams вслед за потоками самой модели
+    void AddRandomStream(Ptr<RandomVariableStream> rng) { extraRngs.push_back(rng); }
+
+    void SetFadingEnabled(bool enable) { enableFading = enable; }
+    bool IsFadingEnabled() const { return enableFading; }
+
+    void SetSigma(double s)
+    {
+        sigma = s;
+        // X, Y ~ N(0, sigma^2)  =>  X^2 + Y^2 ~ Exp(2 sigma^2)
+        fading.SetMeanPowerGain(2.0 * sigma * sigma);
+    }
+    double GetSigma() const { return sigma; }
+
+    void SetCoherenceTime(Time t)
+    {
+        coherenceTime = t;
+        fading.SetCoherenceTime(t);
+    }
+    Time GetCoherenceTime() const { return coherenceTime; }
+
+    // Решение о приеме по таблице PER вместо одного порога SNR. Модель потерь
+    // не видит пакет, поэтому длина задается заранее (PHY-нагрузка, байт), а SF
+    // читается из MAC передатчика (у служебного узла популяции - из
+    // SetProxyTransmission). Вызывать после установки стека LoRaWAN.
+    // Порог SNR остается грубым отсевом: ниже него таблица не читается.
+    void SetPerTable(const LoraPerTable* table, NodeContainer endDevices, uint32_t payloadBytes, uint8_t cr = 1)
+    {
+        perTable = table;
+        perPayloadBytes = payloadBytes;
+        perCodingRate = cr;
+        for (uint32_t i = 0; i < endDevices.GetN(); i++) {
+            Ptr<Node> node = endDevices.Get(i);
+            if (node->GetId() >= perMacByNode.size()) {
+                perMacByNode.resize(node->GetId() + 1);
+            }
+            Ptr<LoraNetDevice> loraNetDev = node->GetDevice(0)->GetObject<LoraNetDevice>();
+            perMacByNode[node->GetId()] = loraNetDev->GetMac()->GetObject<ClassAEndDeviceLorawanMac>();
+        }
+    }
+
+    // Номера линий замираний: устройство i контейнера - номер deviceIndex[i]
+    // в сети (пусто - i), шлюз g - номер g. Подпоток линии не зависит от id
+    // узлов, которые сдвигаются с числом устройств и различаются по ячейкам.
+    // Линии узлов вне контейнеров берут подпоток по id узлов
+    void SetLinkIndices(NodeContainer endDevices, NodeContainer gateways, const std::vector<uint32_t>& deviceIndex)
+    {
+        for (uint32_t i = 0; i < endDevices.GetN(); i++) {
+            SetIndex(deviceByNode, endDevices.Get(i)->GetId(), deviceIndex.empty() ? i : deviceIndex[i]);
+        }
+        for (uint32_t g = 0; g < gateways.GetN(); g++) {
+            SetIndex(gatewayByNode, gateways.Get(g)->GetId(), g);
+        }
+        fading.Reserve(2 * uint64_t(endDevices.GetN()));
+    }
+
+    // Емкость таблицы замираний на nLinks линий устройство-шлюз (вверх и
+    // вниз отдельно); SetLinkIndices резервирует по одному шлюзу на устройство
+    void ReserveFadingLinks(uint64_t nLinks) { fading.Reserve(nLinks); }
+
+    // Служебный узел популяции без узлов (LoraDevicePopulation): его линии
+    // берут номер устройства и передачи для замираний и SF для таблицы PER
+    // из SetProxyTransmission, которую популяция вызывает перед расчетом
+    // потерь каждой передачи
+    void SetProxyNode(uint32_t nodeId) { proxyNode = nodeId; }
+    void SetProxyTransmission(uint32_t device, uint64_t draw, uint8_t sf)
+    {
+        proxyDevice = device;
+        proxyDraw = draw;
+        proxySf = sf;
+    }
+
+    // Уровень шума, закэшированный при последнем изменении атрибутов
+    double GetNoiseFloorDbm() const { return noiseFloorDbm; }
+    double GetNoiseFloorLinear() const { return noiseFloorMw; }
+
+private:
+    void UpdateNoiseFloor()
+    {
+        if (thermalNoise) {
+            // Формула теплового шума: P = k * T * B, плюс шумовая фигура
+            double temperatureK = temperatureC + 273.15;
+            double noisePowerW = 1.38e-23 * temperatureK * bandwidth;
+            noiseFloorDbm = 10 * log10(noisePowerW) + 30 + noiseFigure;
+        } else {
+            noiseFloorDbm = noisePowerDbm;
+        }
+        noiseFloorMw = pow(10.0, noiseFloorDbm / 10.0);
+
+        // SNR > порог  <=>  Prx > шум + порог, сравнение без перевода в линейные единицы
+        minRxPowerDbm = enableNoise ? noiseFloorDbm + snrThresholdDb : -HUGE_VAL;
+    }
+
+    double DoCalcRxPower(double txPowerDbm,
+                         Ptr<MobilityModel> a,
+                         Ptr<MobilityModel> b) const override
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_NOISE_FADING);
+        // Шлюз уже отброшен предыдущей моделью (вне дальности): замирания не тянем
+        if (txPowerDbm <= LOST_POWER_DBM) {
+            return LOST_POWER_DBM;
+        }
+        double gainDb = 0.0;
+        if (enableFading) {
+            gainDb = FadingGainDb(a->GetObject<Node>()->GetId(), b->GetObject<Node>()->GetId());
+        }
+        double rxPowerDbm = txPowerDbm + gainDb;
+        if (rxPowerDbm <= minRxPowerDbm) {
+            LORA_BLOG(LORA_LOG_NOISE_LOST_FLOOR, rxPowerDbm, rxPowerDbm - noiseFloorDbm);
+            TraceLost(a, b, rxPowerDbm);
+            return LOST_POWER_DBM;
+        }
+        if (perTable != nullptr && LostByPer(a->GetObject<Node>()->GetId(), rxPowerDbm)) {
+            TraceLost(a, b, rxPowerDbm);
+            return LOST_POWER_DBM;
+        }
+        LORA_BLOG(LORA_LOG_NOISE_RX_POWER, txPowerDbm, gainDb, rxPowerDbm, rxPowerDbm - noiseFloorDbm);
+        if (!rxPowerTrace.IsEmpty()) {
+            rxPowerTrace(a->GetObject<Node>()->GetId(), b->GetObject<Node>()->GetId(), rxPowerDbm);
+        }
+        return rxPowerDbm;
+    }
+
+    void TraceLost(const Ptr<MobilityModel>& a, const Ptr<MobilityModel>& b, double rxPowerDbm) const
+    {
+        if (!lostRxPowerTrace.IsEmpty()) {
+            lostRxPowerTrace(a->GetObject<Node>()->GetId(), b->GetObject<Node>()->GetId(), rxPowerDbm);
+        }
+    }
+
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+    static void SetIndex(std::vector<uint32_t>& byNode, uint32_t nodeId, uint32_t index)
+    {
+        if (nodeId >= byNode.size()) {
+            byNode.resize(nodeId + 1, NO_INDEX);
+        }
+        byNode[nodeId] = index;
+    }
+
+    static uint32_t IndexOf(const std::vector<uint32_t>& byNode, uint32_t nodeId)
+    {
+        return nodeId < byNode.size() ? byNode[nodeId] : NO_INDEX;
+    }
+
+    // Замирания линии по номерам устройства и шлюза в сети
+    double FadingGainDb(uint32_t txId, uint32_t rxId) const
+    {
+        uint32_t rxGateway = IndexOf(gatewayByNode, rxId);
+        if (txId == proxyNode && rxGateway != NO_INDEX) {
+            return fading.GetDrawGainDb(LoraBlockFading::LinkKey(proxyDevice, rxGateway, true), proxyDraw);
+        }
+        uint32_t txDevice = IndexOf(deviceByNode, txId);
+        if (txDevice != NO_INDEX && rxGateway != NO_INDEX) {
+            return fading.GetGainDb(LoraBlockFading::LinkKey(txDevice, rxGateway, true), Simulator::Now());
+        }
+        uint32_t txGateway = IndexOf(gatewayByNode, txId);
+        uint32_t rxDevice = IndexOf(deviceByNode, rxId);
+        if (txGateway != NO_INDEX && rxDevice != NO_INDEX) {
+            return fading.GetGainDb(LoraBlockFading::LinkKey(rxDevice, txGateway, false), Simulator::Now());
+        }
+        return fading.GetGainDb(LoraBlockFading::NodeLinkKey(txId, rxId), Simulator::Now());
+    }
+
+    // Нисходящие передачи шлюзов в таблице не участвуют: только порог SNR
+    bool LostByPer(uint32_t txNodeId, double rxPowerDbm) const
+    {
+        uint8_t sf = proxySf;
+        if (txNodeId != proxyNode) {
+            if (txNodeId >= perMacByNode.size() || !perMacByNode[txNodeId]) {
+                return false;
+            }
+            const Ptr<ClassAEndDeviceLorawanMac>& mac = perMacByNode[txNodeId];
+            sf = mac->GetSfFromDataRate(mac->GetDataRate());
+        }
+        double per = perTable->Lookup(sf, perCodingRate, perPayloadBytes, rxPowerDbm - noiseFloorDbm);
+        if (per > 0 && perRng->GetValue() < per) {
+            LORA_BLOG(LORA_LOG_NOISE_LOST_PER, sf, rxPowerDbm - noiseFloorDbm);
+            return true;
+        }
+        return false;
+    }
+
+    int64_t DoAssignStreams(int64_t stream) override
+    {
+        fading.SetStream(RngSeedManager::GetSeed(), RngSeedManager::GetRun(), stream);
+        perRng->SetStream(stream + 1);
+        for (size_t k = 0; k < extraRngs.size(); k++) {
+            extraRngs[k]->SetStream(stream + 2 + k);
+        }
+        return 2 + extraRngs.size();
+    }
+
+    bool enableNoise;
+    bool thermalNoise;
+    double noisePowerDbm;
+    double temperatureC;
+    double bandwidth;
+    double noiseFigure;
+    double snrThresholdDb;
+    bool enableFading;
+    double sigma;
+    Time coherenceTime;
+
+    double noiseFloorDbm;
+    double noiseFloorMw;
+    double minRxPowerDbm;
+
+    const LoraPerTable* perTable;
+    uint32_t perPayloadBytes;
+    uint8_t perCodingRate;
+    std::vector<Ptr<ClassAEndDeviceLorawanMac>> perMacByNode;
+    Ptr<UniformRandomVariable> perRng;
+    std::vector<Ptr<RandomVariableStream>> extraRngs;
+
+    std::vector<uint32_t> deviceByNode;     // id узла -> номер устройства в сети
+    std::vector<uint32_t> gatewayByNode;    // id узла -> номер шлюза
+    uint32_t proxyNode;
+    uint32_t proxyDevice;
+    uint64_t proxyDraw;
+    uint8_t proxySf;
+
+    mutable LoraBlockFading fading;
+    mutable TracedCallback<uint32_t, uint32_t, double> rxPowerTrace;
+    mutable TracedCallback<uint32_t, uint32_t, double> lostRxPowerTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LoraNoiseFadingLossModel);
+
+// Помощник для настройки модели и добавления ее в цепочку потерь канала
+class LoraNoiseFadingHelper
+{
+public:
+    LoraNoiseFadingHelper()
+    {
+        factory.SetTypeId("ns3::LoraNoiseFadingLossModel");
+    }
+
+    // АБГШ фиксированной мощности, пакет принимается при SNR > thresholdDb
+    void SetAwgn(double noisePowerDbm, double thresholdDb = 0.0)
+    {
+        factory.Set("EnableNoise", BooleanValue(true));
+        factory.Set("ThermalNoise", BooleanValue(false));
+        factory.Set("NoisePower", DoubleValue(noisePowerDbm));
+        factory.Set("SnrThreshold", DoubleValue(thresholdDb));
+    }
+
+    // Тепловой шум kTB + NF
+    void SetThermalNoise(double temperatureC, double noiseFigureDb, double thresholdDb = 3.0)
+    {
+        factory.Set("EnableNoise", BooleanValue(true));
+        factory.Set("ThermalNoise", BooleanValue(true));
+        factory.Set("Temperature", DoubleValue(temperatureC));
+        factory.Set("NoiseFigure", DoubleValue(noiseFigureDb));
+        factory.Set("SnrThreshold", DoubleValue(thresholdDb));
+    }
+
+    void DisableNoise() { factory.Set("EnableNoise", BooleanValue(false)); }
+
+    void SetBandwidth(double bw) { factory.Set("Bandwidth", DoubleValue(bw)); }
+
+    // Блочные замирания: коэффициент линии постоянен в течение coherenceTime
+    void SetRayleighFading(double sigma, Time coherenceTime = Seconds(0))
+    {
+        factory.Set("EnableFading", BooleanValue(true));
+        factory.Set("Sigma", DoubleValue(sigma));
+        factory.Set("CoherenceTime", TimeValue(coherenceTime));
+    }
+
+    // Номера линий замираний (см. LoraNoiseFadingLossModel::SetLinkIndices):
+    // deviceIndex - номер каждого устройства контейнера в сети, пусто - по порядку
+    void SetLinks(NodeContainer endDevices, NodeContainer gateways, std::vector<uint32_t> deviceIndex = {})
+    {
+        linkDevices = endDevices;
+        linkGateways = gateways;
+        linkDeviceIndex = std::move(deviceIndex);
+    }
+
+    Ptr<LoraNoiseFadingLossModel> Create() const
+    {
+        Ptr<LoraNoiseFadingLossModel> model = factory.Create<LoraNoiseFadingLossModel>();
+        model->SetLinkIndices(linkDevices, linkGateways, linkDeviceIndex);
+        return model;
+    }
+
+    // Модель добавляется последней: шум и порог применяются к мощности после всех потерь
+    Ptr<LoraNoiseFadingLossModel> Install(Ptr<CompositePropagationLossModel> compositeLoss) const
+    {
+        Ptr<LoraNoiseFadingLossModel> model = Create();
+        compositeLoss->AddLossModel(model);
+        return model;
+    }
+
+private:
+    ObjectFactory factory;
+    NodeContainer linkDevices;
+    NodeContainer linkGateways;
+    std::vector<uint32_t> linkDeviceIndex;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_NOISE_FADING_LOSS_MODEL_H */
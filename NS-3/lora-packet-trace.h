@@ -0,0 +1,331 @@
+#ifndef LORA_PACKET_TRACE_H
+#define LORA_PACKET_TRACE_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lorawan-module.h"
+
+#include "lora-noise-fading-loss-model.h"
+#include "lora-uplink-tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Тип записи трассы
+enum LoraTraceEvent : uint8_t {
+    TRACE_SENT = 0,              // Устройство начало передачу нового кадра (FCnt)
+    TRACE_DELIVERED = 1,         // Первый прием пакета любым шлюзом
+    TRACE_RECEIVED = 2,          // Повторный прием тем же пакетом другим шлюзом
+    TRACE_INTERFERENCE = 3,      // Потерян на шлюзе из-за интерференции
+    TRACE_UNDER_SENSITIVITY = 4, // Потерян на шлюзе: мощность ниже чувствительности
+    TRACE_NO_MORE_RECEIVERS = 5, // Потерян на шлюзе: заняты все пути приема
+    TRACE_RETRANSMITTED = 6      // Повторная передача уже отправленного кадра
+};
+
+// Запись фиксированной длины (32 байта), по одной на событие пакета.
+// Для TRACE_SENT и TRACE_RETRANSMITTED powerDbm - мощность передачи, для TRACE_DELIVERED и
+// TRACE_RECEIVED - RSSI на шлюзе. У потерь RSSI берется из трасс RxPower и
+// LostRxPower модели шума; NaN - модель не задана или шлюз вне дальности.
+struct LoraTraceRecord
+{
+    int64_t timeNs;     // Время события, нс
+    uint64_t uid;       // uid пакета ns-3
+    uint32_t device;    // Индекс устройства в endDevices
+    uint16_t gateway;   // Индекс шлюза (NO_GATEWAY для передач)
+    uint8_t event;      // LoraTraceEvent
+    uint8_t sf;         // Коэффициент расширения спектра
+    float powerDbm;
+    float snrDb;        // NaN, если шум отключен или мощность неизвестна
+};
+
+static_assert(sizeof(LoraTraceRecord) == 32, "LoraTraceRecord должна занимать 32 байта");
+
+// Заголовок файла трассы
+struct LoraTraceFileHeader
+{
+    char magic[8];          // "LORATRC1"
+    uint32_t recordSize;    // sizeof(LoraTraceRecord)
+    uint32_t nDevices;
+    uint32_t nGateways;
+    uint32_t reserved;
+};
+
+static constexpr uint16_t LORA_TRACE_NO_GATEWAY = UINT16_MAX;
+static constexpr char LORA_TRACE_MAGIC[8] = {'L', 'O', 'R', 'A', 'T', 'R', 'C', '1'};
+
+// Потоковая запись трассы пакетов в двоичный файл.
+// Записи копятся в буфере фиксированного размера и пишутся на диск пачками,
+// поэтому память не зависит от длительности симуляции. События передач
+// приходят из LoraUplinkTracker, который сопоставляет прием с устройством
+// и кадром. Итоги за прогон доступны без чтения файла (GetSent/GetDelivered)
+// и считаются по кадрам (устройство, FCnt), как в LoraDeviceCounters:
+// повторы подтверждаемого кадра пишутся как TRACE_RETRANSMITTED и в GetSent
+// не входят, доставка - первый прием текущего кадра любым шлюзом.
+class LoraPacketTraceWriter
+{
+public:
+    LoraPacketTraceWriter()
+        : file(nullptr),
+          bufferRecords(4096),
+          noiseFloorDbm(NAN),
+          nSent(0),
+          nDelivered(0),
+          nRecords(0)
+    {
+    }
+
+    ~LoraPacketTraceWriter() { Close(); }
+
+    LoraPacketTraceWriter(const LoraPacketTraceWriter&) = delete;
+    LoraPacketTraceWriter& operator=(const LoraPacketTraceWriter&) = delete;
+
+    // Число записей в буфере до сброса на диск
+    void SetBufferSize(uint32_t records) { bufferRecords = std::max(records, 1u); }
+
+    // Уровень шума для расчета SNR (NaN - SNR не пишется)
+    void SetNoiseFloor(double dbm) { noiseFloorDbm = dbm; }
+
+    bool Open(const std::string& filename)
+    {
+        file = std::fopen(filename.c_str(), "wb");
+        if (file == nullptr) {
+            return false;
+        }
+        buffer.reserve(bufferRecords);
+        return true;
+    }
+
+    // Подписывается на передачи tracker; заголовок пишется здесь.
+    // noiseModel (необязательно) дает мощность приема для записей потерь;
+    // под нее выделяется [slot][шлюз] по 4 байта
+    void Install(LoraUplinkTracker& tracker, Ptr<LoraNoiseFadingLossModel> noiseModel = nullptr)
+    {
+        uplinks = &tracker;
+        nGateways = tracker.GetNGateways();
+        if (noiseModel) {
+            noiseModel->TraceConnectWithoutContext("RxPower", MakeCallback(&LoraPacketTraceWriter::RxPower, this));
+            noiseModel->TraceConnectWithoutContext("LostRxPower",
+                                                   MakeCallback(&LoraPacketTraceWriter::RxPower, this));
+            powers.assign(size_t(tracker.GetSlots()) * nGateways, NAN);
+            linkPowers.reserve(nGateways);
+        }
+        tracker.TraceSent(MakeCallback(&LoraPacketTraceWriter::Sent, this));
+        tracker.TraceReceived(MakeCallback(&LoraPacketTraceWriter::Received, this));
+        tracker.TraceLost(MakeCallback(&LoraPacketTraceWriter::Lost, this));
+
+        if (file != nullptr) {
+            LoraTraceFileHeader header;
+            std::memcpy(header.magic, LORA_TRACE_MAGIC, sizeof(header.magic));
+            header.recordSize = sizeof(LoraTraceRecord);
+            header.nDevices = tracker.GetNDevices();
+            header.nGateways = tracker.GetNGateways();
+            header.reserved = 0;
+            std::fwrite(&header, sizeof(header), 1, file);
+        }
+    }
+
+    // Сбрасывает буфер и закрывает файл; вызывается после Simulator::Run()
+    void Close()
+    {
+        if (file != nullptr) {
+            Flush();
+            std::fclose(file);
+            file = nullptr;
+        }
+    }
+
+    // Число кадров (без повторов) и доставленных кадров
+    uint64_t GetSent() const { return nSent; }
+    uint64_t GetDelivered() const { return nDelivered; }
+    uint64_t GetRecords() const { return nRecords; }
+
+private:
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+    struct LinkPower
+    {
+        uint32_t txNodeId;
+        uint16_t gateway;
+        float rxPowerDbm;
+    };
+
+    // Канал считает мощность для каждого шлюза перед StartSending
+    // передатчика: значения копятся до отправки того же момента времени
+    void RxPower(uint32_t txNodeId, uint32_t rxNodeId, double rxPowerDbm)
+    {
+        uint32_t gateway = uplinks->GetGateway(rxNodeId);
+        if (gateway == NO_INDEX) {
+            return;
+        }
+        int64_t now = Simulator::Now().GetTimeStep();
+        if (now != linkPowersTime) {
+            linkPowers.clear();
+            linkPowersTime = now;
+        }
+        linkPowers.push_back({txNodeId, uint16_t(gateway), float(rxPowerDbm)});
+    }
+
+    void Sent(const LoraUplink& uplink)
+    {
+        // Мощности по шлюзам запоминаются до приема: у потерянного пакета
+        // PHY шлюза не сообщает RSSI. Строка slot перезаписывается целиком
+        if (!powers.empty()) {
+            float* row = &powers[size_t(uplink.slot) * nGateways];
+            std::fill(row, row + nGateways, NAN);
+            if (Simulator::Now().GetTimeStep() == linkPowersTime) {
+                for (const LinkPower& link : linkPowers) {
+                    if (link.txNodeId == uplink.nodeId) {
+                        row[link.gateway] = link.rxPowerDbm;
+                    }
+                }
+            }
+            // Мощности передачи популяции посчитаны до нее и только ее: следующая
+            // передача служебного узла в тот же момент их не должна получить
+            if (uplink.proxy) {
+                linkPowers.clear();
+            }
+        }
+        LoraTraceEvent event = TRACE_RETRANSMITTED;
+        if (uplink.newFrame) {
+            nSent++;
+            event = TRACE_SENT;
+        }
+        Append(uplink.sentNs, uplink.uid, uplink.device, LORA_TRACE_NO_GATEWAY, event, uplink.sf,
+               uplink.txPowerDbm, NAN);
+    }
+
+    // Копии пакета на разных шлюзах имеют тот же uid, повторы кадра - тот
+    // же FCnt: доставка - только первый прием текущего кадра
+    void Received(const LoraUplink& uplink, const LoraUplinkReception& reception)
+    {
+        LoraTraceEvent event = TRACE_RECEIVED;
+        if (reception.delivery) {
+            nDelivered++;
+            event = TRACE_DELIVERED;
+        }
+        GatewayEvent(uplink, reception.gateway, event, reception.rssiDbm);
+    }
+
+    void Lost(const LoraUplink& uplink, uint32_t gateway, LoraUplinkLoss reason, double rssiDbm)
+    {
+        static const LoraTraceEvent events[] = {TRACE_INTERFERENCE, TRACE_UNDER_SENSITIVITY,
+                                                TRACE_NO_MORE_RECEIVERS};
+        GatewayEvent(uplink, gateway, events[reason], rssiDbm);
+    }
+
+    // Мощность приема без RSSI от источника события берется из мощностей,
+    // сохраненных при отправке
+    void GatewayEvent(const LoraUplink& uplink, uint32_t gateway, LoraTraceEvent event, double rssi)
+    {
+        if (std::isnan(rssi) && !powers.empty()) {
+            rssi = powers[size_t(uplink.slot) * nGateways + gateway];
+        }
+        Append(Simulator::Now().GetNanoSeconds(), uplink.uid, uplink.device, uint16_t(gateway), event, uplink.sf,
+               rssi, rssi - noiseFloorDbm);
+    }
+
+    void Append(int64_t timeNs, uint64_t uid, uint32_t device, uint16_t gateway,
+                LoraTraceEvent event, uint8_t sf, double powerDbm, double snrDb)
+    {
+        nRecords++;
+        if (file == nullptr) {
+            return;
+        }
+        buffer.push_back({timeNs, uid, device, gateway, uint8_t(event), sf, float(powerDbm), float(snrDb)});
+        if (buffer.size() >= bufferRecords) {
+            Flush();
+        }
+    }
+
+    void Flush()
+    {
+        if (!buffer.empty()) {
+            std::fwrite(buffer.data(), sizeof(LoraTraceRecord), buffer.size(), file);
+            buffer.clear();
+        }
+    }
+
+    FILE* file;
+    uint32_t bufferRecords;
+    double noiseFloorDbm;
+    std::vector<LoraTraceRecord> buffer;
+    LoraUplinkTracker* uplinks = nullptr;
+    uint32_t nGateways = 0;
+    std::vector<float> powers;          // [slot][шлюз]: мощность приема, dBm; NaN - неизвестна
+    std::vector<LinkPower> linkPowers;  // Мощности текущего момента до отправки
+    int64_t linkPowersTime = -1;
+    uint64_t nSent;
+    uint64_t nDelivered;
+    uint64_t nRecords;
+};
+
+// Последовательное чтение трассы пачками записей
+class LoraPacketTraceReader
+{
+public:
+    LoraPacketTraceReader()
+        : file(nullptr),
+          position(0)
+    {
+        std::memset(&header, 0, sizeof(header));
+    }
+
+    ~LoraPacketTraceReader()
+    {
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    }
+
+    LoraPacketTraceReader(const LoraPacketTraceReader&) = delete;
+    LoraPacketTraceReader& operator=(const LoraPacketTraceReader&) = delete;
+
+    // false, если файл не открылся или это не трасса этой версии
+    bool Open(const std::string& filename)
+    {
+        file = std::fopen(filename.c_str(), "rb");
+        if (file == nullptr) {
+            return false;
+        }
+        return std::fread(&header, sizeof(header), 1, file) == 1 &&
+               std::memcmp(header.magic, LORA_TRACE_MAGIC, sizeof(header.magic)) == 0 &&
+               header.recordSize == sizeof(LoraTraceRecord);
+    }
+
+    const LoraTraceFileHeader& GetHeader() const { return header; }
+
+    // Следующая запись; false в конце файла
+    bool Next(LoraTraceRecord& record)
+    {
+        if (position == buffer.size()) {
+            buffer.resize(4096);
+            size_t n = std::fread(buffer.data(), sizeof(LoraTraceRecord), buffer.size(), file);
+            buffer.resize(n);
+            position = 0;
+            if (n == 0) {
+                return false;
+            }
+        }
+        record = buffer[position++];
+        return true;
+    }
+
+private:
+    FILE* file;
+    LoraTraceFileHeader header;
+    std::vector<LoraTraceRecord> buffer;
+    size_t position;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_PACKET_TRACE_H */
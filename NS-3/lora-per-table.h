@@ -0,0 +1,249 @@
+#ifndef LORA_PER_TABLE_H
+#define LORA_PER_TABLE_H
+
+#include "lora-chirp.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Заголовки MAC (MHDR, FHDR, FPort, MIC) поверх полезной нагрузки приложения, байт
+static constexpr uint32_t LORA_MAC_OVERHEAD_BYTES = 13;
+
+// Заголовок файла таблицы PER. За ним без выравнивания идут
+// float per[sf][cr][length][snr], SF7..SF12, CR 4/5..4/8.
+// Бин длины k покрывает PHY-нагрузки до (k + 1) * lengthStep байт.
+struct LoraPerTableHeader
+{
+    char magic[8];          // "LORAPER1"
+    uint32_t headerSize;    // sizeof(LoraPerTableHeader)
+    uint32_t nSf;
+    uint32_t nCr;
+    uint32_t nLength;
+    uint32_t lengthStep;    // байт
+    uint32_t nSnr;
+    float snrMinDb;
+    float snrStepDb;
+};
+
+// Вероятность ошибки символа в АБГШ (Elshabrawy, Robert, 2018):
+// SER = Q(sqrt(2 M SNR) - sqrt(1.386 SF + 1.154)), SNR в полосе сигнала
+inline double LoraSymbolErrorRate(uint8_t sf, double snrDb)
+{
+    double snr = std::pow(10.0, snrDb / 10.0);
+    double x = std::sqrt(2.0 * (1u << sf) * snr) - std::sqrt(1.386 * sf + 1.154);
+    return 0.5 * std::erfc(x / M_SQRT2);
+}
+
+// PER из SER по блокам перемежения: заголовок - 8 символов с CR 4/8, нагрузка -
+// блоки по 4 + CR символов. Ошибочный символ портит бит почти в каждом кодовом
+// слове блока, поэтому блок с CR 4/7, 4/8 переживает одну ошибку символа,
+// с CR 4/5, 4/6 - ни одной.
+inline double LoraPacketErrorRate(uint8_t sf, uint8_t cr, uint32_t payloadBytes, double snrDb)
+{
+    double p = LoraSymbolErrorRate(sf, snrDb);
+    auto blockOk = [p](uint32_t length, bool correctsOne) {
+        double ok = std::pow(1.0 - p, length);
+        if (correctsOne) {
+            ok += length * p * std::pow(1.0 - p, length - 1);
+        }
+        return ok;
+    };
+    uint32_t blocks = (LoraPacketSymbols(sf, cr, payloadBytes) - 8) / (4 + cr);
+    double success = blockOk(8, true) * std::pow(blockOk(4 + cr, cr >= 3), blocks);
+    return std::min(std::max(1.0 - success, 0.0), 1.0);
+}
+
+// Таблица PER(SNR, SF, CR, длина) для решения о приеме.
+// Open() отображает файл в память только для чтения (MAP_SHARED), поэтому
+// параллельные процессы сценариев делят одну копию в page cache.
+// Lookup() - адресная арифметика и линейная интерполяция по SNR без ветвлений
+// на границах (значения вне диапазона прижимаются к крайним бинам).
+class LoraPerTable
+{
+public:
+    LoraPerTable()
+        : mapped(nullptr),
+          mappedSize(0),
+          header(nullptr),
+          data(nullptr)
+    {
+    }
+
+    ~LoraPerTable() { Release(); }
+
+    LoraPerTable(const LoraPerTable&) = delete;
+    LoraPerTable& operator=(const LoraPerTable&) = delete;
+
+    bool Open(const std::string& filename)
+    {
+        Release();
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(LoraPerTableHeader)) {
+            close(fd);
+            return false;
+        }
+        void* address = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+        mapped = address;
+        mappedSize = st.st_size;
+        if (!Attach(static_cast<const char*>(address), mappedSize)) {
+            Release();
+            return false;
+        }
+        return true;
+    }
+
+    // Таблица по аналитическим SER/PER в памяти процесса
+    void Generate(double snrMinDb, double snrMaxDb, double snrStepDb, uint32_t maxLength, uint32_t lengthStep)
+    {
+        Release();
+        LoraPerTableHeader h;
+        std::memcpy(h.magic, "LORAPER1", 8);
+        h.headerSize = sizeof(LoraPerTableHeader);
+        h.nSf = 6;
+        h.nCr = 4;
+        h.lengthStep = lengthStep;
+        h.nLength = (maxLength + lengthStep - 1) / lengthStep;
+        h.nSnr = uint32_t(std::floor((snrMaxDb - snrMinDb) / snrStepDb + 1e-9)) + 1;
+        h.snrMinDb = snrMinDb;
+        h.snrStepDb = snrStepDb;
+
+        size_t count = size_t(h.nSf) * h.nCr * h.nLength * h.nSnr;
+        storage.resize(sizeof(h) + count * sizeof(float));
+        std::memcpy(storage.data(), &h, sizeof(h));
+        float* per = reinterpret_cast<float*>(storage.data() + sizeof(h));
+        for (uint32_t s = 0; s < h.nSf; s++) {
+            for (uint32_t c = 0; c < h.nCr; c++) {
+                for (uint32_t l = 0; l < h.nLength; l++) {
+                    for (uint32_t k = 0; k < h.nSnr; k++) {
+                        *per++ = LoraPacketErrorRate(7 + s, 1 + c, (l + 1) * lengthStep,
+                                                     snrMinDb + k * snrStepDb);
+                    }
+                }
+            }
+        }
+        Attach(storage.data(), storage.size());
+    }
+
+    bool Write(const std::string& filename) const
+    {
+        std::ofstream out(filename, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(header), header->headerSize);
+        out.write(reinterpret_cast<const char*>(data), DataCount() * sizeof(float));
+        return bool(out);
+    }
+
+    bool IsLoaded() const { return header != nullptr; }
+    const LoraPerTableHeader& GetHeader() const { return *header; }
+
+    // PER пакета с PHY-нагрузкой payloadBytes; sf 7..12, cr 1..4
+    double Lookup(uint8_t sf, uint8_t cr, uint32_t payloadBytes, double snrDb) const
+    {
+        uint32_t length = std::min((std::max(payloadBytes, 1u) - 1) / header->lengthStep, header->nLength - 1);
+        const float* row = data + ((size_t(sf - 7) * header->nCr + (cr - 1)) * header->nLength + length) * header->nSnr;
+        double x = std::min(std::max((snrDb - header->snrMinDb) * invSnrStep, 0.0), maxSnrIndex);
+        uint32_t k = std::min(uint32_t(x), header->nSnr - 2);
+        double f = x - k;
+        return row[k] + f * (row[k + 1] - row[k]);
+    }
+
+    // SNR, при котором PER пакета падает до per (линейная интерполяция между
+    // бинами); верхний край таблицы, если до него PER так и не опустился
+    double GetSnrForPerDb(uint8_t sf, uint8_t cr, uint32_t payloadBytes, double per) const
+    {
+        double previous = Lookup(sf, cr, payloadBytes, header->snrMinDb);
+        if (previous <= per) {
+            return header->snrMinDb;
+        }
+        for (uint32_t k = 1; k < header->nSnr; k++) {
+            double snrDb = header->snrMinDb + k * header->snrStepDb;
+            double value = Lookup(sf, cr, payloadBytes, snrDb);
+            if (value <= per) {
+                return snrDb - header->snrStepDb * (per - value) / (previous - value);
+            }
+            previous = value;
+        }
+        return header->snrMinDb + (header->nSnr - 1) * header->snrStepDb;
+    }
+
+    // Наименьший SNR, при котором хоть один SF может принять пакет (PER < 1):
+    // ниже него модель потерь отбрасывает линии без обращения к таблице
+    double GetMinUsefulSnrDb() const
+    {
+        for (uint32_t k = 0; k < header->nSnr; k++) {
+            for (size_t row = 0; row < DataCount() / header->nSnr; row++) {
+                if (data[row * header->nSnr + k] < 0.999f) {
+                    return header->snrMinDb + (k > 0 ? k - 1 : 0) * header->snrStepDb;
+                }
+            }
+        }
+        return header->snrMinDb + (header->nSnr - 1) * header->snrStepDb;
+    }
+
+private:
+    bool Attach(const char* base, size_t size)
+    {
+        const LoraPerTableHeader* h = reinterpret_cast<const LoraPerTableHeader*>(base);
+        if (std::memcmp(h->magic, "LORAPER1", 8) != 0 || h->headerSize != sizeof(LoraPerTableHeader) ||
+            h->nSf != 6 || h->nCr != 4 || h->nLength == 0 || h->lengthStep == 0 || h->nSnr < 2 ||
+            h->snrStepDb <= 0) {
+            return false;
+        }
+        size_t count = size_t(h->nSf) * h->nCr * h->nLength * h->nSnr;
+        if (size < h->headerSize + count * sizeof(float)) {
+            return false;
+        }
+        header = h;
+        data = reinterpret_cast<const float*>(base + h->headerSize);
+        invSnrStep = 1.0 / h->snrStepDb;
+        maxSnrIndex = h->nSnr - 1;
+        return true;
+    }
+
+    size_t DataCount() const { return size_t(header->nSf) * header->nCr * header->nLength * header->nSnr; }
+
+    void Release()
+    {
+        if (mapped != nullptr) {
+            munmap(mapped, mappedSize);
+        }
+        mapped = nullptr;
+        mappedSize = 0;
+        storage.clear();
+        header = nullptr;
+        data = nullptr;
+    }
+
+    void* mapped;
+    size_t mappedSize;
+    std::vector<char> storage;      // Таблица, построенная Generate()
+    const LoraPerTableHeader* header;
+    const float* data;
+    double invSnrStep;
+    double maxSnrIndex;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_PER_TABLE_H */
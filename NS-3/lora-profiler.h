@@ -0,0 +1,477 @@
+#ifndef LORA_PROFILER_H
+#define LORA_PROFILER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/propagation-loss-model.h"
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Профилирование горячих путей собирается только с -DLORA_PROFILE; без него
+// LORA_PROFILE_SCOPE пуст, а LoraProfiler ничего не устанавливает.
+// -DLORA_PROFILE_CLOCK_GETTIME меряет clock_gettime вместо счетчика TSC.
+#ifdef LORA_PROFILE
+#define LORA_PROFILE_SCOPE(zone) ::ns3::lorawan::LoraProfileScope loraProfileScope(zone)
+#else
+#define LORA_PROFILE_SCOPE(zone) ((void)0)
+#endif
+
+namespace ns3 {
+namespace lorawan {
+
+#ifdef LORA_PROFILE
+static constexpr bool LORA_PROFILE_ENABLED = true;
+#else
+static constexpr bool LORA_PROFILE_ENABLED = false;
+#endif
+
+// Компоненты, по которым делится время прогона
+enum LoraProfileZone : uint8_t
+{
+    LORA_PROFILE_DEVICE_EVENT,      // Событие узла устройства: приложение, MAC и PHY передачи
+    LORA_PROFILE_GATEWAY_EVENT,     // Событие узла шлюза: путь приема PHY и MAC шлюза
+    LORA_PROFILE_OTHER_EVENT,       // Событие без узла или на узле сервера
+    LORA_PROFILE_SCHEDULER,         // Вставка и выборка событий планировщика
+    LORA_PROFILE_LOSS_CHAIN,        // Вся цепочка потерь канала
+    LORA_PROFILE_LINK_CACHE,        // Кэш потерь LogDistance
+    LORA_PROFILE_NOISE_FADING,      // Шум, замирания и таблица PER
+    LORA_PROFILE_SINR,              // Прием по SINR
+    LORA_PROFILE_MAC_SEND,          // Отправка MAC из LoraBatchedSender и LoraDevicePopulation
+    LORA_PROFILE_TRACKER,           // Учет пакетов: трасса, счетчики, метрики
+    LORA_PROFILE_ZONES
+};
+
+// Имена для файла стеков (без пробелов и ';') и описания для разбивки
+static constexpr const char* LORA_PROFILE_ZONE_NAMES[LORA_PROFILE_ZONES] = {
+    "device_event", "gateway_event", "other_event", "scheduler",  "loss_chain",
+    "link_cache",   "noise_fading",  "sinr",        "mac_send",   "tracker"};
+
+static constexpr const char* LORA_PROFILE_ZONE_DESCRIPTIONS[LORA_PROFILE_ZONES] = {
+    "события устройств (приложение, MAC, PHY передачи)",
+    "события шлюзов (путь приема PHY)",
+    "прочие события",
+    "планировщик событий",
+    "цепочка потерь канала",
+    "кэш потерь",
+    "шум и замирания",
+    "прием по SINR",
+    "отправка MAC (пакетный отправитель, популяция)",
+    "учет пакетов"};
+
+// Стек зон кодируется по 4 бита на уровень (номер зоны + 1)
+static constexpr uint32_t LORA_PROFILE_MAX_DEPTH = 16;
+static_assert(LORA_PROFILE_ZONES < 16, "Номер зоны должен помещаться в 4 бита кода стека");
+
+// Текущее значение часов профилировщика
+inline uint64_t LoraProfileTicks()
+{
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(LORA_PROFILE_CLOCK_GETTIME)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+inline uint64_t LoraProfileNanoseconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+// Счетчики одного потока. Пишет только свой поток, без блокировок;
+// отчет читает их после прогона. Стеки зон нумеруются подряд при первом
+// входе (0 - пустой стек), поэтому выход из зоны - прибавление к элементу
+// плоского массива без хеширования
+struct LoraProfileThread
+{
+    struct Frame
+    {
+        uint64_t start;
+        uint64_t child;     // Время вложенных зон
+        uint32_t stack;     // Номер стека с этой зоной на вершине
+        uint8_t zone;
+    };
+
+    Frame frames[LORA_PROFILE_MAX_DEPTH];
+    uint32_t depth = 0;
+    uint32_t overflow = 0;  // Зоны глубже LORA_PROFILE_MAX_DEPTH идут в родителя
+    uint32_t open[LORA_PROFILE_ZONES] = {};
+    uint64_t calls[LORA_PROFILE_ZONES] = {};
+    uint64_t selfTicks[LORA_PROFILE_ZONES] = {};
+    uint64_t totalTicks[LORA_PROFILE_ZONES] = {};
+    std::vector<uint64_t> stackCode = {0};      // Номер стека -> код (по 4 бита на уровень)
+    std::vector<uint64_t> stackTicks = {0};     // Номер стека -> собственное время
+    std::vector<uint32_t> stackChild = std::vector<uint32_t>(LORA_PROFILE_ZONES, 0); // [стек][зона] -> номер, 0 - нет
+
+    void Enter(LoraProfileZone zone)
+    {
+        if (depth == LORA_PROFILE_MAX_DEPTH) {
+            overflow++;
+            return;
+        }
+        uint32_t parent = depth > 0 ? frames[depth - 1].stack : 0;
+        uint32_t stack = stackChild[parent * LORA_PROFILE_ZONES + zone];
+        if (stack == 0) {
+            stack = AddStack(parent, zone);
+        }
+        frames[depth++] = {LoraProfileTicks(), 0, stack, zone};
+        open[zone]++;
+    }
+
+    void Leave()
+    {
+        if (overflow > 0) {
+            overflow--;
+            return;
+        }
+        uint64_t now = LoraProfileTicks();
+        const Frame& f = frames[--depth];
+        uint64_t elapsed = now - f.start;
+        uint64_t self = elapsed > f.child ? elapsed - f.child : 0;
+        calls[f.zone]++;
+        selfTicks[f.zone] += self;
+        // Рекурсивный вход в зону не считает ее полное время дважды
+        if (--open[f.zone] == 0) {
+            totalTicks[f.zone] += elapsed;
+        }
+        stackTicks[f.stack] += self;
+        if (depth > 0) {
+            frames[depth - 1].child += elapsed;
+        }
+    }
+
+    uint32_t AddStack(uint32_t parent, LoraProfileZone zone)
+    {
+        uint32_t stack = stackCode.size();
+        stackCode.push_back((stackCode[parent] << 4) | (zone + 1u));
+        stackTicks.push_back(0);
+        stackChild.resize(stackChild.size() + LORA_PROFILE_ZONES, 0);
+        stackChild[parent * LORA_PROFILE_ZONES + zone] = stack;
+        return stack;
+    }
+};
+
+// Строка разбивки по компонентам
+struct LoraProfileLine
+{
+    LoraProfileZone zone;
+    uint64_t calls;
+    double selfMs;          // Без вложенных зон
+    double totalMs;         // Вместе с вложенными
+};
+
+// Сбор профиля со всех потоков: разбивка по компонентам и файл свернутых
+// стеков ("a;b;c <нс>" на строку), который читают flamegraph.pl и speedscope
+class LoraProfiler
+{
+public:
+    static LoraProfileThread& Current()
+    {
+        thread_local LoraProfileThread* thread = Register();
+        return *thread;
+    }
+
+    // Тактов часов на наносекунду, по интервалу с первой зоны прогона
+    static double TicksPerNanosecond()
+    {
+        uint64_t ns = LoraProfileNanoseconds() - Start().ns;
+        uint64_t ticks = LoraProfileTicks() - Start().ticks;
+        return ns > 0 && ticks > 0 ? double(ticks) / ns : 1.0;
+    }
+
+    static std::vector<LoraProfileLine> GetBreakdown()
+    {
+        std::lock_guard<std::mutex> lock(Mutex());
+        double msPerTick = 1e-6 / TicksPerNanosecond();
+        std::vector<LoraProfileLine> lines;
+        for (uint32_t z = 0; z < LORA_PROFILE_ZONES; z++) {
+            LoraProfileLine line = {LoraProfileZone(z), 0, 0, 0};
+            for (const LoraProfileThread* t : Threads()) {
+                line.calls += t->calls[z];
+                line.selfMs += t->selfTicks[z] * msPerTick;
+                line.totalMs += t->totalTicks[z] * msPerTick;
+            }
+            if (line.calls > 0) {
+                lines.push_back(line);
+            }
+        }
+        std::sort(lines.begin(), lines.end(),
+                  [](const LoraProfileLine& a, const LoraProfileLine& b) { return a.selfMs > b.selfMs; });
+        return lines;
+    }
+
+    static bool WriteFoldedStacks(const std::string& filename)
+    {
+        std::lock_guard<std::mutex> lock(Mutex());
+        double nsPerTick = 1.0 / TicksPerNanosecond();
+        std::unordered_map<uint64_t, uint64_t> merged;
+        for (const LoraProfileThread* t : Threads()) {
+            for (size_t k = 1; k < t->stackCode.size(); k++) {
+                merged[t->stackCode[k]] += t->stackTicks[k];
+            }
+        }
+        std::ofstream out(filename);
+        for (const auto& entry : merged) {
+            uint64_t ns = uint64_t(entry.second * nsPerTick);
+            if (ns == 0) {
+                continue;
+            }
+            // Старшие полубайты кода - внешние зоны
+            std::string line;
+            for (int shift = 60; shift >= 0; shift -= 4) {
+                uint32_t zone = (entry.first >> shift) & 0xF;
+                if (zone == 0) {
+                    continue;
+                }
+                if (!line.empty()) {
+                    line += ';';
+                }
+                line += LORA_PROFILE_ZONE_NAMES[zone - 1];
+            }
+            out << line << ' ' << ns << '\n';
+        }
+        return bool(out);
+    }
+
+private:
+    struct Origin
+    {
+        uint64_t ticks;
+        uint64_t ns;
+    };
+
+    static Origin& Start()
+    {
+        static Origin origin = {LoraProfileTicks(), LoraProfileNanoseconds()};
+        return origin;
+    }
+
+    static std::mutex& Mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    // Счетчики потоков живут до конца процесса, чтобы попасть в отчет
+    static std::vector<LoraProfileThread*>& Threads()
+    {
+        static std::vector<LoraProfileThread*> threads;
+        return threads;
+    }
+
+    static LoraProfileThread* Register()
+    {
+        Start();
+        std::lock_guard<std::mutex> lock(Mutex());
+        Threads().push_back(new LoraProfileThread());
+        return Threads().back();
+    }
+};
+
+// Зона на время жизни объекта
+class LoraProfileScope
+{
+public:
+    explicit LoraProfileScope(LoraProfileZone zone)
+        : thread(LoraProfiler::Current())
+    {
+        thread.Enter(zone);
+    }
+
+    ~LoraProfileScope() { thread.Leave(); }
+
+    LoraProfileScope(const LoraProfileScope&) = delete;
+    LoraProfileScope& operator=(const LoraProfileScope&) = delete;
+
+private:
+    LoraProfileThread& thread;
+};
+
+// Планировщик-обертка: время вставки и выборки идет в зону планировщика,
+// а время от выборки события до следующей - в зону события по его узлу
+// (контексту). Так путь приема PHY шлюза и отправка устройства ns-3
+// меряются без правки модуля lorawan.
+class LoraProfiledScheduler : public Scheduler
+{
+public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::LoraProfiledScheduler")
+                                .SetParent<Scheduler>()
+                                .SetGroupName("Lorawan")
+                                .AddConstructor<LoraProfiledScheduler>();
+        return tid;
+    }
+
+    LoraProfiledScheduler()
+        : scheduler(CreateObject<MapScheduler>())
+    {
+    }
+
+    // Узлы шлюзов; остальные узлы с контекстом считаются устройствами
+    static void SetGatewayNodes(NodeContainer gateways)
+    {
+        for (uint32_t g = 0; g < gateways.GetN(); g++) {
+            uint32_t id = gateways.Get(g)->GetId();
+            if (id >= GatewayNodes().size()) {
+                GatewayNodes().resize(id + 1, false);
+            }
+            GatewayNodes()[id] = true;
+        }
+    }
+
+    // Закрывает зону последнего события (после Simulator::Run)
+    static void Finish()
+    {
+        if (EventOpen()) {
+            LoraProfiler::Current().Leave();
+            EventOpen() = false;
+        }
+    }
+
+    void Insert(const Event& ev) override
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_SCHEDULER);
+        scheduler->Insert(ev);
+    }
+
+    bool IsEmpty() const override { return scheduler->IsEmpty(); }
+
+    Event PeekNext() const override
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_SCHEDULER);
+        return scheduler->PeekNext();
+    }
+
+    Event RemoveNext() override
+    {
+        Finish();
+        Event ev;
+        {
+            LORA_PROFILE_SCOPE(LORA_PROFILE_SCHEDULER);
+            ev = scheduler->RemoveNext();
+        }
+        LoraProfiler::Current().Enter(EventZone(ev.key.m_context));
+        EventOpen() = true;
+        return ev;
+    }
+
+    void Remove(const Event& ev) override
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_SCHEDULER);
+        scheduler->Remove(ev);
+    }
+
+private:
+    static bool& EventOpen()
+    {
+        thread_local bool open = false;
+        return open;
+    }
+
+    static std::vector<bool>& GatewayNodes()
+    {
+        static std::vector<bool> nodes;
+        return nodes;
+    }
+
+    static LoraProfileZone EventZone(uint32_t context)
+    {
+        if (context == 0xffffffff) {
+            return LORA_PROFILE_OTHER_EVENT;
+        }
+        if (context < GatewayNodes().size() && GatewayNodes()[context]) {
+            return LORA_PROFILE_GATEWAY_EVENT;
+        }
+        return LORA_PROFILE_DEVICE_EVENT;
+    }
+
+    Ptr<Scheduler> scheduler;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LoraProfiledScheduler);
+
+// Обертка всей цепочки потерь канала: собственные модели цепочки меряются
+// вложенными зонами, остаток - время моделей ns-3 (LogDistance и прочих)
+class LoraProfiledLossModel : public PropagationLossModel
+{
+public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::LoraProfiledLossModel")
+                                .SetParent<PropagationLossModel>()
+                                .SetGroupName("Lorawan")
+                                .AddConstructor<LoraProfiledLossModel>();
+        return tid;
+    }
+
+    void SetLossModel(Ptr<PropagationLossModel> model) { lossModel = model; }
+
+private:
+    double DoCalcRxPower(double txPowerDbm,
+                         Ptr<MobilityModel> a,
+                         Ptr<MobilityModel> b) const override
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_LOSS_CHAIN);
+        return lossModel->CalcRxPower(txPowerDbm, a, b);
+    }
+
+    int64_t DoAssignStreams(int64_t stream) override { return lossModel->AssignStreams(stream); }
+
+    Ptr<PropagationLossModel> lossModel;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(LoraProfiledLossModel);
+
+// Установка профилирования в сценарий; без LORA_PROFILE ничего не меняет
+class LoraProfilerHelper
+{
+public:
+    // Планировщик с зонами событий. Можно вызывать и после Schedule:
+    // Simulator::SetScheduler переносит уже запланированные события в новый
+    // планировщик, но их первая вставка в зону планировщика не попадает
+    static void InstallScheduler(NodeContainer gateways)
+    {
+        if (!LORA_PROFILE_ENABLED) {
+            return;
+        }
+        LoraProfiledScheduler::SetGatewayNodes(gateways);
+        ObjectFactory factory;
+        factory.SetTypeId("ns3::LoraProfiledScheduler");
+        Simulator::SetScheduler(factory);
+    }
+
+    // Вызывается сразу после Simulator::Run, до отчета
+    static void Finish() { LoraProfiledScheduler::Finish(); }
+
+    // Модель для канала: обертка цепочки или сама цепочка
+    static Ptr<PropagationLossModel> WrapLossModel(Ptr<PropagationLossModel> model)
+    {
+        if (!LORA_PROFILE_ENABLED) {
+            return model;
+        }
+        Ptr<LoraProfiledLossModel> wrapper = CreateObject<LoraProfiledLossModel>();
+        wrapper->SetLossModel(model);
+        return wrapper;
+    }
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_PROFILER_H */
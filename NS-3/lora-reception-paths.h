@@ -0,0 +1,136 @@
+#ifndef LORA_RECEPTION_PATHS_H
+#define LORA_RECEPTION_PATHS_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lorawan-module.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Число путей демодуляции шлюза класса SX1301
+static constexpr uint32_t LORA_GATEWAY_RECEPTION_PATHS = 8;
+
+// Пул путей демодуляции шлюзов. Все пути лежат одним массивом слотов
+// [шлюз][путь], свободные слоты шлюза - стеком в том же разбиении, поэтому
+// захват и освобождение - O(1) без выделений памяти. Пакет, пришедший при
+// занятых путях, теряется и считается отдельно от потерь по SNR и помехам.
+//
+// Модель SINR (LoraSinrReception::SetReceptionPaths) занимает пути сама.
+// В режиме PHY шлюза ns-3 пути моделирует GatewayLoraPhy; SetPhyPaths задает
+// их число, а потери берутся из трассы LostPacketBecauseNoMoreReceivers.
+class LoraReceptionPathPool
+{
+public:
+    static constexpr uint32_t NO_PATH = UINT32_MAX;
+
+    LoraReceptionPathPool()
+        : paths(LORA_GATEWAY_RECEPTION_PATHS),
+          nLostNoPath(0)
+    {
+    }
+
+    // Пути на каждом из nGateways шлюзов
+    void Resize(uint32_t nGateways, uint32_t pathsPerGateway)
+    {
+        paths = std::max<uint32_t>(pathsPerGateway, 1);
+        freeSlots.resize(size_t(nGateways) * paths);
+        for (uint32_t s = 0; s < freeSlots.size(); s++) {
+            freeSlots[s] = s;
+        }
+        nFree.assign(nGateways, paths);
+        peakBusy.assign(nGateways, 0);
+        lostNoPath.assign(nGateways, 0);
+        nLostNoPath = 0;
+    }
+
+    uint32_t GetNGateways() const { return nFree.size(); }
+    uint32_t GetPathsPerGateway() const { return paths; }
+
+    // Свободный путь шлюза; NO_PATH - все заняты (потеря учитывается)
+    uint32_t Allocate(uint32_t gateway)
+    {
+        if (nFree[gateway] == 0) {
+            lostNoPath[gateway]++;
+            nLostNoPath++;
+            return NO_PATH;
+        }
+        uint32_t slot = freeSlots[size_t(gateway) * paths + --nFree[gateway]];
+        peakBusy[gateway] = std::max(peakBusy[gateway], paths - nFree[gateway]);
+        return slot;
+    }
+
+    void Release(uint32_t slot)
+    {
+        uint32_t gateway = slot / paths;
+        freeSlots[size_t(gateway) * paths + nFree[gateway]++] = slot;
+    }
+
+    uint32_t GetBusy(uint32_t gateway) const { return paths - nFree[gateway]; }
+
+    // Наибольшее число одновременно занятых путей шлюза
+    uint32_t GetPeakBusy(uint32_t gateway) const { return peakBusy[gateway]; }
+
+    // Потери из-за занятости всех путей
+    uint64_t GetLostNoPath() const { return nLostNoPath; }
+    uint64_t GetLostNoPath(uint32_t gateway) const { return lostNoPath[gateway]; }
+
+    // Шлюзы, хоть раз занявшие все пути или потерявшие пакет без пути
+    uint32_t GetSaturatedGateways() const
+    {
+        uint32_t n = 0;
+        for (uint32_t g = 0; g < nFree.size(); g++) {
+            n += peakBusy[g] == paths || lostNoPath[g] > 0;
+        }
+        return n;
+    }
+
+    // Число путей PHY шлюзов ns-3 и подсчет их потерь по трассе
+    void SetPhyPaths(NodeContainer gateways, uint32_t pathsPerGateway)
+    {
+        Resize(gateways.GetN(), pathsPerGateway);
+        for (uint32_t g = 0; g < gateways.GetN(); g++) {
+            Ptr<Node> node = gateways.Get(g);
+            if (node->GetId() >= gatewayByNode.size()) {
+                gatewayByNode.resize(node->GetId() + 1, NO_PATH);
+            }
+            gatewayByNode[node->GetId()] = g;
+
+            Ptr<GatewayLoraPhy> phy =
+                node->GetDevice(0)->GetObject<LoraNetDevice>()->GetPhy()->GetObject<GatewayLoraPhy>();
+            phy->ResetReceptionPaths();
+            for (uint32_t k = 0; k < paths; k++) {
+                phy->AddReceptionPath();
+            }
+            phy->TraceConnectWithoutContext(
+                "LostPacketBecauseNoMoreReceivers",
+                MakeCallback(&LoraReceptionPathPool::PhyNoMoreReceivers, this));
+        }
+    }
+
+private:
+    void PhyNoMoreReceivers(Ptr<const Packet> packet, uint32_t nodeId)
+    {
+        if (nodeId < gatewayByNode.size() && gatewayByNode[nodeId] != NO_PATH) {
+            lostNoPath[gatewayByNode[nodeId]]++;
+            nLostNoPath++;
+        }
+    }
+
+    uint32_t paths;
+    std::vector<uint32_t> freeSlots;        // [шлюз][путь], первые nFree - свободные
+    std::vector<uint32_t> nFree;
+    std::vector<uint32_t> peakBusy;
+    std::vector<uint64_t> lostNoPath;
+    std::vector<uint32_t> gatewayByNode;
+    uint64_t nLostNoPath;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_RECEPTION_PATHS_H */
@@ -0,0 +1,13 @@
+#ifndef LORA_RECEPTION_THRESHOLDS_H
+#define LORA_RECEPTION_THRESHOLDS_H
+
+namespace ns3 {
+namespace lorawan {
+
+// Минимальный SINR демодуляции по SF, dB (SX1276, BW 125 кГц); индекс - SF-7
+static constexpr double LORA_SINR_FLOOR_DB[6] = {-7.5, -10.0, -12.5, -15.0, -17.5, -20.0};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_RECEPTION_THRESHOLDS_H */
@@ -0,0 +1,269 @@
+#ifndef LORA_REPLICATION_H
+#define LORA_REPLICATION_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Запуск независимых повторов сценария в отдельных процессах и
+// статистическая обработка строк "RESULT" (см. LoraDeviceCounters::Print).
+
+// Итог одного устройства в одном повторе
+struct DeviceResult
+{
+    uint32_t device;
+    uint32_t sf;
+    uint64_t sent;
+    uint64_t received;
+};
+
+// Итог одного процесса сценария
+struct ReplicationResult
+{
+    uint64_t run;
+    int exitStatus;
+    std::vector<DeviceResult> devices;
+
+    bool IsOk() const { return exitStatus == 0 && !devices.empty(); }
+
+    uint64_t GetSent() const
+    {
+        uint64_t total = 0;
+        for (const DeviceResult& d : devices) {
+            total += d.sent;
+        }
+        return total;
+    }
+
+    uint64_t GetReceived() const
+    {
+        uint64_t total = 0;
+        for (const DeviceResult& d : devices) {
+            total += d.received;
+        }
+        return total;
+    }
+};
+
+// Разбор вывода сценария; строки без префикса RESULT пропускаются
+inline std::vector<DeviceResult> ParseDeviceResults(const std::string& output)
+{
+    std::vector<DeviceResult> results;
+    std::istringstream lines(output);
+    std::string line;
+    while (std::getline(lines, line)) {
+        DeviceResult r;
+        unsigned long long sent, received;
+        if (std::sscanf(line.c_str(), "RESULT device=%u sf=%u sent=%llu received=%llu",
+                        &r.device, &r.sf, &sent, &received) == 4) {
+            r.sent = sent;
+            r.received = received;
+            results.push_back(r);
+        }
+    }
+    return results;
+}
+
+// Выполняет команду в дочернем процессе и возвращает ее stdout
+inline int RunProcess(const std::string& command, std::string& output)
+{
+    output.clear();
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr) {
+        return -1;
+    }
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+        output.append(buffer, n);
+    }
+    return pclose(pipe);
+}
+
+// Пул из jobs потоков, каждый из которых запускает процессы по очереди.
+// Результат i-й команды записывается в i-й элемент; run заполняет вызывающий.
+inline std::vector<ReplicationResult> RunCommands(const std::vector<std::string>& commands,
+                                                  unsigned jobs)
+{
+    std::vector<ReplicationResult> results(commands.size());
+    std::atomic<size_t> next(0);
+    jobs = std::max(1u, std::min<unsigned>(jobs, commands.size()));
+
+    auto worker = [&]() {
+        std::string output;
+        for (size_t i = next++; i < commands.size(); i = next++) {
+            results[i].run = 0;
+            results[i].exitStatus = RunProcess(commands[i], output);
+            results[i].devices = ParseDeviceResults(output);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned j = 0; j < jobs; j++) {
+        pool.emplace_back(worker);
+    }
+    for (std::thread& t : pool) {
+        t.join();
+    }
+    return results;
+}
+
+// Каждый повтор получает собственный --RngRun, поэтому повторы независимы
+inline std::vector<ReplicationResult> RunReplications(const std::string& command,
+                                                      const std::vector<uint64_t>& runs,
+                                                      unsigned jobs)
+{
+    std::vector<std::string> commands;
+    for (uint64_t run : runs) {
+        commands.push_back(command + " --RngRun=" + std::to_string(run));
+    }
+    std::vector<ReplicationResult> results = RunCommands(commands, jobs);
+    for (size_t i = 0; i < runs.size(); i++) {
+        results[i].run = runs[i];
+    }
+    return results;
+}
+
+// Квантиль стандартного нормального распределения (Acklam)
+inline double NormalQuantile(double p)
+{
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02,
+                               -2.759285104469687e+02, 1.383577518672690e+02,
+                               -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02,
+                               -1.556989798598866e+02, 6.680131188771972e+01,
+                               -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01,
+                               -2.400758277161838e+00, -2.549732539343734e+00,
+                               4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01,
+                               2.445134137142996e+00, 3.754408661907416e+00};
+    if (p < 0.02425) {
+        double q = sqrt(-2 * log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+    }
+    if (p > 1 - 0.02425) {
+        return -NormalQuantile(1 - p);
+    }
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+// Двусторонний квантиль распределения Стьюдента: P(|T| > t) = alpha
+// (G. W. Hill, Algorithm 396)
+inline double StudentTQuantile(double alpha, unsigned n)
+{
+    if (n == 1) {
+        return cos(alpha * M_PI / 2) / sin(alpha * M_PI / 2);
+    }
+    if (n == 2) {
+        return sqrt(2 / (alpha * (2 - alpha)) - 2);
+    }
+    double a = 1 / (n - 0.5);
+    double b = 48 / (a * a);
+    double c = ((20700 * a / b - 98) * a - 16) * a + 96.36;
+    double d = ((94.5 / (b + c) - 3) / b + 1) * sqrt(a * M_PI / 2) * n;
+    double x = d * alpha;
+    double y = pow(x, 2.0 / n);
+    if (y > 0.05 + a) {
+        x = NormalQuantile(alpha * 0.5);
+        y = x * x;
+        if (n < 5) {
+            c += 0.3 * (n - 4.5) * (x + 0.6);
+        }
+        c = (((0.05 * d * x - 5) * x - 7) * x - 2) * x + b + c;
+        y = (((((0.4 * y + 6.3) * y + 36) * y + 94.5) / c - y - 3) / b + 1) * x;
+        y = a * y * y;
+        y = y > 0.002 ? exp(y) - 1 : 0.5 * y * y + y;
+    } else {
+        y = ((1 / (((n + 6) / (n * y) - 0.089 * d - 0.822) * (n + 2) * 3) + 0.5 / (n + 4)) * y - 1) *
+                (n + 1) / (n + 2) +
+            1 / y;
+    }
+    return sqrt(n * y);
+}
+
+// Среднее и полуширина доверительного интервала по выборке повторов
+struct ConfidenceInterval
+{
+    unsigned n;
+    double mean;
+    double stddev;
+    double halfWidth;
+};
+
+inline ConfidenceInterval MeanConfidenceInterval(const std::vector<double>& samples, double level)
+{
+    ConfidenceInterval ci = {unsigned(samples.size()), 0.0, 0.0, 0.0};
+    if (samples.empty()) {
+        return ci;
+    }
+    for (double s : samples) {
+        ci.mean += s;
+    }
+    ci.mean /= samples.size();
+    if (samples.size() < 2) {
+        return ci;
+    }
+    double sumSq = 0;
+    for (double s : samples) {
+        sumSq += (s - ci.mean) * (s - ci.mean);
+    }
+    ci.stddev = sqrt(sumSq / (samples.size() - 1));
+    ci.halfWidth = StudentTQuantile(1 - level, samples.size() - 1) * ci.stddev / sqrt(samples.size());
+    return ci;
+}
+
+// PDR (в %) каждого повтора по группам: общий, по устройствам и по SF.
+// Повторы, в которых группа ничего не отправила, в выборку группы не входят.
+struct PdrSamples
+{
+    std::vector<double> total;
+    std::map<uint32_t, std::vector<double>> perDevice;
+    std::map<uint32_t, std::vector<double>> perSf;
+};
+
+inline PdrSamples CollectPdrSamples(const std::vector<ReplicationResult>& results)
+{
+    PdrSamples samples;
+    for (const ReplicationResult& r : results) {
+        if (!r.IsOk()) {
+            continue;
+        }
+        if (r.GetSent() > 0) {
+            samples.total.push_back(100.0 * r.GetReceived() / r.GetSent());
+        }
+        std::map<uint32_t, std::pair<uint64_t, uint64_t>> sfTotals;
+        for (const DeviceResult& d : r.devices) {
+            if (d.sent > 0) {
+                samples.perDevice[d.device].push_back(100.0 * d.received / d.sent);
+            }
+            sfTotals[d.sf].first += d.sent;
+            sfTotals[d.sf].second += d.received;
+        }
+        for (const auto& sf : sfTotals) {
+            if (sf.second.first > 0) {
+                samples.perSf[sf.first].push_back(100.0 * sf.second.second / sf.second.first);
+            }
+        }
+    }
+    return samples;
+}
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_REPLICATION_H */
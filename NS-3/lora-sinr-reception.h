@@ -0,0 +1,552 @@
+#ifndef LORA_SINR_RECEPTION_H
+#define LORA_SINR_RECEPTION_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lorawan-module.h"
+
+#include "lora-airtime.h"
+#include "lora-analytic-pdr.h"
+#include "lora-binary-log.h"
+#include "lora-cell-partition.h"
+#include "lora-uplink-tracker.h"
+#include "lora-noise-fading-loss-model.h"
+#include "lora-per-table.h"
+#include "lora-profiler.h"
+#include "lora-reception-paths.h"
+#include "lora-reception-thresholds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Пороги захвата (изоляция SF, Goursaud): пакет SF i выживает против помехи
+// SF j, если энергия сигнала / энергия помехи >= LORA_CAPTURE_DB[i][j], dB
+static constexpr double LORA_CAPTURE_DB[6][6] = {
+    {6, -16, -18, -19, -19, -20},
+    {-24, 6, -20, -22, -22, -22},
+    {-27, -27, 6, -23, -25, -25},
+    {-30, -30, -30, 6, -26, -28},
+    {-33, -33, -33, -33, 6, -29},
+    {-36, -36, -36, -36, -36, 6},
+};
+
+// Прием по SINR вместо фиксированного порога SNR.
+// Для каждой пары (шлюз, канал) хранятся суммарная мощность идущих передач
+// по каждому SF, ее интеграл по времени (энергия) и куча моментов окончания.
+// На начало и конец приема интегралы продвигаются до текущего момента,
+// снимая закончившиеся передачи с вершины кучи, - O(log n) на событие.
+// Энергия помехи за время пакета = разность интегралов на его концах минус
+// собственная энергия, поэтому активные пакеты не перебираются. Чтобы
+// интегралы занятой без перерывов ячейки не росли без предела, раз в
+// REBASE_SPAN их начало отсчета переносится на текущий момент за O(1):
+// приемы, начатые до переноса, вычитают из начала сохраненный сдвиг.
+// Пакет принят, если SINR (шум + все помехи) не ниже порога демодуляции SF
+// и для каждого SF помехи выполнен порог захвата.
+//
+// Передачи приходят из LoraUplinkTracker, а решения о приеме и потерях с
+// причиной возвращаются в него (AddReceived, AddLost), так что счетчики,
+// трасса и метрики по окнам видят решения этой модели, а не PHY шлюзов.
+// Мощности по линиям берутся из трассы RxPower модели LoraNoiseFadingLossModel
+// (после замираний), поэтому ее порог SNR нужно опустить до порога SF12.
+// С таблицей PER (SetPerTable) жесткий порог демодуляции заменяется
+// розыгрышем PER(SINR, SF, CR, длина пакета).
+// При разбиении на ячейки (Partitioned.cc) мощности передач пишутся в трассу
+// эфира (SetAirtimeExport), а передачи соседних ячеек из их трасс занимают
+// эфир шлюзов как помехи без собственного приема (SetExternalInterference).
+// С пулом путей демодуляции (SetReceptionPaths) пакет, чей SNR позволяет
+// захватить преамбулу, занимает путь шлюза на время приема; если все пути
+// заняты, он остается в эфире только помехой и считается потерей без пути.
+// Передачи шлюзов (ACK, GatewayTransmitting) моделируют полудуплекс: прием,
+// во время которого шлюз передавал, теряется.
+class LoraSinrReception
+{
+public:
+    LoraSinrReception()
+        : noiseMw(0.0),
+          detectPowerDbm{},
+          uplinks(nullptr),
+          nReceived(0),
+          nLostUnderFloor(0),
+          nLostInterference(0),
+          nLostTransmitting(0),
+          maxActive(0),
+          linkPowersTime(-1),
+          perTable(nullptr),
+          perCodingRate(1),
+          perRng(CreateObject<UniformRandomVariable>()),
+          airtimeExport(nullptr),
+          nextExternal(0),
+          pathPool(nullptr),
+          rebaseSpan(Seconds(REBASE_SPAN_S).GetTimeStep())
+    {
+    }
+
+    // tracker должен быть установлен без приемов PHY шлюзов
+    void Install(LoraUplinkTracker& tracker, Ptr<LoraNoiseFadingLossModel> model)
+    {
+        uplinks = &tracker;
+        noiseMw = model->IsNoiseEnabled() ? model->GetNoiseFloorLinear() : 0.0;
+        model->TraceConnectWithoutContext("RxPower", MakeCallback(&LoraSinrReception::RxPower, this));
+        model->AddRandomStream(perRng);
+        tracker.TraceSent(MakeCallback(&LoraSinrReception::Sent, this));
+
+        gatewayIndex.clear();
+        for (uint32_t g = 0; g < tracker.GetNGateways(); g++) {
+            gatewayIndex.push_back(g);
+        }
+        cells.assign(size_t(tracker.GetNGateways()) * MAX_CHANNELS, Cell());
+        gatewayBusyUntilNs.assign(tracker.GetNGateways(), 0);
+        gatewayTransmissions.assign(tracker.GetNGateways(), 0);
+        received.assign(tracker.GetNDevices(), 0);
+        UpdateDetectThresholds();
+    }
+
+    // Прием по таблице PER вместо порогов LORA_SINR_FLOOR_DB
+    void SetPerTable(const LoraPerTable* table, uint8_t cr = 1)
+    {
+        perTable = table;
+        perCodingRate = cr;
+        UpdateDetectThresholds();
+    }
+
+    // Каждая услышанная шлюзом передача пишется в трассу эфира ячейки.
+    // gatewayIds - глобальные индексы шлюзов (по умолчанию - порядок Install)
+    void SetAirtimeExport(LoraAirtimeTraceWriter* writer, std::vector<uint32_t> gatewayIds = {})
+    {
+        airtimeExport = writer;
+        if (!gatewayIds.empty()) {
+            gatewayIndex = gatewayIds;
+        }
+    }
+
+    // Передачи вне моделируемых устройств: поле gateway - индекс шлюза в
+    // порядке Install. Записи идут цепочкой событий по времени начала, так
+    // что в планировщике ждет одно событие начала и события окончания
+    // передач, идущих в эфире
+    void SetExternalInterference(std::vector<LoraAirtimeRecord> records)
+    {
+        external = std::move(records);
+        std::sort(external.begin(), external.end(),
+                  [](const LoraAirtimeRecord& a, const LoraAirtimeRecord& b) { return a.startNs < b.startNs; });
+        nextExternal = 0;
+        if (!external.empty()) {
+            Simulator::Schedule(NanoSeconds(external[0].startNs), &LoraSinrReception::StartExternal, this);
+        }
+    }
+
+    uint64_t GetExternal() const { return nextExternal; }
+
+    // Пути демодуляции шлюзов; пул размечен по шлюзам в порядке Install
+    void SetReceptionPaths(LoraReceptionPathPool* pool) { pathPool = pool; }
+
+    // Шлюз gateway передает до момента untilNs (LoraDownlinkScheduler::TraceTransmit)
+    void GatewayTransmitting(uint32_t gateway, int64_t untilNs)
+    {
+        gatewayBusyUntilNs[gateway] = untilNs;
+        gatewayTransmissions[gateway]++;
+    }
+
+    uint64_t GetReceived(uint32_t device) const { return received[device]; }
+    uint64_t GetReceived() const { return nReceived; }
+
+    // Приемы на шлюзах, отвергнутые по порогу демодуляции и по захвату
+    uint64_t GetLostUnderFloor() const { return nLostUnderFloor; }
+    uint64_t GetLostInterference() const { return nLostInterference; }
+
+    // Приемы, потерянные из-за передачи шлюза
+    uint64_t GetLostTransmitting() const { return nLostTransmitting; }
+
+    // Наибольшее число одновременных приемов на одном шлюзе и канале
+    size_t GetMaxActive() const { return maxActive; }
+
+private:
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+    static constexpr uint32_t MAX_CHANNELS = 16;
+    // Период переноса начала интегралов, с. Больше самого длинного пакета
+    // (SF12, 255 байт - около 10 с), поэтому за время приема переносов не
+    // больше одного; точность разности теряется на log2(период / пакет) бит
+    static constexpr double REBASE_SPAN_S = 600.0;
+
+    struct Ending
+    {
+        int64_t time;
+        uint8_t sf;         // Индекс SF (0 - SF7)
+        double powerMw;
+
+        bool operator>(const Ending& other) const { return time > other.time; }
+    };
+
+    struct Cell
+    {
+        int64_t lastTime = 0;
+        uint32_t active = 0;        // Приемы и внешние передачи, еще не закончившиеся
+        double powerMw[6] = {0};
+        double energy[6] = {0};     // mW * шаг времени от начала отсчета originTime
+        int64_t originTime = 0;
+        uint32_t epoch = 0;         // Число переносов начала отсчета
+        double shift[6] = {0};      // Сдвиг интегралов при последнем переносе
+        std::priority_queue<Ending, std::vector<Ending>, std::greater<Ending>> ending;
+    };
+
+    struct Reception
+    {
+        uint32_t cell;
+        uint32_t transmission;
+        uint32_t path;      // Слот пула путей; NO_PATH - путь не занимался
+        uint32_t epoch;     // Cell::epoch в начале приема
+        uint32_t gatewayTx; // Передач шлюза к началу приема
+        bool gatewayBusy;   // Шлюз передавал в начале приема
+        uint8_t sf;
+        double powerMw;
+        int64_t duration;
+        double startEnergy[6];
+    };
+
+    struct Transmission
+    {
+        uint64_t uid;
+        uint32_t device;
+        uint32_t pending;
+        uint32_t payloadBytes;
+        bool delivered;
+    };
+
+    struct LinkPower
+    {
+        uint32_t txNode;
+        uint32_t gateway;
+        double powerDbm;
+    };
+
+    // Вызывается моделью потерь для каждой линии в момент отправки
+    void RxPower(uint32_t txNodeId, uint32_t rxNodeId, double rxPowerDbm)
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_SINR);
+        uint32_t gateway = uplinks->GetGateway(rxNodeId);
+        if (gateway == NO_INDEX) {
+            return;
+        }
+        int64_t now = Simulator::Now().GetTimeStep();
+        if (now != linkPowersTime) {
+            linkPowers.clear();
+            linkPowersTime = now;
+        }
+        linkPowers.push_back({txNodeId, gateway, rxPowerDbm});
+    }
+
+    void Sent(const LoraUplink& uplink)
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_SINR);
+        Time duration = LoraAirtime(uplink.sf, uplink.size);
+        // Без LoraTag частота 0: передача идет в первом канале
+        uint32_t channel = uplink.frequency > 0.0 ? ChannelIndex(uplink.frequency) : 0;
+
+        uint32_t transmission = Allocate(transmissions, freeTransmissions);
+        transmissions[transmission] = {uplink.uid, uplink.device, 0, uplink.size, false};
+
+        // Мощности по шлюзам канал считает в том же событии, что и StartSending,
+        // но порядок вызовов не определен: разбираем их следующим событием.
+        // Популяция сообщает передачу уже после расчета потерь, а ее служебный
+        // узел может передать еще раз в тот же момент: разбираем сразу
+        if (uplink.proxy) {
+            StartReceptions(transmission, uplink.nodeId, uplink.sf, duration, channel);
+            return;
+        }
+        Simulator::ScheduleNow(&LoraSinrReception::StartReceptions, this, transmission, uplink.nodeId,
+                               uplink.sf, duration, channel);
+    }
+
+    void StartReceptions(uint32_t transmission, uint32_t nodeId, uint8_t sf, Time duration, uint32_t channel)
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_SINR);
+        int64_t now = Simulator::Now().GetTimeStep();
+        Transmission& t = transmissions[transmission];
+        for (size_t k = 0; k < linkPowers.size();) {
+            if (linkPowers[k].txNode != nodeId || linkPowersTime != now) {
+                k++;
+                continue;
+            }
+            uint32_t cellIndex = linkPowers[k].gateway * MAX_CHANNELS + channel;
+            Cell& cell = cells[cellIndex];
+            Advance(cell, now);
+            Rebase(cell, now);
+
+            if (airtimeExport != nullptr) {
+                airtimeExport->Append({Simulator::Now().GetNanoSeconds(), duration.GetNanoSeconds(),
+                                       channels.empty() ? 0.0 : channels[channel],
+                                       float(linkPowers[k].powerDbm),
+                                       uint16_t(gatewayIndex[linkPowers[k].gateway]), sf, 0});
+            }
+
+            // Путь занимает пакет, преамбулу которого шлюз может обнаружить
+            uint32_t path = LoraReceptionPathPool::NO_PATH;
+            if (pathPool != nullptr && Detectable(linkPowers[k].powerDbm, sf)) {
+                path = pathPool->Allocate(linkPowers[k].gateway);
+                if (path == LoraReceptionPathPool::NO_PATH) {
+                    LORA_BLOG(LORA_LOG_SINR_NO_PATH, linkPowers[k].gateway, linkPowers[k].powerDbm);
+                    uplinks->AddLost(t.uid, linkPowers[k].gateway, LORA_LOST_NO_MORE_RECEIVERS, linkPowers[k].powerDbm);
+                    double powerMw = pow(10.0, linkPowers[k].powerDbm / 10.0);
+                    cell.powerMw[sf - 7] += powerMw;
+                    cell.ending.push({now + duration.GetTimeStep(), uint8_t(sf - 7), powerMw});
+                    cell.active++;
+                    Simulator::Schedule(duration, &LoraSinrReception::EndExternal, this, cellIndex);
+                    linkPowers[k] = linkPowers.back();
+                    linkPowers.pop_back();
+                    continue;
+                }
+            }
+
+            uint32_t id = Allocate(receptions, freeReceptions);
+            Reception& r = receptions[id];
+            r.cell = cellIndex;
+            r.transmission = transmission;
+            r.path = path;
+            r.sf = sf - 7;
+            r.powerMw = pow(10.0, linkPowers[k].powerDbm / 10.0);
+            r.duration = duration.GetTimeStep();
+            std::copy(cell.energy, cell.energy + 6, r.startEnergy);
+            r.epoch = cell.epoch;
+            r.gatewayTx = gatewayTransmissions[linkPowers[k].gateway];
+            r.gatewayBusy = gatewayBusyUntilNs[linkPowers[k].gateway] > Simulator::Now().GetNanoSeconds();
+
+            cell.powerMw[r.sf] += r.powerMw;
+            cell.ending.push({now + r.duration, r.sf, r.powerMw});
+            cell.active++;
+            maxActive = std::max<size_t>(maxActive, cell.active);
+            t.pending++;
+            Simulator::Schedule(duration, &LoraSinrReception::EndReception, this, id);
+
+            linkPowers[k] = linkPowers.back();
+            linkPowers.pop_back();
+        }
+        if (t.pending == 0) {
+            freeTransmissions.push_back(transmission);
+        }
+    }
+
+    void EndReception(uint32_t id)
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_SINR);
+        Reception& r = receptions[id];
+        Cell& cell = cells[r.cell];
+        // Сначала берем интегралы, потом снимаем закончившиеся передачи:
+        // Advance до now включительно уберет и сам пакет
+        int64_t now = Simulator::Now().GetTimeStep();
+        Advance(cell, now);
+
+        double signal = r.powerMw * r.duration;
+        double interference = 0;
+        bool captured = true;
+        bool rebased = r.epoch != cell.epoch;
+        for (int s = 0; s < 6; s++) {
+            double start = rebased ? r.startEnergy[s] - cell.shift[s] : r.startEnergy[s];
+            double energy = cell.energy[s] - start - (s == r.sf ? signal : 0.0);
+            if (energy <= signal * 1e-12) {
+                continue;
+            }
+            interference += energy;
+            if (10 * log10(signal / energy) < LORA_CAPTURE_DB[r.sf][s]) {
+                captured = false;
+            }
+        }
+        double sinrDb = 10 * log10(signal / (noiseMw * r.duration + interference));
+
+        Transmission& t = transmissions[r.transmission];
+        bool demodulated = sinrDb >= LORA_SINR_FLOOR_DB[r.sf];
+        if (perTable != nullptr) {
+            double per = perTable->Lookup(7 + r.sf, perCodingRate, t.payloadBytes, sinrDb);
+            demodulated = perRng->GetValue() >= per;
+        }
+        LORA_BLOG(LORA_LOG_SINR_DECISION, r.cell / MAX_CHANNELS, 7 + r.sf, sinrDb, demodulated && captured);
+        uint32_t gateway = r.cell / MAX_CHANNELS;
+        double powerDbm = 10 * log10(r.powerMw);
+        if (r.gatewayBusy || r.gatewayTx != gatewayTransmissions[gateway]) {
+            // Как NoReceptionBecauseTransmitting PHY шлюза: не потеря по причине приема
+            nLostTransmitting++;
+        } else if (!demodulated) {
+            nLostUnderFloor++;
+            uplinks->AddLost(t.uid, gateway, LORA_LOST_UNDER_SENSITIVITY, powerDbm);
+        } else if (!captured) {
+            nLostInterference++;
+            uplinks->AddLost(t.uid, gateway, LORA_LOST_INTERFERENCE, powerDbm);
+        } else {
+            if (!t.delivered) {
+                t.delivered = true;
+                nReceived++;
+                received[t.device]++;
+            }
+            uplinks->AddReceived(t.uid, gateway, powerDbm);
+        }
+
+        if (--t.pending == 0) {
+            freeTransmissions.push_back(r.transmission);
+        }
+        if (r.path != LoraReceptionPathPool::NO_PATH) {
+            pathPool->Release(r.path);
+        }
+        freeReceptions.push_back(id);
+        Leave(cell);
+    }
+
+    // Переносит начало отсчета интегралов на момент time, если с прошлого
+    // переноса прошло REBASE_SPAN. Идущие приемы не трогаются: их начало
+    // пересчитывается через cell.shift при окончании
+    void Rebase(Cell& cell, int64_t time) const
+    {
+        if (time - cell.originTime < rebaseSpan) {
+            return;
+        }
+        std::copy(cell.energy, cell.energy + 6, cell.shift);
+        std::fill(cell.energy, cell.energy + 6, 0.0);
+        cell.originTime = time;
+        cell.epoch++;
+    }
+
+    // SNR без помех не ниже порога демодуляции SF (с таблицей PER - ниже
+    // которого PER равен 1)
+    bool Detectable(double powerDbm, uint8_t sf) const { return powerDbm >= detectPowerDbm[sf - 7]; }
+
+    // Мощности обнаружения по SF считаются при смене шума или таблицы PER:
+    // поиск порога таблицы перебирает ее целиком
+    void UpdateDetectThresholds()
+    {
+        double noiseDbm = noiseMw > 0 ? 10 * log10(noiseMw) : 0.0;
+        double perFloorDb = perTable != nullptr ? perTable->GetMinUsefulSnrDb() : 0.0;
+        for (int s = 0; s < 6; s++) {
+            detectPowerDbm[s] = noiseMw <= 0 ? -HUGE_VAL
+                                : noiseDbm + (perTable != nullptr ? perFloorDb : LORA_SINR_FLOOR_DB[s]);
+        }
+    }
+
+    void StartExternal()
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_SINR);
+        int64_t now = Simulator::Now().GetTimeStep();
+        int64_t nowNs = Simulator::Now().GetNanoSeconds();
+        for (; nextExternal < external.size() && external[nextExternal].startNs <= nowNs; nextExternal++) {
+            const LoraAirtimeRecord& e = external[nextExternal];
+            if (e.gateway * MAX_CHANNELS >= cells.size() || e.sf < 7 || e.sf > 12) {
+                continue;
+            }
+            uint32_t cellIndex = e.gateway * MAX_CHANNELS + ChannelIndex(e.frequency);
+            Cell& cell = cells[cellIndex];
+            Advance(cell, now);
+            double powerMw = pow(10.0, e.rxPowerDbm / 10.0);
+            Time duration = NanoSeconds(e.durationNs);
+            cell.powerMw[e.sf - 7] += powerMw;
+            cell.ending.push({now + duration.GetTimeStep(), uint8_t(e.sf - 7), powerMw});
+            cell.active++;
+            Simulator::Schedule(duration, &LoraSinrReception::EndExternal, this, cellIndex);
+        }
+        if (nextExternal < external.size()) {
+            Simulator::Schedule(NanoSeconds(external[nextExternal].startNs - nowNs),
+                                &LoraSinrReception::StartExternal, this);
+        }
+    }
+
+    void EndExternal(uint32_t cellIndex)
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_SINR);
+        Cell& cell = cells[cellIndex];
+        Advance(cell, Simulator::Now().GetTimeStep());
+        Leave(cell);
+    }
+
+    // Конец приема или внешней передачи
+    static void Leave(Cell& cell)
+    {
+        if (--cell.active == 0) {
+            // Канал простаивает: обнуляем интегралы и сумму мощностей
+            std::fill(cell.energy, cell.energy + 6, 0.0);
+            std::fill(cell.powerMw, cell.powerMw + 6, 0.0);
+            cell.originTime = cell.lastTime;
+        }
+    }
+
+    // Продвигает интегралы мощности до момента time, снимая закончившиеся передачи
+    static void Advance(Cell& cell, int64_t time)
+    {
+        while (!cell.ending.empty() && cell.ending.top().time <= time) {
+            const Ending& e = cell.ending.top();
+            Integrate(cell, e.time);
+            cell.powerMw[e.sf] = std::max(cell.powerMw[e.sf] - e.powerMw, 0.0);
+            cell.ending.pop();
+        }
+        Integrate(cell, time);
+    }
+
+    static void Integrate(Cell& cell, int64_t time)
+    {
+        double dt = double(time - cell.lastTime);
+        for (int s = 0; s < 6; s++) {
+            cell.energy[s] += cell.powerMw[s] * dt;
+        }
+        cell.lastTime = time;
+    }
+
+    uint32_t ChannelIndex(double frequency)
+    {
+        for (uint32_t c = 0; c < channels.size(); c++) {
+            if (channels[c] == frequency) {
+                return c;
+            }
+        }
+        if (channels.size() < MAX_CHANNELS) {
+            channels.push_back(frequency);
+            return channels.size() - 1;
+        }
+        return 0;
+    }
+
+    template <typename T>
+    static uint32_t Allocate(std::vector<T>& pool, std::vector<uint32_t>& freeList)
+    {
+        if (!freeList.empty()) {
+            uint32_t id = freeList.back();
+            freeList.pop_back();
+            return id;
+        }
+        pool.emplace_back();
+        return pool.size() - 1;
+    }
+
+    double noiseMw;
+    double detectPowerDbm[6];               // Порог Detectable по SF, dBm
+    LoraUplinkTracker* uplinks;
+    std::vector<double> channels;
+    std::vector<Cell> cells;                // [шлюз][канал]
+    std::vector<int64_t> gatewayBusyUntilNs;     // Конец последней передачи шлюза, нс
+    std::vector<uint32_t> gatewayTransmissions;  // Число передач шлюза
+    std::vector<Reception> receptions;
+    std::vector<uint32_t> freeReceptions;
+    std::vector<Transmission> transmissions;
+    std::vector<uint32_t> freeTransmissions;
+    std::vector<uint64_t> received;
+    uint64_t nReceived;
+    uint64_t nLostUnderFloor;
+    uint64_t nLostInterference;
+    uint64_t nLostTransmitting;
+    size_t maxActive;
+    std::vector<LinkPower> linkPowers;      // Мощности текущего момента времени
+    int64_t linkPowersTime;
+    const LoraPerTable* perTable;
+    uint8_t perCodingRate;
+    Ptr<UniformRandomVariable> perRng;
+    std::vector<uint32_t> gatewayIndex;     // Индекс шлюза в трассе эфира
+    LoraAirtimeTraceWriter* airtimeExport;
+    std::vector<LoraAirtimeRecord> external;
+    size_t nextExternal;
+    LoraReceptionPathPool* pathPool;
+    int64_t rebaseSpan;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_SINR_RECEPTION_H */
@@ -0,0 +1,335 @@
+#ifndef LORA_UPLINK_TRACKER_H
+#define LORA_UPLINK_TRACKER_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lorawan-module.h"
+#include "ns3/lora-tag.h"
+
+#include "lora-profiler.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Причина потери передачи на шлюзе (трассы LostPacketBecause* PHY шлюза
+// или решение внешней модели приема)
+enum LoraUplinkLoss : uint8_t {
+    LORA_LOST_INTERFERENCE = 0,
+    LORA_LOST_UNDER_SENSITIVITY = 1,
+    LORA_LOST_NO_MORE_RECEIVERS = 2
+};
+
+// Передача устройства, разобранная один раз в момент отправки
+struct LoraUplink
+{
+    uint64_t uid = UINT64_MAX;  // uid пакета ns-3; UINT64_MAX - запись пуста
+    uint32_t device = 0;        // Индекс устройства в endDevices
+    uint32_t nodeId = 0;        // id узла-передатчика
+    uint32_t slot = 0;          // Запись таблицы передач в эфире
+    uint32_t size = 0;          // Длина пакета PHY, байт
+    int64_t sentNs = 0;
+    int64_t frame = -1;         // FCnt кадра с учетом FCnt снимка
+    double frequency = 0.0;     // Частота из LoraTag, МГц (0 - тега нет)
+    double txPowerDbm = 0.0;
+    uint8_t sf = 0;
+    bool newFrame = false;      // Первая передача кадра, а не повтор подтверждаемого
+    bool received = false;      // Принята хотя бы одним шлюзом
+    bool proxy = false;         // Передача популяции без узлов (AddSent): потери линий уже посчитаны
+};
+
+// Прием передачи шлюзом
+struct LoraUplinkReception
+{
+    uint32_t gateway;           // Индекс шлюза в gateways
+    double rssiDbm;             // NaN - мощность неизвестна
+    bool firstCopy;             // Первый прием этой передачи любым шлюзом
+    bool delivery;              // Первый прием текущего кадра: кадр доставлен
+};
+
+// Общий разбор восходящих передач для счетчиков, трассы и метрик.
+// Подключается к StartSending устройств и трассам PHY шлюзов, переводит
+// id узлов в индексы устройств и шлюзов, один раз на передачу копирует
+// пакет и читает FCnt из заголовков MAC, а SF и мощность - из MAC
+// устройства. Подписчики получают готовые записи: отправку (TraceSent),
+// прием шлюзом (TraceReceived) и потерю с причиной (TraceLost).
+//
+// Доставка считается по кадрам (устройство, FCnt), как в
+// LoraPacketTracker::CountMacPacketsGloballyReceived: повторы
+// подтверждаемого кадра не дают новой отправки, кадр доставлен один раз -
+// при первом приеме любым шлюзом. После теплого старта номера кадров
+// продолжаются со счетчика снимка (SetNextFrame).
+//
+// Передачи в эфире лежат в таблице с прямой адресацией (uid & mask),
+// выделенной в Install. Таблица больше числа пакетов, создаваемых за время
+// передачи SF12, поэтому живые записи не вытесняются, а подписчики могут
+// держать свое состояние передачи в массивах по номеру записи (slot),
+// обнуляя его при отправке.
+//
+// Без gatewayReceptions трассы PHY шлюзов не подключаются, и приемы и
+// потери сообщает внешняя модель приема (AddReceived, AddLost).
+//
+// Популяция без узлов (LoraDevicePopulation) ставится Install по числу
+// устройств: MAC у них нет (GetMac - nullptr), а передачу с SF и мощностью
+// сообщает сама популяция через AddSent, уже посчитав потери всех линий.
+class LoraUplinkTracker
+{
+public:
+    typedef Callback<void, const LoraUplink&> SentCallback;
+    typedef Callback<void, const LoraUplink&, const LoraUplinkReception&> ReceivedCallback;
+    typedef Callback<void, const LoraUplink&, uint32_t, LoraUplinkLoss, double> LostCallback;
+
+    LoraUplinkTracker()
+        : inFlightMask(0)
+    {
+    }
+
+    LoraUplinkTracker(const LoraUplinkTracker&) = delete;
+    LoraUplinkTracker& operator=(const LoraUplinkTracker&) = delete;
+
+    void Install(NodeContainer endDevices, NodeContainer gateways, bool gatewayReceptions = true)
+    {
+        uint32_t nDevices = endDevices.GetN();
+        Allocate(nDevices);
+        for (uint32_t i = 0; i < nDevices; i++) {
+            Ptr<Node> node = endDevices.Get(i);
+            if (node->GetId() >= deviceByNode.size()) {
+                deviceByNode.resize(node->GetId() + 1, NO_INDEX);
+            }
+            deviceByNode[node->GetId()] = i;
+
+            Ptr<LoraNetDevice> loraNetDev = node->GetDevice(0)->GetObject<LoraNetDevice>();
+            deviceMac.push_back(loraNetDev->GetMac()->GetObject<ClassAEndDeviceLorawanMac>());
+            loraNetDev->GetPhy()->TraceConnectWithoutContext(
+                "StartSending", MakeCallback(&LoraUplinkTracker::PhySent, this));
+        }
+        InstallGateways(gateways, gatewayReceptions);
+    }
+
+    // nDevices устройств популяции без узлов: передачи сообщает AddSent
+    void Install(uint32_t nDevices, NodeContainer gateways, bool gatewayReceptions = true)
+    {
+        Allocate(nDevices);
+        InstallGateways(gateways, gatewayReceptions);
+    }
+
+    // Подписчики вызываются в порядке подключения
+    void TraceSent(SentCallback callback) { sentTrace.ConnectWithoutContext(callback); }
+    void TraceReceived(ReceivedCallback callback) { receivedTrace.ConnectWithoutContext(callback); }
+    void TraceLost(LostCallback callback) { lostTrace.ConnectWithoutContext(callback); }
+
+    // Передача устройства популяции от служебного узла nodeId. Вызывается
+    // после расчета потерь всех линий передачи, в том же событии
+    void AddSent(uint32_t device, Ptr<const Packet> packet, uint32_t nodeId, double txPowerDbm, uint8_t sf)
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_TRACKER);
+        Sent(device, packet, nodeId, txPowerDbm, sf, true);
+    }
+
+    // Прием передачи uid шлюзом gateway по решению внешней модели приема
+    void AddReceived(uint64_t uid, uint32_t gateway, double rssiDbm)
+    {
+        LoraUplink* uplink = Find(uid);
+        if (uplink == nullptr) {
+            return;
+        }
+        LoraUplinkReception reception = {gateway, rssiDbm, !uplink->received, false};
+        uplink->received = true;
+        uint32_t d = uplink->device;
+        if (reception.firstCopy && uplink->frame == lastFrame[d] && !frameDelivered[d]) {
+            frameDelivered[d] = true;
+            reception.delivery = true;
+        }
+        receivedTrace(*uplink, reception);
+    }
+
+    // Потеря передачи uid на шлюзе gateway; rssiDbm - NaN, если неизвестна
+    void AddLost(uint64_t uid, uint32_t gateway, LoraUplinkLoss reason, double rssiDbm)
+    {
+        if (LoraUplink* uplink = Find(uid)) {
+            lostTrace(*uplink, gateway, reason, rssiDbm);
+        }
+    }
+
+    // FCnt, с которого продолжается нумерация кадров устройства (теплый старт)
+    void SetNextFrame(uint32_t device, uint16_t fCnt) { frameBase[device] = fCnt; }
+
+    // FCnt следующего кадра устройства, 16 бит, как в заголовке кадра
+    uint16_t GetNextFrame(uint32_t device) const
+    {
+        return uint16_t(lastFrame[device] < 0 ? frameBase[device] : lastFrame[device] + 1);
+    }
+
+    uint32_t GetNDevices() const { return lastFrame.size(); }
+    uint32_t GetNGateways() const { return nGateways; }
+
+    // Число записей таблицы передач: размер массивов подписчиков по slot
+    uint32_t GetSlots() const { return inFlight.size(); }
+
+    // MAC устройства; nullptr - устройство популяции без узла
+    Ptr<ClassAEndDeviceLorawanMac> GetMac(uint32_t device) const
+    {
+        return device < deviceMac.size() ? deviceMac[device] : nullptr;
+    }
+
+    // Индекс устройства по id узла; UINT32_MAX - узел не устройство
+    uint32_t GetDevice(uint32_t nodeId) const
+    {
+        return nodeId < deviceByNode.size() ? deviceByNode[nodeId] : NO_INDEX;
+    }
+
+    // Индекс шлюза по id узла; UINT32_MAX - узел не шлюз
+    uint32_t GetGateway(uint32_t nodeId) const
+    {
+        return nodeId < gatewayByNode.size() ? gatewayByNode[nodeId] : NO_INDEX;
+    }
+
+    // Передача в эфире по uid; nullptr - уже вытеснена или не отслеживается
+    const LoraUplink* Get(uint64_t uid) const
+    {
+        const LoraUplink& slot = inFlight[uid & inFlightMask];
+        return slot.uid == uid ? &slot : nullptr;
+    }
+
+private:
+    static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
+    void Allocate(uint32_t nDevices)
+    {
+        lastFrame.assign(nDevices, -1);
+        frameBase.assign(nDevices, 0);
+        frameDelivered.assign(nDevices, false);
+
+        uint32_t capacity = 4096;
+        while (capacity < 4 * nDevices) {
+            capacity *= 2;
+        }
+        inFlight.assign(capacity, LoraUplink());
+        inFlightMask = capacity - 1;
+    }
+
+    void InstallGateways(NodeContainer gateways, bool gatewayReceptions)
+    {
+        for (uint32_t g = 0; g < gateways.GetN(); g++) {
+            Ptr<Node> node = gateways.Get(g);
+            if (node->GetId() >= gatewayByNode.size()) {
+                gatewayByNode.resize(node->GetId() + 1, NO_INDEX);
+            }
+            gatewayByNode[node->GetId()] = g;
+            if (!gatewayReceptions) {
+                continue;
+            }
+            Ptr<LoraPhy> phy = node->GetDevice(0)->GetObject<LoraNetDevice>()->GetPhy();
+            phy->TraceConnectWithoutContext("ReceivedPacket",
+                                            MakeCallback(&LoraUplinkTracker::GatewayReceived, this));
+            phy->TraceConnectWithoutContext("LostPacketBecauseInterference",
+                                            MakeCallback(&LoraUplinkTracker::LostInterference, this));
+            phy->TraceConnectWithoutContext("LostPacketBecauseUnderSensitivity",
+                                            MakeCallback(&LoraUplinkTracker::LostUnderSensitivity, this));
+            phy->TraceConnectWithoutContext("LostPacketBecauseNoMoreReceivers",
+                                            MakeCallback(&LoraUplinkTracker::LostNoMoreReceivers, this));
+        }
+        nGateways = gateways.GetN();
+    }
+
+    LoraUplink* Find(uint64_t uid)
+    {
+        LoraUplink& slot = inFlight[uid & inFlightMask];
+        return slot.uid == uid ? &slot : nullptr;
+    }
+
+    // Счетчик кадров из заголовков MAC восходящего пакета
+    static int64_t FrameCounter(Ptr<const Packet> packet)
+    {
+        Ptr<Packet> copy = packet->Copy();
+        LorawanMacHeader macHdr;
+        copy->RemoveHeader(macHdr);
+        LoraFrameHeader frameHdr;
+        frameHdr.SetAsUplink();
+        copy->RemoveHeader(frameHdr);
+        return frameHdr.GetFCnt();
+    }
+
+    void PhySent(Ptr<const Packet> packet, uint32_t nodeId)
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_TRACKER);
+        if (nodeId >= deviceByNode.size() || deviceByNode[nodeId] == NO_INDEX) {
+            return;
+        }
+        uint32_t device = deviceByNode[nodeId];
+        Ptr<ClassAEndDeviceLorawanMac> mac = deviceMac[device];
+        Sent(device, packet, nodeId, mac->GetTransmissionPower(), mac->GetSfFromDataRate(mac->GetDataRate()), false);
+    }
+
+    void Sent(uint32_t device, Ptr<const Packet> packet, uint32_t nodeId, double txPowerDbm, uint8_t sf, bool proxy)
+    {
+        uint32_t index = packet->GetUid() & inFlightMask;
+        LoraUplink& uplink = inFlight[index];
+        uplink.uid = packet->GetUid();
+        uplink.device = device;
+        uplink.nodeId = nodeId;
+        uplink.slot = index;
+        uplink.size = packet->GetSize();
+        uplink.sentNs = Simulator::Now().GetNanoSeconds();
+        uplink.frame = frameBase[device] + FrameCounter(packet);
+        LoraTag tag;
+        uplink.frequency = packet->PeekPacketTag(tag) ? tag.GetFrequency() : 0.0;
+        uplink.txPowerDbm = txPowerDbm;
+        uplink.sf = sf;
+        uplink.received = false;
+        uplink.proxy = proxy;
+        uplink.newFrame = uplink.frame != lastFrame[device];
+        if (uplink.newFrame) {
+            lastFrame[device] = uplink.frame;
+            frameDelivered[device] = false;
+        }
+        sentTrace(uplink);
+    }
+
+    // Мощность приема PHY шлюза записывает в LoraTag только при приеме
+    void GatewayReceived(Ptr<const Packet> packet, uint32_t nodeId)
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_TRACKER);
+        uint32_t gateway = GetGateway(nodeId);
+        if (gateway == NO_INDEX) {
+            return;
+        }
+        LoraTag tag;
+        AddReceived(packet->GetUid(), gateway, packet->PeekPacketTag(tag) ? tag.GetReceivePower() : NAN);
+    }
+
+    void LostInterference(Ptr<const Packet> packet, uint32_t nodeId) { Lost(packet, nodeId, LORA_LOST_INTERFERENCE); }
+    void LostUnderSensitivity(Ptr<const Packet> packet, uint32_t nodeId) { Lost(packet, nodeId, LORA_LOST_UNDER_SENSITIVITY); }
+    void LostNoMoreReceivers(Ptr<const Packet> packet, uint32_t nodeId) { Lost(packet, nodeId, LORA_LOST_NO_MORE_RECEIVERS); }
+
+    void Lost(Ptr<const Packet> packet, uint32_t nodeId, LoraUplinkLoss reason)
+    {
+        LORA_PROFILE_SCOPE(LORA_PROFILE_TRACKER);
+        uint32_t gateway = GetGateway(nodeId);
+        if (gateway != NO_INDEX) {
+            AddLost(packet->GetUid(), gateway, reason, NAN);
+        }
+    }
+
+    std::vector<uint32_t> deviceByNode;
+    std::vector<uint32_t> gatewayByNode;
+    std::vector<Ptr<ClassAEndDeviceLorawanMac>> deviceMac;
+    uint32_t nGateways = 0;
+    std::vector<int64_t> lastFrame;         // FCnt последнего кадра; -1 - кадров не было
+    std::vector<int64_t> frameBase;         // FCnt из снимка, добавляется к FCnt MAC
+    std::vector<bool> frameDelivered;
+    std::vector<LoraUplink> inFlight;
+    uint64_t inFlightMask;
+
+    TracedCallback<const LoraUplink&> sentTrace;
+    TracedCallback<const LoraUplink&, const LoraUplinkReception&> receivedTrace;
+    TracedCallback<const LoraUplink&, uint32_t, LoraUplinkLoss, double> lostTrace;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_UPLINK_TRACKER_H */
@@ -0,0 +1,366 @@
+#ifndef LORA_WINDOWED_METRICS_H
+#define LORA_WINDOWED_METRICS_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/lorawan-module.h"
+
+#include "lora-airtime.h"
+#include "lora-uplink-tracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace lorawan {
+
+// Гистограмма с фиксированными корзинами; значения вне диапазона
+// попадают в крайние корзины
+struct LoraHistogramBins
+{
+    double min;
+    double width;
+    uint32_t count;
+
+    uint32_t BinOf(double value) const
+    {
+        double bin = std::floor((value - min) / width);
+        return uint32_t(std::min(std::max(bin, 0.0), double(count - 1)));
+    }
+};
+
+// Метрики по интервалам симулированного времени: PDR, время в эфире
+// (из таблицы LORA_AIRTIME_TABLE), наибольшая доля эфира устройства,
+// потери по причинам и гистограммы SNR/RSSI на каждый SF, счетчики по
+// устройствам. Отправки и доставки считаются по кадрам (FCnt), как в
+// LoraDeviceCounters: повторы подтверждаемого кадра добавляют только время
+// в эфире. Передачи, приемы и потери приходят из LoraUplinkTracker. Все
+// массивы выделяются в Install; на пути пакета только инкременты, без
+// выделений памяти и форматирования строк. Каждые interval секунд окно
+// сбрасывается в файл (CSV или JSON по расширению) и обнуляется, так что
+// видно, как PDR меняется с ростом нагрузки.
+class LoraWindowedMetrics
+{
+public:
+    LoraWindowedMetrics()
+        : interval(Seconds(60)),
+          perDevice(false),
+          json(false),
+          noiseFloorDbm(NAN),
+          snrBins{-30.0, 1.0, 60},
+          rssiBins{-140.0, 2.0, 50},
+          windowStart(0.0)
+    {
+    }
+
+    // Длина окна симулированного времени
+    void SetInterval(Time window) { interval = window; }
+
+    // Писать счетчики каждого устройства в каждом окне
+    void SetPerDevice(bool enable) { perDevice = enable; }
+
+    // Уровень шума для SNR (NaN - гистограмма SNR не заполняется)
+    void SetNoiseFloor(double dbm) { noiseFloorDbm = dbm; }
+
+    void SetSnrHistogram(double min, double width, uint32_t count)
+    {
+        NS_ABORT_MSG_IF(count == 0 || width <= 0, "Гистограмма SNR без корзин");
+        snrBins = {min, width, count};
+    }
+
+    void SetRssiHistogram(double min, double width, uint32_t count)
+    {
+        NS_ABORT_MSG_IF(count == 0 || width <= 0, "Гистограмма RSSI без корзин");
+        rssiBins = {min, width, count};
+    }
+
+    // Бины гистограмм из строки "min:width:count" (пустая - по умолчанию)
+    bool SetSnrHistogram(const std::string& spec) { return ParseBins(spec, snrBins); }
+    bool SetRssiHistogram(const std::string& spec) { return ParseBins(spec, rssiBins); }
+
+    // Файл с расширением .json пишется строками JSON (по объекту на окно), иначе CSV
+    bool Open(const std::string& filename)
+    {
+        json = filename.size() >= 5 && filename.compare(filename.size() - 5, 5, ".json") == 0;
+        output.open(filename);
+        if (!output.is_open()) {
+            return false;
+        }
+        if (!json) {
+            output << "time,scope,key,metric,value\n";
+        }
+        return true;
+    }
+
+    void Install(LoraUplinkTracker& tracker)
+    {
+        uint32_t nDevices = tracker.GetNDevices();
+        deviceSent.assign(nDevices, 0);
+        deviceAirtimeNs.assign(nDevices, 0);
+        deviceDelivered.assign(nDevices, 0);
+        for (SfCounters& c : sf) {
+            c.snrHistogram.assign(snrBins.count, 0);
+            c.rssiHistogram.assign(rssiBins.count, 0);
+        }
+        tracker.TraceSent(MakeCallback(&LoraWindowedMetrics::Sent, this));
+        tracker.TraceReceived(MakeCallback(&LoraWindowedMetrics::Received, this));
+        tracker.TraceLost(MakeCallback(&LoraWindowedMetrics::Lost, this));
+
+        windowStart = Simulator::Now().GetSeconds();
+        Simulator::Schedule(interval, &LoraWindowedMetrics::Snapshot, this);
+    }
+
+    // Сбрасывает неполное последнее окно; вызывается после Simulator::Run()
+    void Finish()
+    {
+        if (output.is_open()) {
+            Write(Simulator::Now().GetSeconds());
+            output.close();
+        }
+    }
+
+private:
+    struct SfCounters
+    {
+        uint64_t sent = 0;
+        uint64_t delivered = 0;
+        uint64_t lostInterference = 0;
+        uint64_t lostUnderSensitivity = 0;
+        uint64_t lostNoMoreReceivers = 0;
+        int64_t airtimeNs = 0;
+        std::vector<uint64_t> snrHistogram;
+        std::vector<uint64_t> rssiHistogram;
+    };
+
+    void Sent(const LoraUplink& uplink)
+    {
+        SfCounters& c = sf[uplink.sf];
+        if (uplink.newFrame) {
+            deviceSent[uplink.device]++;
+            c.sent++;
+        }
+        int64_t airtimeNs = LoraAirtimeNs(uplink.sf, uplink.size);
+        c.airtimeNs += airtimeNs;
+        deviceAirtimeNs[uplink.device] += airtimeNs;
+    }
+
+    void Received(const LoraUplink& uplink, const LoraUplinkReception& reception)
+    {
+        SfCounters& c = sf[uplink.sf];
+        // Кадр доставлен один раз, сколько бы его повторов ни дошло
+        if (reception.delivery) {
+            deviceDelivered[uplink.device]++;
+            c.delivered++;
+        }
+        // Гистограммы строятся по каждому приему, включая копии на других шлюзах
+        if (!std::isnan(reception.rssiDbm)) {
+            c.rssiHistogram[rssiBins.BinOf(reception.rssiDbm)]++;
+            if (!std::isnan(noiseFloorDbm)) {
+                c.snrHistogram[snrBins.BinOf(reception.rssiDbm - noiseFloorDbm)]++;
+            }
+        }
+    }
+
+    void Lost(const LoraUplink& uplink, uint32_t, LoraUplinkLoss reason, double)
+    {
+        SfCounters& c = sf[uplink.sf];
+        switch (reason) {
+            case LORA_LOST_INTERFERENCE:
+                c.lostInterference++;
+                break;
+            case LORA_LOST_UNDER_SENSITIVITY:
+                c.lostUnderSensitivity++;
+                break;
+            case LORA_LOST_NO_MORE_RECEIVERS:
+                c.lostNoMoreReceivers++;
+                break;
+        }
+    }
+
+    void Snapshot()
+    {
+        Write(Simulator::Now().GetSeconds());
+        Simulator::Schedule(interval, &LoraWindowedMetrics::Snapshot, this);
+    }
+
+    // Пишет окно [windowStart, now] и обнуляет счетчики
+    void Write(double now)
+    {
+        if (output.is_open()) {
+            if (json) {
+                WriteJson(now);
+            } else {
+                WriteCsv(now);
+            }
+            output.flush();
+        }
+
+        for (SfCounters& c : sf) {
+            c.sent = c.delivered = 0;
+            c.lostInterference = c.lostUnderSensitivity = c.lostNoMoreReceivers = 0;
+            c.airtimeNs = 0;
+            std::fill(c.snrHistogram.begin(), c.snrHistogram.end(), 0);
+            std::fill(c.rssiHistogram.begin(), c.rssiHistogram.end(), 0);
+        }
+        std::fill(deviceSent.begin(), deviceSent.end(), 0);
+        std::fill(deviceAirtimeNs.begin(), deviceAirtimeNs.end(), 0);
+        std::fill(deviceDelivered.begin(), deviceDelivered.end(), 0);
+        windowStart = now;
+    }
+
+    static double Pdr(uint64_t delivered, uint64_t sent)
+    {
+        return sent > 0 ? 100.0 * delivered / sent : 0.0;
+    }
+
+    // Доля окна, которую устройство провело в эфире, %
+    double DutyCycle(int64_t airtimeNs, double now) const
+    {
+        return now > windowStart ? 100.0 * airtimeNs * 1e-9 / (now - windowStart) : 0.0;
+    }
+
+    double MaxDutyCycle(double now) const
+    {
+        int64_t maxAirtime = 0;
+        for (int64_t airtime : deviceAirtimeNs) {
+            maxAirtime = std::max(maxAirtime, airtime);
+        }
+        return DutyCycle(maxAirtime, now);
+    }
+
+    void WriteCsvRow(double now, const char* scope, uint32_t key, const std::string& metric, double value)
+    {
+        output << now << "," << scope << "," << key << "," << metric << "," << value << "\n";
+    }
+
+    void WriteCsv(double now)
+    {
+        uint64_t sent = 0;
+        uint64_t delivered = 0;
+        for (int s = 7; s <= 12; s++) {
+            const SfCounters& c = sf[s];
+            sent += c.sent;
+            delivered += c.delivered;
+            WriteCsvRow(now, "sf", s, "sent", c.sent);
+            WriteCsvRow(now, "sf", s, "delivered", c.delivered);
+            WriteCsvRow(now, "sf", s, "pdr", Pdr(c.delivered, c.sent));
+            WriteCsvRow(now, "sf", s, "airtime", c.airtimeNs * 1e-9);
+            WriteCsvRow(now, "sf", s, "lost_interference", c.lostInterference);
+            WriteCsvRow(now, "sf", s, "lost_sensitivity", c.lostUnderSensitivity);
+            WriteCsvRow(now, "sf", s, "lost_receivers", c.lostNoMoreReceivers);
+            for (uint32_t b = 0; b < snrBins.count; b++) {
+                if (c.snrHistogram[b] > 0) {
+                    WriteCsvRow(now, "sf", s, "snr_" + BinLabel(snrBins, b), c.snrHistogram[b]);
+                }
+            }
+            for (uint32_t b = 0; b < rssiBins.count; b++) {
+                if (c.rssiHistogram[b] > 0) {
+                    WriteCsvRow(now, "sf", s, "rssi_" + BinLabel(rssiBins, b), c.rssiHistogram[b]);
+                }
+            }
+        }
+        WriteCsvRow(now, "total", 0, "sent", sent);
+        WriteCsvRow(now, "total", 0, "delivered", delivered);
+        WriteCsvRow(now, "total", 0, "pdr", Pdr(delivered, sent));
+        WriteCsvRow(now, "total", 0, "max_duty_cycle", MaxDutyCycle(now));
+        if (perDevice) {
+            for (uint32_t i = 0; i < deviceSent.size(); i++) {
+                WriteCsvRow(now, "device", i, "sent", deviceSent[i]);
+                WriteCsvRow(now, "device", i, "delivered", deviceDelivered[i]);
+                WriteCsvRow(now, "device", i, "duty_cycle", DutyCycle(deviceAirtimeNs[i], now));
+            }
+        }
+    }
+
+    void WriteJson(double now)
+    {
+        uint64_t sent = 0;
+        uint64_t delivered = 0;
+        output << "{\"start\":" << windowStart << ",\"end\":" << now << ",\"sf\":{";
+        for (int s = 7; s <= 12; s++) {
+            const SfCounters& c = sf[s];
+            sent += c.sent;
+            delivered += c.delivered;
+            output << (s > 7 ? "," : "") << "\"" << s << "\":{\"sent\":" << c.sent
+                   << ",\"delivered\":" << c.delivered << ",\"pdr\":" << Pdr(c.delivered, c.sent)
+                   << ",\"airtime\":" << c.airtimeNs * 1e-9 << ",\"lost_interference\":" << c.lostInterference
+                   << ",\"lost_sensitivity\":" << c.lostUnderSensitivity
+                   << ",\"lost_receivers\":" << c.lostNoMoreReceivers << ",\"snr\":";
+            WriteJsonArray(c.snrHistogram);
+            output << ",\"rssi\":";
+            WriteJsonArray(c.rssiHistogram);
+            output << "}";
+        }
+        output << "},\"total\":{\"sent\":" << sent << ",\"delivered\":" << delivered
+               << ",\"pdr\":" << Pdr(delivered, sent) << ",\"max_duty_cycle\":" << MaxDutyCycle(now) << "}";
+        output << ",\"snr_bins\":{\"min\":" << snrBins.min << ",\"width\":" << snrBins.width << "}";
+        output << ",\"rssi_bins\":{\"min\":" << rssiBins.min << ",\"width\":" << rssiBins.width << "}";
+        if (perDevice) {
+            output << ",\"device_sent\":";
+            WriteJsonArray(deviceSent);
+            output << ",\"device_delivered\":";
+            WriteJsonArray(deviceDelivered);
+            output << ",\"device_duty_cycle\":[";
+            for (size_t i = 0; i < deviceAirtimeNs.size(); i++) {
+                output << (i > 0 ? "," : "") << DutyCycle(deviceAirtimeNs[i], now);
+            }
+            output << "]";
+        }
+        output << "}\n";
+    }
+
+    void WriteJsonArray(const std::vector<uint64_t>& values)
+    {
+        output << "[";
+        for (size_t k = 0; k < values.size(); k++) {
+            output << (k > 0 ? "," : "") << values[k];
+        }
+        output << "]";
+    }
+
+    static bool ParseBins(const std::string& spec, LoraHistogramBins& bins)
+    {
+        if (spec.empty()) {
+            return true;
+        }
+        double min;
+        double width;
+        uint32_t count;
+        if (std::sscanf(spec.c_str(), "%lf:%lf:%u", &min, &width, &count) != 3 || width <= 0 || count == 0) {
+            return false;
+        }
+        bins = {min, width, count};
+        return true;
+    }
+
+    static std::string BinLabel(const LoraHistogramBins& bins, uint32_t b)
+    {
+        std::ostringstream label;
+        label << bins.min + b * bins.width;
+        return label.str();
+    }
+
+    Time interval;
+    bool perDevice;
+    bool json;
+    double noiseFloorDbm;
+    LoraHistogramBins snrBins;
+    LoraHistogramBins rssiBins;
+    double windowStart;
+    std::ofstream output;
+
+    SfCounters sf[13];
+    std::vector<uint64_t> deviceSent;
+    std::vector<int64_t> deviceAirtimeNs;
+    std::vector<uint64_t> deviceDelivered;
+};
+
+} // namespace lorawan
+} // namespace ns3
+
+#endif /* LORA_WINDOWED_METRICS_H */
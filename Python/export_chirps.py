@@ -0,0 +1,33 @@
+import argparse
+
+import numpy as np
+
+from lora_modulate import loramod
+
+
+# Эталонные отсчеты loramod для сверки с NS-3/ChirpPer.cc (--validate)
+def main():
+    parser = argparse.ArgumentParser(description="Экспорт отсчетов loramod")
+    parser.add_argument("--sf", default="7,8,9,10,11,12", help="SF через запятую")
+    parser.add_argument("--bw", type=float, default=125e3, help="Полоса, Гц")
+    parser.add_argument("--fs", type=float, default=125e3, help="Частота дискретизации, Гц")
+    parser.add_argument("--symbols", type=int, default=16, help="Случайных символов на SF")
+    parser.add_argument("--output", default="chirps.txt")
+    args = parser.parse_args()
+
+    rng = np.random.default_rng(1)
+    with open(args.output, "w") as f:
+        for sf in [int(s) for s in args.sf.split(",")]:
+            M = 2 ** sf
+            # Крайние символы и случайные
+            symbols = [0, 1, M - 1] + list(rng.integers(0, M, args.symbols))
+            for x in symbols:
+                y = loramod([x], sf, args.bw, args.fs, 1)
+                f.write(f"CHIRP sf={sf} bw={args.bw:.0f} fs={args.fs:.0f} symbol={x} samples={len(y)}\n")
+                for v in y:
+                    f.write(f"{v.real:.9f} {v.imag:.9f}\n")
+    print(f"Отсчеты записаны в {args.output}")
+
+
+if __name__ == "__main__":
+    main()